@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "CommandTable.h"
+
+// The command record the front-ends queue for the sensing task, the dispatch
+// table entry type, and the steps every command goes through: resolve the
+// name, run the entry's handler, answer with an ack. main.cpp supplies the
+// queues and the handlers; host tests supply stand-ins for both.
+
+// Commands from the cloud and the web UI share one queue and one dispatch
+// table. Front-ends resolve the name and copy the arguments the table entry
+// asks for; the sensing task executes them, since it owns the LED.
+enum CommandSource : uint8_t { COMMAND_FROM_CLOUD, COMMAND_FROM_WEB, COMMAND_FROM_SHADOW };
+
+const size_t COMMAND_NAME_SIZE = 24;
+const size_t COMMAND_ID_SIZE = 40;
+const size_t COMMAND_ARG_SIZE = 24;
+const uint8_t COMMAND_ARG_COUNT = 2;
+
+struct Command {
+    char name[COMMAND_NAME_SIZE];
+    char id[COMMAND_ID_SIZE];      // correlation ID from the requester, echoed in the ack
+    char args[COMMAND_ARG_COUNT][COMMAND_ARG_SIZE];
+    int8_t entry;                  // index into the dispatch table
+    CommandSource source;
+};
+
+// Returns the ack status, or nullptr if the command answers some other way.
+typedef const char* (*CommandHandler)(const Command& command);
+
+struct CommandEntry {
+    const char* name;
+    CommandHandler handler;
+    const char* argKeys[COMMAND_ARG_COUNT];
+};
+
+// Acks are raised on the sensing task and by the front-ends, and published
+// by the network task, several per message when they queue up.
+struct AckRequest {
+    char command[COMMAND_NAME_SIZE + 4];
+    char id[COMMAND_ID_SIZE];
+    const char* status;
+};
+
+// Fills in everything but the arguments; names and IDs that are too long are
+// cut. Returns the table index, or -1 for an unknown command.
+template <size_t N>
+int prepareCommand(Command& command, const CommandEntry (&table)[N], const char* name, CommandSource source,
+                   const char* id) {
+    memset(&command, 0, sizeof(command));
+    snprintf(command.name, sizeof(command.name), "%s", name);
+    snprintf(command.id, sizeof(command.id), "%s", id);
+    command.source = source;
+    command.entry = findCommand(table, name);
+    return command.entry;
+}
+
+// Commands from the web UI are acked as WEB_<name>.
+inline AckRequest makeAck(const Command& command, const char* status) {
+    AckRequest ack;
+    snprintf(ack.command, sizeof(ack.command), "%s%s", command.source == COMMAND_FROM_WEB ? "WEB_" : "",
+             command.name);
+    snprintf(ack.id, sizeof(ack.id), "%s", command.id);
+    ack.status = status;
+    return ack;
+}
+
+// Takes commands from receive(command) until it returns false and runs each
+// through its table entry. before(command, entry) is called ahead of the
+// handler and after(command, entry, status) with what it returned. Commands
+// with no entry never reach the queue; one that does anyway is skipped.
+// Returns how many ran.
+template <size_t N, typename Receive, typename Before, typename After>
+size_t dispatchCommands(const CommandEntry (&table)[N], Receive receive, Before before, After after) {
+    Command command;
+    size_t count = 0;
+    while (receive(command)) {
+        if (command.entry < 0 || (size_t)command.entry >= N) continue;
+        const CommandEntry& entry = table[command.entry];
+        before(command, entry);
+        after(command, entry, entry.handler(command));
+        count++;
+    }
+    return count;
+}
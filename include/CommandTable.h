@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+
+// Name lookup for command dispatch tables. Tables are plain arrays of
+// entries with a `name` member, kept sorted by name so a lookup is a binary
+// search rather than a strcmp chain. isSortedTable() is constexpr, so the
+// table definition can static_assert that nobody broke the order.
+
+constexpr int compareCommandNames(const char* a, const char* b) {
+    return *a != *b ? (*a < *b ? -1 : 1) : (*a == 0 ? 0 : compareCommandNames(a + 1, b + 1));
+}
+
+template <typename Entry, size_t N>
+constexpr bool isSortedTable(const Entry (&table)[N], size_t i = 1) {
+    return i >= N || (compareCommandNames(table[i - 1].name, table[i].name) < 0 && isSortedTable(table, i + 1));
+}
+
+// Returns the entry index, or -1 if the name is not in the table.
+template <typename Entry, size_t N>
+int findCommand(const Entry (&table)[N], const char* name) {
+    size_t low = 0;
+    size_t high = N;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        int order = strcmp(name, table[mid].name);
+        if (order == 0) return (int)mid;
+        if (order < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return -1;
+}
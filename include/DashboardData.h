@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "DeviceState.h"
+#include "PayloadWriter.h"
+
+// The JSON behind the web dashboard. /data serves a full snapshot that is
+// rebuilt only when something on it changes; live viewers get a delta with
+// just the fields that differ from what they already have. DashboardState
+// holds the values that decide both, in the resolution the page shows them,
+// so noise below a tenth of a centimetre does not count as a change.
+
+struct DashboardState {
+    int32_t distanceTenths;
+    int32_t rssi;
+    uint32_t published;
+    uint32_t failed;
+    uint32_t suppressed;
+    bool ledOn;
+    bool manual;
+    bool awsConnected;
+    uint8_t sensorCount;
+    int32_t sensorTenths[DeviceSnapshot::MAX_SENSORS];
+};
+
+inline bool sensorsChanged(const DashboardState& a, const DashboardState& b) {
+    return a.sensorCount > 1 &&
+           (a.sensorCount != b.sensorCount || memcmp(a.sensorTenths, b.sensorTenths, a.sensorCount * sizeof(int32_t)) != 0);
+}
+
+inline bool dashboardStateChanged(const DashboardState& a, const DashboardState& b) {
+    return a.distanceTenths != b.distanceTenths || a.rssi != b.rssi || a.published != b.published ||
+           a.failed != b.failed || a.suppressed != b.suppressed || a.ledOn != b.ledOn ||
+           a.manual != b.manual || a.awsConnected != b.awsConnected || sensorsChanged(a, b);
+}
+
+// The full /data document. Returns the length, or 0 if size was too small.
+inline size_t writeDashboardData(char* buffer, size_t size, const DeviceSnapshot& device, const DashboardState& state,
+                                 const char* ip, const char* ssid) {
+    bool array = device.sensorCount > 1;
+    PayloadWriter writer((uint8_t*)buffer, size, PayloadWriter::JSON);
+    writer.beginObject(10 + array);
+    writer.add("distance", device.distance);
+    if (array) writer.add("sensors", device.sensors, device.sensorCount);
+    writer.add("led_status", state.ledOn ? "ON" : "OFF");
+    writer.add("manual_mode", state.manual);
+    writer.add("ip", ip);
+    writer.add("ssid", ssid);
+    writer.add("rssi", state.rssi);
+    writer.add("aws_connected", state.awsConnected);
+    writer.add("mqtt_published", state.published);
+    writer.add("mqtt_failed", state.failed);
+    writer.add("mqtt_suppressed", state.suppressed);
+    return writer.end();
+}
+
+// The fields live viewers show that differ from previous, or all of them,
+// plus ip and ssid, when full is set. Counter changes refresh /data but are
+// not worth a push. Returns 0 when there is nothing to send.
+inline size_t writeDashboardDelta(char* buffer, size_t size, const DeviceSnapshot& device,
+                                  const DashboardState& state, const DashboardState& previous, const char* ip,
+                                  const char* ssid, bool full) {
+    bool distanceChanged = full || state.distanceTenths != previous.distanceTenths;
+    bool sensorChanged = state.sensorCount > 1 && (full || sensorsChanged(state, previous));
+    bool ledChanged = full || state.ledOn != previous.ledOn;
+    bool modeChanged = full || state.manual != previous.manual;
+    bool awsChanged = full || state.awsConnected != previous.awsConnected;
+    bool rssiChanged = full || state.rssi != previous.rssi;
+    uint8_t fields =
+        distanceChanged + sensorChanged + ledChanged + modeChanged + awsChanged + rssiChanged + (full ? 2 : 0);
+    if (fields == 0) return 0;
+
+    PayloadWriter writer((uint8_t*)buffer, size, PayloadWriter::JSON);
+    writer.beginObject(fields);
+    if (distanceChanged) writer.add("distance", device.distance);
+    if (sensorChanged) writer.add("sensors", device.sensors, device.sensorCount);
+    if (ledChanged) writer.add("led_status", state.ledOn ? "ON" : "OFF");
+    if (modeChanged) writer.add("manual_mode", state.manual);
+    if (awsChanged) writer.add("aws_connected", state.awsConnected);
+    if (rssiChanged) writer.add("rssi", state.rssi);
+    if (full) {
+        writer.add("ip", ip);
+        writer.add("ssid", ssid);
+    }
+    return writer.end();
+}
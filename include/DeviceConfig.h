@@ -0,0 +1,143 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Settings that can be tuned at run time, from SET_CONFIG or the web UI.
+// Every field is an unsigned integer with a key and an allowed range, so one
+// table drives parsing, validation and serialisation. The struct is stored
+// in NVS as a blob. New fields go at the end: bump LAYOUT and teach
+// storedSize() the new size, and blobs of older layouts load with defaults
+// for the fields they lack. Reordering fields would need a real conversion.
+
+struct DeviceConfig {
+    static const uint32_t LAYOUT = 2;
+    static const size_t FIELD_COUNT = 9;
+    static const uint32_t SENSOR_RANGE_CM = 400;    // what the HC-SR04 reports at most
+
+    uint32_t thresholdCm = 50;
+    uint32_t hysteresisCm = 10;
+    uint32_t sampleRateHz = 25;
+    uint32_t deadbandCm = 5;
+    uint32_t minPublishIntervalMs = 500;
+    uint32_t heartbeatMs = 60000;
+    uint32_t reconnectBaseMs = 2000;
+    uint32_t reconnectMaxMs = 120000;
+    uint32_t metricsIntervalMs = 0;      // 0 = no MQTT metrics message
+
+    enum Result : uint8_t { CHANGED, UNCHANGED, UNKNOWN_KEY, INVALID_VALUE };
+
+    struct Field {
+        const char* key;
+        uint32_t DeviceConfig::*member;
+        uint32_t minValue;
+        uint32_t maxValue;
+    };
+
+    static const Field* fields(size_t& count) {
+        static const Field FIELDS[] = {
+            {"threshold_cm", &DeviceConfig::thresholdCm, 2, 400},
+            {"hysteresis_cm", &DeviceConfig::hysteresisCm, 0, 100},
+            {"sample_rate_hz", &DeviceConfig::sampleRateHz, 1, 40},
+            {"deadband_cm", &DeviceConfig::deadbandCm, 0, 100},
+            {"min_publish_interval_ms", &DeviceConfig::minPublishIntervalMs, 0, 60000},
+            {"heartbeat_ms", &DeviceConfig::heartbeatMs, 1000, 3600000},
+            {"reconnect_base_ms", &DeviceConfig::reconnectBaseMs, 500, 600000},
+            {"reconnect_max_ms", &DeviceConfig::reconnectMaxMs, 1000, 3600000},
+            {"metrics_interval_ms", &DeviceConfig::metricsIntervalMs, 0, 3600000},
+        };
+        static_assert(sizeof(FIELDS) / sizeof(FIELDS[0]) == FIELD_COUNT, "FIELD_COUNT is out of date");
+        count = FIELD_COUNT;
+        return FIELDS;
+    }
+
+    // value is decimal text, as it arrives from a query string or JSON.
+    // Settings that depend on each other are checked against the current
+    // values, so several changes have to go in an order where each one is
+    // consistent; a rejected change leaves the config as it was.
+    Result set(const char* key, const char* value) {
+        const Field* field = find(key);
+        if (!field) return UNKNOWN_KEY;
+
+        uint32_t parsed;
+        if (!parse(value, parsed) || parsed < field->minValue || parsed > field->maxValue) {
+            return INVALID_VALUE;
+        }
+        if (this->*(field->member) == parsed) return UNCHANGED;
+        uint32_t previous = this->*(field->member);
+        this->*(field->member) = parsed;
+        if (!consistent()) {
+            this->*(field->member) = previous;
+            return INVALID_VALUE;
+        }
+        return CHANGED;
+    }
+
+    // True when every field is in range and the fields agree with each
+    // other, e.g. after loading a stored blob.
+    bool valid() const {
+        size_t count;
+        const Field* all = fields(count);
+        for (size_t i = 0; i < count; i++) {
+            uint32_t value = this->*(all[i].member);
+            if (value < all[i].minValue || value > all[i].maxValue) return false;
+        }
+        return consistent();
+    }
+
+    // The LED has to be able to turn off again within the sensor's range,
+    // a heartbeat cannot come faster than the publish interval allows, and
+    // the reconnect backoff cannot start above its cap.
+    bool consistent() const {
+        return thresholdCm + hysteresisCm <= SENSOR_RANGE_CM && heartbeatMs >= minPublishIntervalMs &&
+               reconnectBaseMs <= reconnectMaxMs;
+    }
+
+    // Bytes of the blob stored under layout, 0 for a layout this firmware
+    // cannot read. Layout 1 had no metricsIntervalMs.
+    static size_t storedSize(uint32_t layout) {
+        switch (layout) {
+            case 1: return 8 * sizeof(uint32_t);
+            case LAYOUT: return sizeof(DeviceConfig);
+            default: return 0;
+        }
+    }
+
+    // Loads a blob stored under layout; fields it predates keep their
+    // defaults. Returns false, changing nothing, when the layout is unknown,
+    // the length does not match it or the result is not valid().
+    bool restore(uint32_t layout, const void* blob, size_t length) {
+        if (length == 0 || length != storedSize(layout)) return false;
+        DeviceConfig restored;
+        memcpy(&restored, blob, length);
+        if (!restored.valid()) return false;
+        *this = restored;
+        return true;
+    }
+
+    static const Field* find(const char* key) {
+        size_t count;
+        const Field* all = fields(count);
+        for (size_t i = 0; i < count; i++) {
+            if (strcmp(all[i].key, key) == 0) return &all[i];
+        }
+        return nullptr;
+    }
+
+private:
+    static bool parse(const char* text, uint32_t& out) {
+        if (!text || !*text) return false;
+        uint64_t value = 0;
+        for (; *text; text++) {
+            if (*text < '0' || *text > '9') return false;
+            value = value * 10 + (*text - '0');
+            if (value > 0xffffffffu) return false;
+        }
+        out = (uint32_t)value;
+        return true;
+    }
+};
+
+static_assert(sizeof(DeviceConfig) == DeviceConfig::FIELD_COUNT * sizeof(uint32_t),
+              "DeviceConfig is stored as a blob of its fields");
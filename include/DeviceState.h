@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// The device state other tasks are allowed to see, published as a whole by
+// the one task that owns the sensor and the LED. Readers on either core get
+// a consistent copy through a sequence lock: the writer never waits, and a
+// reader that raced with an update simply copies again.
+
+struct DeviceSnapshot {
+    static const uint8_t MAX_SENSORS = 8;
+
+    float distance;        // cm, filtered; negative when nothing is in range
+    uint32_t updatedMs;
+    bool ledOn;
+    bool manual;
+    uint8_t sensorCount;
+    float sensors[MAX_SENSORS];    // per-sensor filtered readings, cm
+};
+
+class DeviceState {
+public:
+    // Single writer only.
+    void publish(const DeviceSnapshot& next) {
+        sequence.fetch_add(1, std::memory_order_acq_rel);
+        current.distance = next.distance;
+        current.updatedMs = next.updatedMs;
+        current.ledOn = next.ledOn;
+        current.manual = next.manual;
+        current.sensorCount = next.sensorCount;
+        for (uint8_t i = 0; i < next.sensorCount; i++) current.sensors[i] = next.sensors[i];
+        sequence.fetch_add(1, std::memory_order_release);
+    }
+
+    DeviceSnapshot read() const {
+        DeviceSnapshot out;
+        uint32_t seq;
+        do {
+            seq = sequence.load(std::memory_order_acquire);
+            if (seq & 1) continue;
+            out.distance = current.distance;
+            out.updatedMs = current.updatedMs;
+            out.ledOn = current.ledOn;
+            out.manual = current.manual;
+            out.sensorCount = current.sensorCount;
+            for (uint8_t i = 0; i < out.sensorCount && i < DeviceSnapshot::MAX_SENSORS; i++) {
+                out.sensors[i] = current.sensors[i];
+            }
+            // Keeps the copy above from being reordered after the re-check.
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((seq & 1) || seq != sequence.load(std::memory_order_acquire));
+        return out;
+    }
+
+    uint32_t version() const { return sequence.load(std::memory_order_relaxed) / 2; }
+
+private:
+    volatile DeviceSnapshot current = {0, 0, false, false, 0, {}};
+    std::atomic<uint32_t> sequence{0};
+};
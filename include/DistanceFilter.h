@@ -0,0 +1,195 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+
+// Allocation-free filter stages for HC-SR04 samples. Every stage exposes
+// process(float& value), which rewrites the value in place and returns false
+// when the sample should be swallowed. A negative value means "no target" and
+// is passed through unchanged after the stage resets its history.
+
+class OutlierRejector {
+public:
+    OutlierRejector(float minCm = 2, float maxCm = 400, float maxJumpCm = 80, uint8_t maxRun = 3)
+        : minCm(minCm), maxCm(maxCm), maxJumpCm(maxJumpCm), maxRun(maxRun) {}
+
+    bool process(float& value) {
+        if (value < minCm || value > maxCm) {
+            jumpRun = 0;
+            if (++missRun <= maxRun) return false;
+            hasLast = false;
+            value = -1;
+            return true;
+        }
+        missRun = 0;
+
+        if (hasLast && fabsf(value - last) > maxJumpCm && ++jumpRun <= maxRun) {
+            return false;
+        }
+        jumpRun = 0;
+        last = value;
+        hasLast = true;
+        return true;
+    }
+
+    void reset() {
+        hasLast = false;
+        missRun = 0;
+        jumpRun = 0;
+    }
+
+private:
+    float minCm;
+    float maxCm;
+    float maxJumpCm;
+    uint8_t maxRun;
+    float last = 0;
+    bool hasLast = false;
+    uint8_t missRun = 0;
+    uint8_t jumpRun = 0;
+};
+
+// Median over the last N samples. The window is kept sorted alongside the
+// arrival order, so each update is a bounded O(N) shift with N fixed.
+template <size_t N>
+class SlidingMedian {
+    static_assert(N % 2 == 1, "SlidingMedian window must be odd");
+
+public:
+    bool process(float& value) {
+        if (value < 0) {
+            reset();
+            return true;
+        }
+
+        if (count == N) {
+            removeSorted(window[next]);
+        }
+        window[next] = value;
+        next = (next + 1) % N;
+        insertSorted(value);
+
+        value = sorted[(count - 1) / 2];
+        return true;
+    }
+
+    void reset() {
+        count = 0;
+        next = 0;
+    }
+
+private:
+    void removeSorted(float value) {
+        size_t i = 0;
+        while (i < count && sorted[i] != value) i++;
+        for (; i + 1 < count; i++) sorted[i] = sorted[i + 1];
+        count--;
+    }
+
+    void insertSorted(float value) {
+        size_t i = count;
+        while (i > 0 && sorted[i - 1] > value) {
+            sorted[i] = sorted[i - 1];
+            i--;
+        }
+        sorted[i] = value;
+        count++;
+    }
+
+    float window[N];
+    float sorted[N];
+    size_t count = 0;
+    size_t next = 0;
+};
+
+// Scalar Kalman filter with a constant-position model.
+class Kalman1D {
+public:
+    Kalman1D(float processNoise = 0.5f, float measurementNoise = 4.0f)
+        : q(processNoise), r(measurementNoise) {}
+
+    bool process(float& value) {
+        if (value < 0) {
+            reset();
+            return true;
+        }
+        if (!initialized) {
+            x = value;
+            p = r;
+            initialized = true;
+            return true;
+        }
+
+        p += q;
+        float k = p / (p + r);
+        x += k * (value - x);
+        p *= 1 - k;
+        value = x;
+        return true;
+    }
+
+    void reset() { initialized = false; }
+
+private:
+    float q;
+    float r;
+    float x = 0;
+    float p = 0;
+    bool initialized = false;
+};
+
+class ExponentialAverage {
+public:
+    explicit ExponentialAverage(float alpha = 0.3f) : alpha(alpha) {}
+
+    bool process(float& value) {
+        if (value < 0) {
+            reset();
+            return true;
+        }
+        y = initialized ? y + alpha * (value - y) : value;
+        initialized = true;
+        value = y;
+        return true;
+    }
+
+    void reset() { initialized = false; }
+
+private:
+    float alpha;
+    float y = 0;
+    bool initialized = false;
+};
+
+// Runs the stages in order and stops at the first one that swallows the sample.
+template <typename... Stages>
+class FilterChain;
+
+template <>
+class FilterChain<> {
+public:
+    bool process(float&) { return true; }
+    void reset() {}
+};
+
+template <typename First, typename... Rest>
+class FilterChain<First, Rest...> {
+public:
+    FilterChain() {}
+    explicit FilterChain(const First& first, const Rest&... rest) : first(first), rest(rest...) {}
+
+    bool process(float& value) { return first.process(value) && rest.process(value); }
+
+    void reset() {
+        first.reset();
+        rest.reset();
+    }
+
+private:
+    First first;
+    FilterChain<Rest...> rest;
+};
+
+// The chain the sensing task runs; the trace replayer builds the same one.
+typedef FilterChain<OutlierRejector, SlidingMedian<5>, Kalman1D> SensingFilter;
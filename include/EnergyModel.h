@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// Charge accounting for low-power mode. The board has no current sensor, so
+// each phase is timed and multiplied by a typical supply current for that
+// phase; the results are estimates for comparing configurations, not
+// measurements. The class has no constructor on purpose: it lives in RTC
+// memory and must keep its totals across deep sleep, so call reset() once
+// on a cold boot.
+
+class EnergyModel {
+public:
+    enum Phase : uint8_t { SLEEP, ACTIVE, RADIO, PHASE_COUNT };
+
+    void reset() {
+        memset(chargeNc, 0, sizeof(chargeNc));
+        memset(timeUs, 0, sizeof(timeUs));
+        samples = 0;
+        failedChargeNc = 0;
+        failedAttempts = 0;
+    }
+
+    void add(Phase phase, uint32_t durationUs, uint32_t currentUa) {
+        chargeNc[phase] += (uint64_t)durationUs * currentUa / 1000;
+        timeUs[phase] += durationUs;
+    }
+
+    // Radio time that delivered nothing. It is added to RADIO as usual; this
+    // keeps a separate total of what failed attempts cost.
+    void addFailedAttempt(uint32_t durationUs, uint32_t currentUa) {
+        failedChargeNc += (uint64_t)durationUs * currentUa / 1000;
+        failedAttempts++;
+    }
+
+    uint32_t failedAttemptCount() const { return failedAttempts; }
+    float failedMillijoules(float volts) const { return failedChargeNc * volts * 1e-6f; }
+
+    void countSample() { samples++; }
+    uint32_t sampleCount() const { return samples; }
+
+    uint64_t totalChargeNc() const {
+        uint64_t total = 0;
+        for (uint8_t i = 0; i < PHASE_COUNT; i++) total += chargeNc[i];
+        return total;
+    }
+
+    uint64_t totalTimeUs() const {
+        uint64_t total = 0;
+        for (uint8_t i = 0; i < PHASE_COUNT; i++) total += timeUs[i];
+        return total;
+    }
+
+    float millijoulesPerSample(float volts) const {
+        return samples ? totalChargeNc() * volts * 1e-6f / samples : 0;
+    }
+
+    float averageCurrentUa() const {
+        uint64_t time = totalTimeUs();
+        return time ? (float)totalChargeNc() * 1000 / time : 0;
+    }
+
+    // Share of the charge spent in one phase, 0..1.
+    float share(Phase phase) const {
+        uint64_t total = totalChargeNc();
+        return total ? (float)chargeNc[phase] / total : 0;
+    }
+
+private:
+    uint64_t chargeNc[PHASE_COUNT];
+    uint64_t timeUs[PHASE_COUNT];
+    uint32_t samples;
+    uint64_t failedChargeNc;
+    uint32_t failedAttempts;
+};
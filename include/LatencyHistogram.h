@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// Fixed-bucket duration histogram in microseconds, shaped for Prometheus
+// export. record() is a handful of compares and increments, so it can sit
+// on every pass of a task loop. Each histogram has a single writer; readers
+// on other tasks or the other core copy a consistent snapshot through a
+// sequence counter, the same way DeviceState does.
+
+class LatencyHistogram {
+public:
+    static const uint8_t BOUND_COUNT = 16;   // finite buckets; one more for +Inf
+
+    struct Snapshot {
+        uint32_t buckets[BOUND_COUNT + 1];   // per bucket, not cumulative
+        uint32_t count;
+        uint64_t sumUs;
+        uint32_t maxUs;
+    };
+
+    // Upper bucket bounds, inclusive.
+    static const uint32_t* bounds() {
+        static const uint32_t BOUNDS[BOUND_COUNT] = {
+            10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000,
+            25000, 50000, 100000, 250000, 1000000, 10000000,
+        };
+        return BOUNDS;
+    }
+
+    void record(uint32_t us) {
+        const uint32_t* limits = bounds();
+        uint8_t bucket = 0;
+        while (bucket < BOUND_COUNT && us > limits[bucket]) bucket++;
+
+        sequence.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        data.buckets[bucket]++;
+        data.count++;
+        data.sumUs += us;
+        if (us > data.maxUs) data.maxUs = us;
+        sequence.fetch_add(1, std::memory_order_release);
+    }
+
+    Snapshot snapshot() const {
+        Snapshot out;
+        uint32_t seq;
+        do {
+            seq = sequence.load(std::memory_order_acquire);
+            if (seq & 1) continue;
+            out = data;
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((seq & 1) || seq != sequence.load(std::memory_order_relaxed));
+        return out;
+    }
+
+    // Upper bound of the bucket holding quantile q (0..1); the maximum seen
+    // when that is the +Inf bucket. Good enough for a p99 at a glance.
+    static uint32_t quantileUs(const Snapshot& s, float q) {
+        if (s.count == 0) return 0;
+        uint32_t rank = (uint32_t)(q * s.count + 0.5f);
+        if (rank == 0) rank = 1;
+        uint32_t seen = 0;
+        for (uint8_t i = 0; i < BOUND_COUNT; i++) {
+            seen += s.buckets[i];
+            if (seen >= rank) return bounds()[i] < s.maxUs ? bounds()[i] : s.maxUs;
+        }
+        return s.maxUs;
+    }
+
+private:
+    Snapshot data = {};
+    std::atomic<uint32_t> sequence{0};
+};
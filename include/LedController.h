@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+
+// Auto/manual LED state machine. In auto mode the LED switches on once the
+// target comes within onThresholdCm and only switches off again beyond
+// offThresholdCm, and never sooner than minDwellMs after the last switch.
+// update() and the manual setters return true only on a real transition.
+
+class LedController {
+public:
+    LedController(float onThresholdCm, float offThresholdCm, uint32_t minDwellMs)
+        : onThresholdCm(onThresholdCm), offThresholdCm(offThresholdCm), minDwellMs(minDwellMs) {}
+
+    bool update(float distance, uint32_t nowMs) {
+        if (manual) return false;
+
+        bool wantOn;
+        if (on) {
+            wantOn = distance > 0 && distance <= offThresholdCm;
+        } else {
+            wantOn = distance > 0 && distance <= onThresholdCm;
+        }
+        if (wantOn == on) return false;
+        if (transitions > 0 && nowMs - lastTransitionMs < minDwellMs) return false;
+
+        return setState(wantOn, nowMs);
+    }
+
+    bool setManual(bool turnOn, uint32_t nowMs) {
+        bool modeChanged = !manual;
+        manual = true;
+        return setState(turnOn, nowMs) || modeChanged;
+    }
+
+    bool setAuto() {
+        bool modeChanged = manual;
+        manual = false;
+        return modeChanged;
+    }
+
+    // Puts back state kept elsewhere, e.g. across deep sleep. Not counted as
+    // a transition.
+    void restore(bool wasOn, bool wasManual) {
+        on = wasOn;
+        manual = wasManual;
+    }
+
+    // Same, including the dwell history, e.g. from a trace.
+    void restore(bool wasOn, bool wasManual, uint32_t lastTransitionAtMs, uint32_t transitionCount) {
+        restore(wasOn, wasManual);
+        lastTransitionMs = lastTransitionAtMs;
+        transitions = transitionCount;
+    }
+
+    void setThresholds(float onCm, float offCm) {
+        onThresholdCm = onCm;
+        offThresholdCm = offCm < onCm ? onCm : offCm;
+    }
+
+    bool isOn() const { return on; }
+    bool isManual() const { return manual; }
+    float onThreshold() const { return onThresholdCm; }
+    float offThreshold() const { return offThresholdCm; }
+    uint32_t transitionCount() const { return transitions; }
+    uint32_t lastTransition() const { return lastTransitionMs; }
+
+private:
+    bool setState(bool turnOn, uint32_t nowMs) {
+        if (turnOn == on) return false;
+        on = turnOn;
+        lastTransitionMs = nowMs;
+        transitions++;
+        return true;
+    }
+
+    float onThresholdCm;
+    float offThresholdCm;
+    uint32_t minDwellMs;
+    bool on = false;
+    bool manual = false;
+    uint32_t lastTransitionMs = 0;
+    uint32_t transitions = 0;
+};
@@ -0,0 +1,311 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+
+// Deferred, leveled logging. A LOG_* call copies the format pointer and its
+// arguments into a fixed-size record and pushes it onto a lock-free ring;
+// the text is only formatted when a low-priority task drains the ring, so a
+// producer never blocks on the UART and never runs printf. Levels above
+// LOG_LEVEL compile to nothing, arguments included. Each call site allows a
+// short burst per window and then counts what it drops; the next message
+// that gets through reports the count.
+//
+// Formats must be string literals. Arguments are integers, floats or
+// strings, at most four of them; strings are copied, truncated to what fits
+// in the record.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#ifndef LOG_RATE_BURST
+#define LOG_RATE_BURST 5
+#endif
+#ifndef LOG_RATE_WINDOW_MS
+#define LOG_RATE_WINDOW_MS 10000
+#endif
+
+struct LogRecord {
+    static const uint8_t MAX_ARGS = 4;
+    static const uint8_t TEXT_SIZE = 48;
+    enum ArgType : uint8_t { ARG_INT, ARG_UINT, ARG_FLOAT, ARG_TEXT };
+
+    const char* format;
+    uint32_t timeMs;
+    uint32_t args[MAX_ARGS];
+    ArgType types[MAX_ARGS];
+    uint16_t suppressed;
+    uint8_t level;
+    uint8_t argCount;
+    uint8_t textUsed;
+    char text[TEXT_SIZE];    // string arguments, NUL-separated
+
+    void add(int value) { put(ARG_INT, (uint32_t)value); }
+    void add(long value) { put(ARG_INT, (uint32_t)value); }
+    void add(unsigned value) { put(ARG_UINT, value); }
+    void add(unsigned long value) { put(ARG_UINT, (uint32_t)value); }
+    void add(bool value) { put(ARG_INT, value); }
+    void add(double value) {
+        float narrow = (float)value;
+        uint32_t bits;
+        memcpy(&bits, &narrow, sizeof(bits));
+        put(ARG_FLOAT, bits);
+    }
+    void add(const char* value) {
+        size_t room = TEXT_SIZE - textUsed;
+        size_t length = value ? strlen(value) : 0;
+        if (room == 0) {
+            put(ARG_TEXT, TEXT_SIZE - 1);
+            return;
+        }
+        if (length >= room) length = room - 1;
+        if (length) memcpy(text + textUsed, value, length);
+        text[textUsed + length] = 0;
+        put(ARG_TEXT, textUsed);
+        textUsed += length + 1;
+    }
+
+    static const char* levelName(uint8_t level) {
+        switch (level) {
+            case LOG_LEVEL_ERROR: return "E";
+            case LOG_LEVEL_WARN: return "W";
+            case LOG_LEVEL_INFO: return "I";
+            default: return "D";
+        }
+    }
+
+    // Expands the record into out, one conversion at a time. Returns the
+    // length written.
+    size_t render(char* out, size_t size) const {
+        size_t used = 0;
+        uint8_t next = 0;
+        const char* p = format;
+        while (*p && used + 1 < size) {
+            if (*p != '%') {
+                out[used++] = *p++;
+                continue;
+            }
+            if (p[1] == '%') {
+                out[used++] = '%';
+                p += 2;
+                continue;
+            }
+
+            // Copy the conversion without its length modifier; every stored
+            // value is 32 bits or a double.
+            char spec[16];
+            size_t n = 0;
+            spec[n++] = *p++;
+            while (*p && strchr("-+ #0123456789.hlzjt", *p)) {
+                if (!strchr("hlzjt", *p) && n < sizeof(spec) - 2) spec[n++] = *p;
+                p++;
+            }
+            if (!*p) break;
+            char conversion = *p++;
+            spec[n++] = conversion;
+            spec[n] = 0;
+
+            size_t room = size - used;
+            int written;
+            if (next >= argCount) {
+                written = snprintf(out + used, room, "?");
+            } else if (types[next] == ARG_TEXT) {
+                written = snprintf(out + used, room, conversion == 's' ? spec : "?", text + args[next]);
+            } else if (conversion == 's') {
+                written = snprintf(out + used, room, "?");
+            } else if (types[next] == ARG_FLOAT || strchr("fFeEgGaA", conversion)) {
+                written = snprintf(out + used, room, spec, floatArg(next));
+            } else if (types[next] == ARG_INT) {
+                written = snprintf(out + used, room, spec, (int)args[next]);
+            } else {
+                written = snprintf(out + used, room, spec, (unsigned)args[next]);
+            }
+            next++;
+            if (written > 0) used += (size_t)written < room ? (size_t)written : room - 1;
+        }
+        out[used] = 0;
+        return used;
+    }
+
+private:
+    void put(ArgType type, uint32_t value) {
+        if (argCount == MAX_ARGS) return;
+        types[argCount] = type;
+        args[argCount++] = value;
+    }
+
+    double floatArg(uint8_t index) const {
+        if (types[index] == ARG_INT) return (int32_t)args[index];
+        if (types[index] == ARG_UINT) return args[index];
+        float value;
+        memcpy(&value, &args[index], sizeof(value));
+        return value;
+    }
+};
+
+// Bounded multi-producer, single-consumer ring (Vyukov's sequence-per-slot
+// scheme). Producers claim a slot with one compare-and-swap and never wait;
+// when the ring is full the record is dropped and counted.
+template <size_t N>
+class LogRing {
+    static_assert((N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+    LogRing() {
+        for (size_t i = 0; i < N; i++) slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool push(const LogRecord& record) {
+        uint32_t position = head.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots[position & (N - 1)];
+            int32_t diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - position);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                drops.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+        slot->record = record;
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Single consumer only.
+    bool pop(LogRecord& out) {
+        Slot& slot = slots[tail & (N - 1)];
+        if ((int32_t)(slot.sequence.load(std::memory_order_acquire) - (tail + 1)) < 0) return false;
+        out = slot.record;
+        slot.sequence.store(tail + N, std::memory_order_release);
+        tail++;
+        return true;
+    }
+
+    uint32_t dropped() const { return drops.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        LogRecord record;
+    };
+
+    Slot slots[N];
+    std::atomic<uint32_t> head{0};
+    uint32_t tail = 0;
+    std::atomic<uint32_t> drops{0};
+};
+
+// Per call site rate limit. Every task that reaches the site shares it, so
+// the counters are atomic; a window that rolls over while two tasks log may
+// let a message or two more through, which is fine for a limiter.
+class LogSite {
+public:
+    bool allow(uint32_t nowMs) {
+        uint32_t start = windowStartMs.load(std::memory_order_relaxed);
+        if (nowMs - start >= LOG_RATE_WINDOW_MS &&
+            windowStartMs.compare_exchange_strong(start, nowMs, std::memory_order_relaxed)) {
+            used.store(0, std::memory_order_relaxed);
+        }
+        if (used.fetch_add(1, std::memory_order_relaxed) < LOG_RATE_BURST) return true;
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // What the next message should report; clear it with reported() once
+    // that message is in the ring, so a failed push keeps the count.
+    uint16_t peekSuppressed() const {
+        uint32_t count = suppressed.load(std::memory_order_relaxed);
+        return count > 0xffff ? 0xffff : (uint16_t)count;
+    }
+
+    // Messages dropped in the meantime stay counted.
+    void reported(uint16_t count) {
+        if (count) suppressed.fetch_sub(count, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint32_t> windowStartMs{0};
+    std::atomic<uint32_t> used{0};
+    std::atomic<uint32_t> suppressed{0};
+};
+
+inline void logEncode(LogRecord&) {}
+
+template <typename First, typename... Rest>
+void logEncode(LogRecord& record, First first, Rest... rest) {
+    record.add(first);
+    logEncode(record, rest...);
+}
+
+template <size_t N, typename... Args>
+bool logPush(LogRing<N>& ring, uint8_t level, uint32_t nowMs, uint16_t suppressed, const char* format, Args... args) {
+    static_assert(sizeof...(Args) <= LogRecord::MAX_ARGS, "too many log arguments");
+    LogRecord record;
+    record.format = format;
+    record.timeMs = nowMs;
+    record.suppressed = suppressed;
+    record.level = level;
+    record.argCount = 0;
+    record.textUsed = 0;
+    logEncode(record, args...);
+    return ring.push(record);
+}
+
+// Never called; lets the compiler check each format against its arguments.
+inline void logCheckFormat(const char*, ...) __attribute__((format(printf, 1, 2)));
+inline void logCheckFormat(const char*, ...) {}
+
+// The including file defines LOG_RING (the LogRing instance) and
+// LOG_CLOCK_MS() before using the macros.
+#define LOG_AT(level, ...)                                                                      \
+    do {                                                                                        \
+        static LogSite logSite;                                                                 \
+        uint32_t logNow = LOG_CLOCK_MS();                                                       \
+        if (false) logCheckFormat(__VA_ARGS__);                                                 \
+        if (logSite.allow(logNow)) {                                                            \
+            uint16_t logSuppressed = logSite.peekSuppressed();                                  \
+            if (logPush(LOG_RING, level, logNow, logSuppressed, __VA_ARGS__)) {                 \
+                logSite.reported(logSuppressed);                                                \
+            }                                                                                   \
+        }                                                                                       \
+    } while (0)
+
+// Disabled levels still name their arguments, inside a dead branch, so a
+// variable that only feeds a log line does not trigger unused warnings.
+template <typename... Args>
+inline void logDiscard(const char*, Args...) {}
+#define LOG_OFF(...) do { if (false) logDiscard(__VA_ARGS__); } while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) LOG_OFF(__VA_ARGS__)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) LOG_OFF(__VA_ARGS__)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) LOG_OFF(__VA_ARGS__)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) LOG_OFF(__VA_ARGS__)
+#endif
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Writes a flat JSON or MessagePack object straight into a caller-owned
+// buffer. Numbers are formatted by hand rather than through printf, because
+// newlib's float conversion allocates, so a publish built with this writer
+// never touches the heap. MessagePack needs the field count up front, which
+// is why beginObject() takes it. Objects nest up to MAX_DEPTH deep.
+
+class PayloadWriter {
+public:
+    enum Format : uint8_t { JSON, MSGPACK };
+    static const uint8_t MAX_DEPTH = 4;
+
+    PayloadWriter(uint8_t* buffer, size_t capacity, Format format)
+        : buffer(buffer), capacity(capacity), format(format) {}
+
+    void beginObject(uint8_t fieldCount) {
+        if (format == MSGPACK) {
+            if (fieldCount < 16) {
+                putByte(0x80 | fieldCount);
+            } else {
+                putByte(0xde);
+                putBigEndian(fieldCount, 2);
+            }
+        } else {
+            putByte('{');
+        }
+    }
+
+    // An object as the value of key; close it with endObject().
+    void beginObject(const char* key, uint8_t fieldCount) {
+        writeKey(key);
+        if (depth + 1 >= MAX_DEPTH) {
+            overflow = true;
+            return;
+        }
+        fields[++depth] = 0;
+        beginObject(fieldCount);
+    }
+
+    void endObject() {
+        if (depth == 0) {
+            overflow = true;
+            return;
+        }
+        depth--;
+        if (format == JSON) putByte('}');
+    }
+
+    void add(const char* key, const char* value) {
+        writeKey(key);
+        writeString(value);
+    }
+
+    void add(const char* key, bool value) {
+        writeKey(key);
+        if (format == MSGPACK) {
+            putByte(value ? 0xc3 : 0xc2);
+        } else {
+            putText(value ? "true" : "false");
+        }
+    }
+
+    void add(const char* key, int32_t value) {
+        writeKey(key);
+        if (format == MSGPACK) {
+            if (value >= 0) {
+                writeMsgPackUnsigned(value);
+            } else if (value >= -32) {
+                putByte((uint8_t)(int8_t)value);
+            } else {
+                putByte(0xd2);
+                putBigEndian((uint32_t)value, 4);
+            }
+        } else {
+            if (value < 0) {
+                putByte('-');
+                writeDecimal(0u - (uint32_t)value);
+            } else {
+                writeDecimal(value);
+            }
+        }
+    }
+
+    void add(const char* key, uint32_t value) {
+        writeKey(key);
+        if (format == MSGPACK) {
+            writeMsgPackUnsigned(value);
+        } else {
+            writeDecimal(value);
+        }
+    }
+
+    // JSON output is fixed-point with two decimals, MessagePack is float32.
+    void add(const char* key, float value) {
+        writeKey(key);
+        writeFloat(value);
+    }
+
+    // An array of floats, for readings that come in sets (one per sensor).
+    void add(const char* key, const float* values, uint8_t count) {
+        writeKey(key);
+        if (format == MSGPACK) {
+            if (count < 16) {
+                putByte(0x90 | count);
+            } else {
+                putByte(0xdc);
+                putBigEndian(count, 2);
+            }
+        } else {
+            putByte('[');
+        }
+        for (uint8_t i = 0; i < count; i++) {
+            if (format == JSON && i > 0) putByte(',');
+            writeFloat(values[i]);
+        }
+        if (format == JSON) putByte(']');
+    }
+
+    // Returns the payload length, or 0 if the buffer overflowed or an object
+    // was left open.
+    size_t end() {
+        if (depth != 0) overflow = true;
+        if (format == JSON) {
+            putByte('}');
+            if (used < capacity) buffer[used] = 0;
+            else overflow = true;
+        }
+        return overflow ? 0 : used;
+    }
+
+private:
+    void writeKey(const char* key) {
+        if (format == JSON) {
+            if (fields[depth]++ > 0) putByte(',');
+            writeString(key);
+            putByte(':');
+        } else {
+            writeString(key);
+        }
+    }
+
+    void writeString(const char* value) {
+        size_t length = strlen(value);
+        if (format == MSGPACK) {
+            if (length < 32) {
+                putByte(0xa0 | length);
+            } else if (length < 256) {
+                putByte(0xd9);
+                putByte(length);
+            } else {
+                putByte(0xda);
+                putBigEndian(length, 2);
+            }
+            putBytes(value, length);
+            return;
+        }
+
+        putByte('"');
+        for (size_t i = 0; i < length; i++) {
+            char c = value[i];
+            if (c == '"' || c == '\\') {
+                putByte('\\');
+                putByte(c);
+            } else if ((uint8_t)c < 0x20) {
+                static const char HEX_DIGITS[] = "0123456789abcdef";
+                putText("\\u00");
+                putByte(HEX_DIGITS[c >> 4]);
+                putByte(HEX_DIGITS[c & 0x0f]);
+            } else {
+                putByte(c);
+            }
+        }
+        putByte('"');
+    }
+
+    void writeFloat(float value) {
+        if (format == MSGPACK) {
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            putByte(0xca);
+            putBigEndian(bits, 4);
+            return;
+        }
+
+        if (value != value) {
+            putText("null");
+            return;
+        }
+        if (value < 0) {
+            putByte('-');
+            value = -value;
+        }
+        if (value > 40000000.0f) value = 40000000.0f;
+        uint32_t hundredths = (uint32_t)(value * 100 + 0.5f);
+        writeDecimal(hundredths / 100);
+        putByte('.');
+        putByte('0' + hundredths / 10 % 10);
+        putByte('0' + hundredths % 10);
+    }
+
+    void writeMsgPackUnsigned(uint32_t value) {
+        if (value < 128) {
+            putByte(value);
+        } else if (value < 256) {
+            putByte(0xcc);
+            putByte(value);
+        } else if (value < 65536) {
+            putByte(0xcd);
+            putBigEndian(value, 2);
+        } else {
+            putByte(0xce);
+            putBigEndian(value, 4);
+        }
+    }
+
+    void writeDecimal(uint32_t value) {
+        char digits[10];
+        uint8_t count = 0;
+        do {
+            digits[count++] = '0' + value % 10;
+            value /= 10;
+        } while (value > 0);
+        while (count > 0) putByte(digits[--count]);
+    }
+
+    void putBigEndian(uint32_t value, uint8_t bytes) {
+        while (bytes > 0) {
+            bytes--;
+            putByte(value >> (8 * bytes));
+        }
+    }
+
+    void putText(const char* text) { putBytes(text, strlen(text)); }
+
+    void putBytes(const char* data, size_t length) {
+        if (overflow || length > capacity - used) {
+            overflow = true;
+            return;
+        }
+        memcpy(buffer + used, data, length);
+        used += length;
+    }
+
+    void putByte(uint8_t value) {
+        if (overflow || used >= capacity) {
+            overflow = true;
+            return;
+        }
+        buffer[used++] = value;
+    }
+
+    uint8_t* buffer;
+    size_t capacity;
+    Format format;
+    size_t used = 0;
+    uint8_t fields[MAX_DEPTH] = {};    // keys written so far at each depth
+    uint8_t depth = 0;
+    bool overflow = false;
+};
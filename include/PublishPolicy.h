@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+// Decides when telemetry is worth sending. LED and mode transitions go out
+// immediately, distance changes only once they leave the dead-band (and no
+// faster than minIntervalMs), and a heartbeat caps the silence. The counters
+// include how many messages the old fixed-interval poll would have sent so
+// the reduction can be read straight off the device.
+
+class PublishPolicy {
+public:
+    enum Reason : uint8_t { NONE, STATE_CHANGE, DISTANCE_CHANGE, HEARTBEAT, BATCH, REQUEST, REASON_COUNT };
+
+    struct Counters {
+        uint32_t published[REASON_COUNT];
+        uint32_t failed;
+        uint32_t queued;
+        uint32_t legacyEquivalent;
+    };
+
+    PublishPolicy(float deadbandCm, uint32_t minIntervalMs, uint32_t maxSilenceMs, uint32_t legacyIntervalMs)
+        : deadbandCm(deadbandCm), minIntervalMs(minIntervalMs), maxSilenceMs(maxSilenceMs),
+          legacyIntervalMs(legacyIntervalMs) {}
+
+    Reason evaluate(float distance, bool ledOn, bool manual, uint32_t nowMs) {
+        while (nowMs - lastLegacyTickMs >= legacyIntervalMs) {
+            lastLegacyTickMs += legacyIntervalMs;
+            stats.legacyEquivalent++;
+        }
+
+        if (!hasPublished || ledOn != lastLedOn || manual != lastManual) {
+            return STATE_CHANGE;
+        }
+        if (distanceChanged(distance) && nowMs - lastPublishMs >= minIntervalMs) {
+            return DISTANCE_CHANGE;
+        }
+        if (nowMs - lastPublishMs >= maxSilenceMs) {
+            return HEARTBEAT;
+        }
+        return NONE;
+    }
+
+    // The state evaluate() flagged has been handed off for sending; later
+    // evaluations compare against it whatever the outcome of the send.
+    void commit(float distance, bool ledOn, bool manual, uint32_t nowMs) {
+        hasPublished = true;
+        lastDistance = distance;
+        lastLedOn = ledOn;
+        lastManual = manual;
+        lastPublishMs = nowMs;
+    }
+
+    // The state the last commit() recorded; false if nothing was committed
+    // yet. Feeding it back through commit() recreates the policy elsewhere.
+    bool lastCommitted(float& distance, bool& ledOn, bool& manual, uint32_t& atMs) const {
+        distance = lastDistance;
+        ledOn = lastLedOn;
+        manual = lastManual;
+        atMs = lastPublishMs;
+        return hasPublished;
+    }
+
+    // Outcome counters. These may be updated by the task that does the
+    // sending while another task runs evaluate() and commit().
+    void markPublished(Reason reason, bool ok) {
+        if (ok) {
+            stats.published[reason]++;
+        } else {
+            stats.failed++;
+        }
+    }
+
+    // The sample was stored for later replay instead of being sent now.
+    void markQueued() { stats.queued++; }
+
+    void setDeadband(float cm) { deadbandCm = cm; }
+    void setMinInterval(uint32_t ms) { minIntervalMs = ms; }
+    void setMaxSilence(uint32_t ms) { maxSilenceMs = ms; }
+
+    uint32_t totalPublished() const {
+        uint32_t total = 0;
+        for (uint8_t i = 0; i < REASON_COUNT; i++) total += stats.published[i];
+        return total;
+    }
+
+    uint32_t suppressed() const {
+        uint32_t total = totalPublished() + stats.failed + stats.queued;
+        return stats.legacyEquivalent > total ? stats.legacyEquivalent - total : 0;
+    }
+
+    const Counters& counters() const { return stats; }
+
+    static const char* reasonName(Reason reason) {
+        switch (reason) {
+            case STATE_CHANGE: return "state_change";
+            case DISTANCE_CHANGE: return "distance_change";
+            case HEARTBEAT: return "heartbeat";
+            case BATCH: return "batch";
+            case REQUEST: return "request";
+            default: return "none";
+        }
+    }
+
+private:
+    bool distanceChanged(float distance) const {
+        if ((distance < 0) != (lastDistance < 0)) return true;
+        return fabsf(distance - lastDistance) >= deadbandCm;
+    }
+
+    float deadbandCm;
+    uint32_t minIntervalMs;
+    uint32_t maxSilenceMs;
+    uint32_t legacyIntervalMs;
+
+    bool hasPublished = false;
+    float lastDistance = 0;
+    bool lastLedOn = false;
+    bool lastManual = false;
+    uint32_t lastPublishMs = 0;
+    uint32_t lastLegacyTickMs = 0;
+    Counters stats = {};
+};
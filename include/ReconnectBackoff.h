@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+
+// Exponential backoff with "equal jitter": after n consecutive failures the
+// next attempt waits between half and all of min(maxMs, baseMs * 2^n), so a
+// fleet that lost the broker together does not reconnect in lockstep.
+
+class ReconnectBackoff {
+public:
+    ReconnectBackoff(uint32_t baseMs, uint32_t maxMs) : baseMs(baseMs), maxMs(maxMs) {}
+
+    bool due(uint32_t nowMs) const { return (int32_t)(nowMs - nextAttemptMs) >= 0; }
+
+    // Schedules the next attempt; random can be any 32-bit random value.
+    void onFailure(uint32_t nowMs, uint32_t random) {
+        currentDelayMs = delayAfter(failures, baseMs, maxMs, random);
+        failures++;
+        nextAttemptMs = nowMs + currentDelayMs;
+    }
+
+    // The wait after `failures` earlier failures, in whatever unit base and
+    // max are given in; low-power mode counts wakes rather than milliseconds.
+    static uint32_t delayAfter(uint32_t failures, uint32_t base, uint32_t max, uint32_t random) {
+        uint32_t window = base;
+        for (uint32_t i = 0; i < failures && window < max; i++) window *= 2;
+        if (window > max) window = max;
+        return window / 2 + random % (window / 2 + 1);
+    }
+
+    void onSuccess() {
+        failures = 0;
+        currentDelayMs = 0;
+    }
+
+    // First attempt after a dropped connection: one base interval, jittered.
+    void restart(uint32_t nowMs, uint32_t random) {
+        failures = 0;
+        onFailure(nowMs, random);
+        failures = 0;
+    }
+
+    uint32_t failureCount() const { return failures; }
+    uint32_t currentDelay() const { return currentDelayMs; }
+    void setLimits(uint32_t base, uint32_t max) {
+        baseMs = base;
+        maxMs = max;
+    }
+
+private:
+    uint32_t baseMs;
+    uint32_t maxMs;
+    uint32_t failures = 0;
+    uint32_t currentDelayMs = 0;
+    uint32_t nextAttemptMs = 0;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Client.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/x509_crt.h>
+#include <mbedtls/pk.h>
+
+// TLS client for PubSubClient that keeps what WiFiClientSecure throws away
+// between connections: the parsed CA, client certificate and key, the RNG
+// and the SSL context are set up once and reused, and the negotiated session
+// (ID or ticket) is saved to RTC memory and offered again on the next
+// connect, so a reconnect, even after deep sleep, can skip the RSA/ECDHE
+// work when the broker supports resumption.
+
+struct TlsConnectStats {
+    uint32_t tcpMs;
+    uint32_t handshakeMs;
+    uint32_t freeHeapBefore;
+    uint32_t minFreeHeap;       // lowest free heap seen during this handshake
+    uint32_t freeHeapAfter;     // with the connection up
+    bool offeredSession;
+    bool resumed;
+    int error;
+    uint16_t sessionBytes;      // saved for the next connect, 0 if none was
+    int sessionSaveError;       // why not, e.g. MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL
+};
+
+class ResumableTlsClient : public Client {
+public:
+    ResumableTlsClient();
+    ~ResumableTlsClient();
+
+    void setCredentials(const char* caCert, const char* clientCert, const char* privateKey);
+    // Takes effect on the next connect().
+    void setHandshakeTimeout(uint32_t ms) { handshakeTimeoutMs = ms; }
+    void forgetSession();
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override {}
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+
+    const TlsConnectStats& lastConnect() const { return stats; }
+    uint32_t connectCount() const { return connects; }
+    uint32_t resumedCount() const { return resumptions; }
+    uint32_t sessionSaveFailureCount() const { return sessionSaveFailures; }
+
+private:
+    bool setup();
+    bool fillReceiveBuffer();
+
+    const char* caCert = nullptr;
+    const char* clientCert = nullptr;
+    const char* privateKey = nullptr;
+    uint32_t handshakeTimeoutMs = 10000;
+
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_x509_crt caChain;
+    mbedtls_x509_crt ownCert;
+    mbedtls_pk_context ownKey;
+    mbedtls_ssl_config conf;
+    mbedtls_ssl_context ssl;
+    mbedtls_net_context socket;
+
+    bool ready = false;
+    bool open = false;
+
+    uint8_t rxBuffer[256];
+    size_t rxLength = 0;
+    size_t rxPosition = 0;
+
+    TlsConnectStats stats = {};
+    uint32_t connects = 0;
+    uint32_t resumptions = 0;
+    uint32_t sessionSaveFailures = 0;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "DeviceConfig.h"
+#include "DistanceFilter.h"
+#include "LedController.h"
+#include "PublishPolicy.h"
+#include "SensorArray.h"
+
+// The decisions the sensing task makes: what a raw reading does to the
+// filtered distances, the batch row and the LED, and what gets handed to the
+// network task after a pass. main.cpp's sensing task and tools/TraceReplay.h
+// both run this class, so a replayed trace goes through the device's own
+// rules; each side keeps only its I/O (queues, GPIO and logging on the
+// device, trace lines and recorded outputs in the replay).
+//
+// The LED controller and the publish policy belong to the caller, because
+// other parts of the firmware read them too.
+
+template <uint8_t MAX_SENSORS>
+class SensingPipeline {
+public:
+    // What one raw reading changed.
+    struct Step {
+        bool accepted;       // passed the filter and updated the distances
+        bool rowComplete;    // every sensor has reported since the last row
+        bool ledChanged;
+    };
+
+    SensingPipeline(LedController& led, PublishPolicy& policy, uint8_t sensorCount)
+        : led(led), policy(policy), sensors(sensorCount) {}
+
+    // Filters the reading of one sensor and lets the LED follow the nearest
+    // target. A batch row is one round of the array rather than one sample,
+    // so rows do not repeat readings that have not changed.
+    Step addSample(uint8_t sensor, float raw, uint32_t now) {
+        Step step = {false, false, false};
+        float filtered = raw;
+        if (sensor >= sensors || !filters[sensor].process(filtered)) return step;
+        step.accepted = true;
+        sensorDistance[sensor] = filtered;
+        distance = nearestReading(sensorDistance, sensors);
+
+        const uint32_t allSensors = (1u << sensors) - 1;
+        rowSensors |= 1u << sensor;
+        if (rowSensors == allSensors) {
+            rowSensors = 0;
+            step.rowComplete = true;
+        }
+        step.ledChanged = led.update(distance, now);
+        return step;
+    }
+
+    // A full batch goes to the network task once it is done with the
+    // previous one. It publishes the batch or, with the cloud down, keeps it
+    // in the offline queue; until then the full batch waits.
+    static bool canHandOffBatch(bool batchInFlight) { return !batchInFlight; }
+
+    // Whether the current reading should be sent on its own. While batching
+    // only state changes are; the batch carries the rest, live or replayed.
+    PublishPolicy::Reason evaluate(bool batching, uint32_t now) {
+        PublishPolicy::Reason reason = policy.evaluate(distance, led.isOn(), led.isManual(), now);
+        if (batching && reason != PublishPolicy::STATE_CHANGE) return PublishPolicy::NONE;
+        return reason;
+    }
+
+    // Records that the current reading was handed over.
+    void commit(uint32_t now) { policy.commit(distance, led.isOn(), led.isManual(), now); }
+
+    // LED thresholds and the publish policy; the ranging rate is the caller's.
+    void applyConfig(const DeviceConfig& config) {
+        led.setThresholds(config.thresholdCm, config.thresholdCm + config.hysteresisCm);
+        policy.setDeadband(config.deadbandCm);
+        policy.setMinInterval(config.minPublishIntervalMs);
+        policy.setMaxSilence(config.heartbeatMs);
+    }
+
+    // Starts the filters and the batch row afresh, as a trace does.
+    void reset() {
+        for (uint8_t i = 0; i < MAX_SENSORS; i++) filters[i].reset();
+        rowSensors = 0;
+    }
+
+    void setSensorCount(uint8_t count) {
+        sensors = count;
+        reset();
+    }
+
+    uint8_t sensorCount() const { return sensors; }
+
+    // Latest filtered reading of each sensor, and the nearest of them, which
+    // is what the LED and the publish policy follow.
+    float distance = 0;
+    float sensorDistance[MAX_SENSORS] = {};
+
+private:
+    LedController& led;
+    PublishPolicy& policy;
+    SensingFilter filters[MAX_SENSORS];
+    uint8_t sensors;
+    uint32_t rowSensors = 0;
+};
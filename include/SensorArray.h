@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+// Helpers for driving several HC-SR04s from one board.
+//
+// TriggerScheduler time-multiplexes the triggers so no sensor listens while
+// another one's ping can still reach it. Sensors are grouped into slots:
+// sensors sharing a slot fire together, so only put sensors in one slot if
+// they cannot hear each other (facing away from each other, or far apart).
+// Slots take turns. A slot ends as soon as every sensor in it has its echo,
+// or the slot timeout passes, plus a guard time for late reflections. The
+// cycle therefore follows the actual distances, not the worst case. No slot
+// fires more often than once per minimum period, which is the per-sensor
+// sample rate. poll() runs from a periodic timer interrupt and returns the
+// sensors to trigger now, one bit per sensor.
+
+template <uint8_t N>
+class TriggerScheduler {
+    static_assert(N >= 1 && N <= 32, "one bit per sensor");
+
+public:
+    TriggerScheduler(uint32_t slotTimeoutUs, uint32_t guardUs) : slotTimeoutUs(slotTimeoutUs), guardUs(guardUs) {
+        for (uint8_t i = 0; i < N; i++) slotMasks[i] = 1u << i;
+        slotCount = N;
+    }
+
+    // slotOf[i] is the slot of sensor i; slot numbers need not be contiguous.
+    void setSlots(const uint8_t (&slotOf)[N]) {
+        uint8_t ids[N];
+        slotCount = 0;
+        for (uint8_t i = 0; i < N; i++) {
+            uint8_t s = 0;
+            while (s < slotCount && ids[s] != slotOf[i]) s++;
+            if (s == slotCount) {
+                ids[slotCount] = slotOf[i];
+                slotMasks[slotCount++] = 0;
+            }
+            slotMasks[s] |= 1u << i;
+        }
+        slot = 0;
+        activeMask = 0;
+    }
+
+    void setMinPeriod(uint32_t us) { minPeriodUs = us; }
+
+    // busy has a bit set for every sensor still waiting for its echo.
+    uint32_t IRAM_ATTR poll(uint32_t nowUs, uint32_t busy) {
+        if (activeMask) {
+            if ((busy & activeMask) && nowUs - slotStartUs < slotTimeoutUs) return 0;
+            if (!settling) {
+                settling = true;
+                settleStartUs = nowUs;
+            }
+            if (nowUs - settleStartUs < guardUs) return 0;
+            activeMask = 0;
+            settling = false;
+            if (++slot == slotCount) {
+                slot = 0;
+                lastCycleUs = nowUs - cycleStartUs;
+                cycleStartUs = nowUs;
+            }
+        }
+
+        if (fired[slot] && (int32_t)(nowUs - dueUs[slot]) < 0) return 0;
+        // Stay on the period grid unless we have fallen a whole period behind.
+        dueUs[slot] = fired[slot] && (int32_t)(nowUs - dueUs[slot]) < (int32_t)minPeriodUs ? dueUs[slot] + minPeriodUs
+                                                                                          : nowUs + minPeriodUs;
+        fired[slot] = true;
+        activeMask = slotMasks[slot];
+        slotStartUs = nowUs;
+        return activeMask;
+    }
+
+    // Time for every slot to take its turn once, 0 until one cycle finished.
+    uint32_t cycleUs() const { return lastCycleUs; }
+
+    // How often each sensor fires: the minimum period, or the whole cycle
+    // when the slots take longer than that between them.
+    uint32_t sensorPeriodUs() const {
+        uint32_t cycle = lastCycleUs;
+        return cycle > minPeriodUs ? cycle : minPeriodUs;
+    }
+    uint8_t slots() const { return slotCount; }
+
+private:
+    const uint32_t slotTimeoutUs;
+    const uint32_t guardUs;
+    volatile uint32_t minPeriodUs = 0;
+    uint32_t slotMasks[N];
+    uint32_t dueUs[N] = {};
+    bool fired[N] = {};
+    uint8_t slotCount;
+    uint8_t slot = 0;
+    uint32_t activeMask = 0;
+    uint32_t slotStartUs = 0;
+    bool settling = false;
+    uint32_t settleStartUs = 0;
+    uint32_t cycleStartUs = 0;
+    volatile uint32_t lastCycleUs = 0;
+};
+
+// The reading that drives the LED and the publish policy: the nearest
+// target any sensor sees, or -1 when none sees one.
+inline float nearestReading(const float* distances, size_t count) {
+    float nearest = -1;
+    for (size_t i = 0; i < count; i++) {
+        if (distances[i] > 0 && (nearest < 0 || distances[i] < nearest)) nearest = distances[i];
+    }
+    return nearest;
+}
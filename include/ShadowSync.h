@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Device side of an AWS IoT Device Shadow. Reported fields are held as
+// integers; set() marks a field dirty only when its value actually changes,
+// so an update carries just the fields the service does not have yet. The
+// version of the last desired state applied is kept so a duplicate or
+// out-of-order delta is ignored. Desired values that were applied, or that a
+// local change overrode, are deleted from the shadow with the next update;
+// left in place, they would come back as a delta on the next connect and
+// undo the local change.
+
+template <size_t N>
+class ShadowSync {
+    static_assert(N <= 32, "dirty flags are a 32-bit mask");
+
+public:
+    void set(size_t field, uint32_t value) {
+        uint32_t bit = 1u << field;
+        if ((known & bit) && values[field] == value) return;
+        values[field] = value;
+        known |= bit;
+        dirty |= bit;
+    }
+
+    uint32_t value(size_t field) const { return values[field]; }
+
+    // Fields changed since the last successful report.
+    uint32_t pending() const { return dirty; }
+
+    void markReported(uint32_t mask) { dirty &= ~mask; }
+
+    // Sends desired: null for these fields with the next update, and
+    // reports their current value alongside.
+    void clearDesired(uint32_t mask) {
+        clearing |= mask;
+        dirty |= mask & known;
+    }
+
+    uint32_t pendingClears() const { return clearing; }
+
+    void markCleared(uint32_t mask) { clearing &= ~mask; }
+
+    // The service may have missed updates while we were away; report
+    // everything again on the next update.
+    void resync() { dirty = known; }
+
+    // A delta from /shadow/update/delta. False if it is not newer than the
+    // last one applied.
+    bool acceptDelta(uint32_t version) {
+        if (hasVersion && (int32_t)(version - lastVersion) <= 0) return false;
+        lastVersion = version;
+        hasVersion = true;
+        return true;
+    }
+
+    // A full document from /shadow/get/accepted is authoritative, even if
+    // its version went backwards because the shadow was deleted.
+    void resetVersion(uint32_t version) {
+        lastVersion = version;
+        hasVersion = true;
+    }
+
+    uint32_t version() const { return lastVersion; }
+
+private:
+    uint32_t values[N] = {};
+    uint32_t known = 0;
+    uint32_t dirty = 0;
+    uint32_t clearing = 0;
+    uint32_t lastVersion = 0;
+    bool hasVersion = false;
+};
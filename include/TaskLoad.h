@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// Per-task CPU accounting. The Arduino core builds FreeRTOS without run-time
+// stats, so each task brackets its work with begin()/end() and a reporter
+// turns the busy time into a load figure. end() and sample() may run on
+// different tasks; the busy total is the only shared value.
+
+class TaskLoad {
+public:
+    void begin(uint32_t nowUs) { startUs = nowUs; }
+
+    void end(uint32_t nowUs) { busyUs.fetch_add(nowUs - startUs, std::memory_order_relaxed); }
+
+    // Busy share of the wall time since the previous call, in tenths of a percent.
+    uint16_t sample(uint32_t nowUs) {
+        uint32_t busy = busyUs.load(std::memory_order_relaxed);
+        uint32_t elapsed = nowUs - lastSampleUs;
+        uint32_t worked = busy - lastBusyUs;
+        lastSampleUs = nowUs;
+        lastBusyUs = busy;
+        if (elapsed == 0) return 0;
+        uint64_t permille = (uint64_t)worked * 1000 / elapsed;
+        return permille > 1000 ? 1000 : (uint16_t)permille;
+    }
+
+private:
+    uint32_t startUs = 0;
+    std::atomic<uint32_t> busyUs{0};
+    uint32_t lastSampleUs = 0;
+    uint32_t lastBusyUs = 0;
+};
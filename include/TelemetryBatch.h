@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Accumulates N samples and encodes them column-wise: one base timestamp,
+// a column of millisecond deltas, a column of distances in millimetres
+// (-1 for no target) and the LED state as a hex bitmap. Static metadata is
+// left out on purpose; it travels once in the connect message. With S > 1
+// sensors every row also carries each sensor's reading, encoded as one more
+// column per sensor under "s", so a whole array still goes out as one message.
+
+template <size_t N, size_t S = 1>
+class TelemetryBatch {
+public:
+    bool add(uint32_t timestampMs, float distance, bool ledOn, const float* sensors = nullptr) {
+        if (count == N) return false;
+        if (count == 0) baseMs = timestampMs;
+        deltaMs[count] = timestampMs - baseMs;
+        distanceMm[count] = toMm(distance);
+        for (size_t s = 0; S > 1 && s < S; s++) {
+            sensorMm[s][count] = sensors ? toMm(sensors[s]) : -1;
+        }
+        if (count % 8 == 0) ledBits[count / 8] = 0;
+        if (ledOn) ledBits[count / 8] |= 1 << (count % 8);
+        count++;
+        return true;
+    }
+
+    bool full() const { return count == N; }
+    size_t size() const { return count; }
+    uint32_t baseTimestamp() const { return baseMs; }
+    void clear() { count = 0; }
+
+    // Row i as stored: the distance is rounded to the millimetre, like the
+    // encoded batch.
+    uint32_t timestampAt(size_t i) const { return baseMs + deltaMs[i]; }
+    float distanceAt(size_t i) const { return distanceMm[i] < 0 ? -1 : distanceMm[i] / 10.0f; }
+    bool ledAt(size_t i) const { return ledBits[i / 8] & (1 << (i % 8)); }
+
+    // Returns the encoded length, or 0 if the buffer was too small.
+    size_t encodeJson(char* out, size_t capacity, uint32_t epoch) const {
+        Writer w(out, capacity);
+        w.print("{\"t0\":%lu,\"epoch\":%lu,\"n\":%u,\"dt\":[", (unsigned long)baseMs, (unsigned long)epoch, (unsigned)count);
+        uint32_t previous = 0;
+        for (size_t i = 0; i < count; i++) {
+            w.print(i ? ",%lu" : "%lu", (unsigned long)(deltaMs[i] - previous));
+            previous = deltaMs[i];
+        }
+        w.append("],\"d\":[");
+        for (size_t i = 0; i < count; i++) {
+            w.print(i ? ",%d" : "%d", distanceMm[i]);
+        }
+        if (S > 1) {
+            w.append("],\"s\":[");
+            for (size_t s = 0; s < S; s++) {
+                w.append(s ? ",[" : "[");
+                for (size_t i = 0; i < count; i++) {
+                    w.print(i ? ",%d" : "%d", sensorMm[s][i]);
+                }
+                w.append("]");
+            }
+        }
+        w.append("],\"led\":\"");
+        for (size_t i = 0; i < (count + 7) / 8; i++) {
+            w.print("%02x", ledBits[i]);
+        }
+        w.append("\"}");
+        return w.ok() ? w.length() : 0;
+    }
+
+private:
+    static int16_t toMm(float distance) { return distance < 0 ? -1 : (int16_t)(distance * 10 + 0.5f); }
+
+    class Writer {
+    public:
+        Writer(char* buffer, size_t capacity) : buffer(buffer), capacity(capacity) {}
+
+        template <typename... Args>
+        void print(const char* format, Args... args) {
+            if (overflow) return;
+            int n = snprintf(buffer + used, capacity - used, format, args...);
+            if (n < 0 || (size_t)n >= capacity - used) {
+                overflow = true;
+                return;
+            }
+            used += n;
+        }
+
+        void append(const char* text) {
+            size_t n = strlen(text);
+            if (overflow || n >= capacity - used) {
+                overflow = true;
+                return;
+            }
+            memcpy(buffer + used, text, n + 1);
+            used += n;
+        }
+
+        bool ok() const { return !overflow; }
+        size_t length() const { return used; }
+
+    private:
+        char* buffer;
+        size_t capacity;
+        size_t used = 0;
+        bool overflow = false;
+    };
+
+    uint32_t baseMs = 0;
+    uint32_t deltaMs[N];
+    int16_t distanceMm[N];
+    int16_t sensorMm[S > 1 ? S : 1][S > 1 ? N : 1];
+    uint8_t ledBits[(N + 7) / 8];
+    size_t count = 0;
+};
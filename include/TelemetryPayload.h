@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "PayloadWriter.h"
+
+// The per-sample telemetry message, the single acknowledgment and the metrics
+// summary, laid out the way main.cpp publishes them. They live here rather
+// than next to the MQTT code so host tests and benchmarks encode exactly what
+// the device sends. All write into the caller's buffer and return the length,
+// or 0 if it was too small.
+
+struct TelemetryFields {
+    const char* deviceId;
+    float distance;
+    const float* sensors;      // one reading per sensor; sent when sensorCount > 1
+    uint8_t sensorCount;
+    bool ledOn;
+    bool manual;
+    int32_t wifiRssi;
+    uint32_t uptimeS;
+    const char* ipAddress;
+    uint32_t timestampMs;
+    const char* reason;
+    uint32_t schema;
+};
+
+inline size_t writeTelemetryPayload(uint8_t* buffer, size_t size, PayloadWriter::Format format,
+                                    const TelemetryFields& fields) {
+    bool array = fields.sensorCount > 1;
+    PayloadWriter writer(buffer, size, format);
+    writer.beginObject(10 + array);
+    writer.add("device_id", fields.deviceId);
+    writer.add("distance", fields.distance);
+    if (array) writer.add("sensors", fields.sensors, fields.sensorCount);
+    writer.add("led_status", fields.ledOn ? "ON" : "OFF");
+    writer.add("manual_mode", fields.manual);
+    writer.add("wifi_rssi", fields.wifiRssi);
+    writer.add("uptime", fields.uptimeS);
+    writer.add("ip_address", fields.ipAddress);
+    writer.add("timestamp", fields.timestampMs);
+    writer.add("reason", fields.reason);
+    writer.add("schema", fields.schema);
+    return writer.end();
+}
+
+// id may be empty, in which case correlation_id is left out.
+inline size_t writeAckPayload(uint8_t* buffer, size_t size, PayloadWriter::Format format, const char* deviceId,
+                              const char* command, const char* status, const char* id, uint32_t timestampMs,
+                              uint32_t schema) {
+    PayloadWriter writer(buffer, size, format);
+    writer.beginObject(id[0] ? 6 : 5);
+    writer.add("device_id", deviceId);
+    writer.add("command", command);
+    writer.add("status", status);
+    if (id[0]) writer.add("correlation_id", id);
+    writer.add("timestamp", timestampMs);
+    writer.add("schema", schema);
+    return writer.end();
+}
+
+// One latency histogram as the metrics message reports it.
+struct StageSummary {
+    uint32_t count;
+    uint32_t avgUs;
+    uint32_t p99Us;
+    uint32_t maxUs;
+};
+
+struct MetricsFields {
+    const char* deviceId;
+    uint32_t uptimeS;
+    uint32_t heapFree;
+    uint32_t heapMinFree;
+    uint32_t heapMaxAlloc;
+    uint32_t published;
+    uint32_t publishFailed;
+    uint32_t queued;
+    uint32_t connects;
+    uint32_t connectFailures;
+    const char* const* stageNames;
+    const StageSummary* stages;    // one per name
+    uint8_t stageCount;
+    StageSummary sampleJitter;
+    StageSummary awsConnect;
+    uint32_t schema;
+};
+
+inline void addStageSummary(PayloadWriter& writer, const char* key, const StageSummary& summary) {
+    writer.beginObject(key, 4);
+    writer.add("n", summary.count);
+    writer.add("avg_us", summary.avgUs);
+    writer.add("p99_us", summary.p99Us);
+    writer.add("max_us", summary.maxUs);
+    writer.endObject();
+}
+
+inline size_t writeMetricsPayload(uint8_t* buffer, size_t size, PayloadWriter::Format format,
+                                  const MetricsFields& fields) {
+    PayloadWriter writer(buffer, size, format);
+    writer.beginObject(14);
+    writer.add("device_id", fields.deviceId);
+    writer.add("uptime", fields.uptimeS);
+    writer.add("heap_free", fields.heapFree);
+    writer.add("heap_min_free", fields.heapMinFree);
+    writer.add("heap_max_alloc", fields.heapMaxAlloc);
+    writer.add("published", fields.published);
+    writer.add("publish_failed", fields.publishFailed);
+    writer.add("queued", fields.queued);
+    writer.add("connects", fields.connects);
+    writer.add("connect_failures", fields.connectFailures);
+    writer.beginObject("stages", fields.stageCount);
+    for (uint8_t i = 0; i < fields.stageCount; i++) addStageSummary(writer, fields.stageNames[i], fields.stages[i]);
+    writer.endObject();
+    addStageSummary(writer, "sample_jitter", fields.sampleJitter);
+    addStageSummary(writer, "aws_connect", fields.awsConnect);
+    writer.add("schema", fields.schema);
+    return writer.end();
+}
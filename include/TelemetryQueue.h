@@ -0,0 +1,213 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Persistent store-and-forward queue for telemetry captured while the cloud
+// is unreachable. Records are fixed 16-byte frames in a log file and the
+// replay position lives in a separate 8-byte cursor file; once everything has
+// been replayed both files are deleted. New frames are written at the offset
+// of the last complete frame rather than appended, so a partial frame left by
+// a short write or a power cut is overwritten by the next flush instead of
+// shifting every frame after it. It only uses stdio, which on the ESP32 goes
+// through the LittleFS VFS mount and on the host through a plain directory.
+
+struct QueuedSample {
+    uint32_t epoch;        // seconds since 1970, 0 if NTP was never synced
+    uint32_t uptimeMs;
+    float distance;
+    bool ledOn;
+    bool manual;
+};
+
+class TelemetryQueue {
+public:
+    static const size_t RECORD_SIZE = 16;
+    static const size_t STAGING_SIZE = 8;
+
+    TelemetryQueue(const char* logPath, const char* cursorPath, uint32_t capacity)
+        : logPath(logPath), cursorPath(cursorPath), capacity(capacity) {}
+
+    bool begin() {
+        // A partial frame at the end does not count; the next flush
+        // overwrites it.
+        stored = completeRecords();
+
+        cursor = 0;
+        FILE* f = fopen(cursorPath, "rb");
+        if (f) {
+            uint8_t raw[8];
+            if (fread(raw, 1, sizeof(raw), f) == sizeof(raw) && readU32(raw + 4) == (readU32(raw) ^ CURSOR_MAGIC)) {
+                cursor = readU32(raw);
+            }
+            fclose(f);
+        }
+        if (cursor > stored) cursor = stored;
+        return true;
+    }
+
+    bool push(const QueuedSample& sample) {
+        if (pending() >= capacity) {
+            dropped++;
+            return false;
+        }
+        staging[staged++] = sample;
+        if (staged == STAGING_SIZE) return flush();
+        return true;
+    }
+
+    bool flush() {
+        if (staged == 0) return true;
+
+        FILE* f = fopen(logPath, "r+b");
+        if (!f) f = fopen(logPath, "wb");
+        if (!f) return false;
+
+        uint8_t frame[RECORD_SIZE];
+        size_t written = 0;
+        if (fseek(f, (long)stored * RECORD_SIZE, SEEK_SET) == 0) {
+            for (; written < staged; written++) {
+                encode(staging[written], frame);
+                if (fwrite(frame, 1, RECORD_SIZE, f) != RECORD_SIZE) break;
+            }
+        }
+        // stdio buffers the frames, so a full file often only shows up here.
+        // Keep what really reached the file.
+        if (fclose(f) != 0 || written < staged) {
+            uint32_t complete = completeRecords();
+            if (complete < stored + written) written = complete > stored ? complete - stored : 0;
+        }
+
+        stored += written;
+        if (written < staged) {
+            dropped += staged - written;
+        }
+        staged = 0;
+        return written > 0;
+    }
+
+    // Reads up to max pending records without consuming them. Frames that
+    // fail their CRC (torn writes after a power loss) are skipped.
+    size_t peek(QueuedSample* out, size_t max) {
+        flush();
+
+        FILE* f = fopen(logPath, "rb");
+        if (!f) return 0;
+        fseek(f, (long)cursor * RECORD_SIZE, SEEK_SET);
+
+        size_t count = 0;
+        peekSpan = 0;
+        uint8_t frame[RECORD_SIZE];
+        while (count < max && cursor + peekSpan < stored && fread(frame, 1, RECORD_SIZE, f) == RECORD_SIZE) {
+            peekSpan++;
+            if (decode(frame, out[count])) {
+                count++;
+            } else {
+                corrupt++;
+            }
+        }
+        fclose(f);
+        return count;
+    }
+
+    // Drops everything returned by the last peek().
+    void consume() {
+        cursor += peekSpan;
+        peekSpan = 0;
+
+        if (cursor >= stored && staged == 0) {
+            remove(logPath);
+            remove(cursorPath);
+            cursor = 0;
+            stored = 0;
+            return;
+        }
+
+        FILE* f = fopen(cursorPath, "wb");
+        if (!f) return;
+        uint8_t raw[8];
+        writeU32(raw, cursor);
+        writeU32(raw + 4, cursor ^ CURSOR_MAGIC);
+        fwrite(raw, 1, sizeof(raw), f);
+        fclose(f);
+    }
+
+    uint32_t pending() const { return stored - cursor + staged; }
+    uint32_t droppedCount() const { return dropped; }
+    uint32_t corruptCount() const { return corrupt; }
+
+private:
+    static const uint32_t CURSOR_MAGIC = 0x51554555;
+
+    uint32_t completeRecords() const {
+        FILE* f = fopen(logPath, "rb");
+        if (!f) return 0;
+        fseek(f, 0, SEEK_END);
+        long bytes = ftell(f);
+        fclose(f);
+        return bytes > 0 ? bytes / RECORD_SIZE : 0;
+    }
+
+    static void writeU32(uint8_t* p, uint32_t v) {
+        p[0] = v;
+        p[1] = v >> 8;
+        p[2] = v >> 16;
+        p[3] = v >> 24;
+    }
+
+    static uint32_t readU32(const uint8_t* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    static uint16_t crc16(const uint8_t* data, size_t len) {
+        uint16_t crc = 0xFFFF;
+        for (size_t i = 0; i < len; i++) {
+            crc ^= (uint16_t)data[i] << 8;
+            for (uint8_t b = 0; b < 8; b++) {
+                crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+            }
+        }
+        return crc;
+    }
+
+    static void encode(const QueuedSample& sample, uint8_t* frame) {
+        uint32_t bits;
+        memcpy(&bits, &sample.distance, sizeof(bits));
+        writeU32(frame, sample.epoch);
+        writeU32(frame + 4, sample.uptimeMs);
+        writeU32(frame + 8, bits);
+        frame[12] = (sample.ledOn ? 0x01 : 0) | (sample.manual ? 0x02 : 0);
+        frame[13] = 0;
+        uint16_t crc = crc16(frame, 14);
+        frame[14] = crc;
+        frame[15] = crc >> 8;
+    }
+
+    static bool decode(const uint8_t* frame, QueuedSample& sample) {
+        uint16_t crc = frame[14] | (frame[15] << 8);
+        if (crc != crc16(frame, 14)) return false;
+
+        uint32_t bits = readU32(frame + 8);
+        sample.epoch = readU32(frame);
+        sample.uptimeMs = readU32(frame + 4);
+        memcpy(&sample.distance, &bits, sizeof(bits));
+        sample.ledOn = frame[12] & 0x01;
+        sample.manual = frame[12] & 0x02;
+        return true;
+    }
+
+    const char* logPath;
+    const char* cursorPath;
+    uint32_t capacity;
+
+    uint32_t stored = 0;
+    uint32_t cursor = 0;
+    uint32_t peekSpan = 0;
+    uint32_t dropped = 0;
+    uint32_t corrupt = 0;
+
+    QueuedSample staging[STAGING_SIZE];
+    size_t staged = 0;
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Record-and-replay trace of the sensing task: everything that goes into its
+// decisions and everything that comes out, so tools/TraceReplay.h can run
+// the same headers over a field recording and diff the results. Events are
+// captured as fixed-size records (no formatting on the sensing task) and
+// written out as one text line each, "<millis> <kind> <fields...>":
+//
+//   H <version> <LED dwell ms> <batch size> <sensors>
+//                                                trace start
+//   K <key> <value>                              setting at start, one per field
+//   X <on> <manual> <last transition ms> <count> LED controller at start
+//   Y <sent> <distance> <on> <manual> <ms> <current distance> <batch fill>
+//                                                publish policy at start
+//   R <sensor> <distance>                        sensor reading at start, one each
+//   N <cloud ready> <batching> <batch in flight> link state, when it changes
+//   S <raw cm> <sensor>                          ranger sample, before filtering
+//   C <source> <name> [<arg> [<arg>]]            command as executed (c/w/s)
+//   T                                            publish decision point
+//   L <on> <manual>                              LED or mode change       (output)
+//   P <reason> <distance>                        telemetry handed off     (output)
+//   A <name> <status>                            command result           (output)
+//   E <events dropped>                           trace end
+//
+// Times are the device's millis(), distances use %.9g so floats round-trip
+// exactly. Version 1 traces come from single-sensor firmware and have no
+// sensor count, R lines or sensor index. Names and statuses are static
+// strings on the device, so records only keep the pointer.
+
+struct TraceEvent {
+    static const uint32_t VERSION = 2;
+    static const size_t TEXT_SIZE = 48;
+
+    uint32_t timeMs;
+    char kind;
+    uint8_t flags;           // L/N/X/Y: booleans, bit 0 first; C: source letter; H: sensors
+    float value;
+    float extra;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    const char* name;
+    const char* detail;
+    char text[TEXT_SIZE];    // C: arguments, space-separated
+
+    bool flag(uint8_t bit) const { return (flags >> bit) & 1; }
+
+    // Returns the line length without the newline, or -1 if it did not fit.
+    int format(char* out, size_t size) const {
+        int n;
+        switch (kind) {
+            case 'H':
+                n = snprintf(out, size, "%u H %u %u %u %u", (unsigned)timeMs, (unsigned)a, (unsigned)b, (unsigned)c,
+                             (unsigned)flags);
+                break;
+            case 'K': n = snprintf(out, size, "%u K %s %u", (unsigned)timeMs, name, (unsigned)a); break;
+            case 'X':
+                n = snprintf(out, size, "%u X %d %d %u %u", (unsigned)timeMs, flag(0), flag(1), (unsigned)a,
+                             (unsigned)b);
+                break;
+            case 'Y':
+                n = snprintf(out, size, "%u Y %d %.9g %d %d %u %.9g %u", (unsigned)timeMs, flag(0), value, flag(1),
+                             flag(2), (unsigned)a, extra, (unsigned)b);
+                break;
+            case 'N': n = snprintf(out, size, "%u N %d %d %d", (unsigned)timeMs, flag(0), flag(1), flag(2)); break;
+            case 'R': n = snprintf(out, size, "%u R %u %.9g", (unsigned)timeMs, (unsigned)a, value); break;
+            case 'S': n = snprintf(out, size, "%u S %.9g %u", (unsigned)timeMs, value, (unsigned)a); break;
+            case 'C':
+                n = snprintf(out, size, "%u C %c %s%s%s", (unsigned)timeMs, (char)flags, name, text[0] ? " " : "", text);
+                break;
+            case 'T': n = snprintf(out, size, "%u T", (unsigned)timeMs); break;
+            case 'L': n = snprintf(out, size, "%u L %d %d", (unsigned)timeMs, flag(0), flag(1)); break;
+            case 'P': n = snprintf(out, size, "%u P %s %.1f", (unsigned)timeMs, name, value); break;
+            case 'A': n = snprintf(out, size, "%u A %s %s", (unsigned)timeMs, name, detail); break;
+            case 'E': n = snprintf(out, size, "%u E %u", (unsigned)timeMs, (unsigned)a); break;
+            default: return -1;
+        }
+        return n < 0 || (size_t)n >= size ? -1 : n;
+    }
+
+    static TraceEvent make(uint32_t timeMs, char kind) {
+        TraceEvent event;
+        memset(&event, 0, sizeof(event));
+        event.timeMs = timeMs;
+        event.kind = kind;
+        return event;
+    }
+
+    static bool isOutput(char kind) { return kind == 'L' || kind == 'P' || kind == 'A'; }
+};
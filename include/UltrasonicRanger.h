@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+// Edge-driven HC-SR04 state machine. The firmware calls onTrigger() from the
+// trigger timer ISR and onEchoEdge() from the ECHO pin ISR; finished samples
+// are collected with takeSample() so nobody ever waits on the sensor.
+// Nothing in here touches Arduino APIs, so it builds on the host as well.
+
+struct RangeSample {
+    float distance;        // cm, -1 when no echo came back
+    uint32_t timestampUs;
+    uint8_t sensor;        // index in the sensor layout, set by the caller
+};
+
+class UltrasonicRanger {
+public:
+    enum State : uint8_t { IDLE, TRIGGERED, ECHO_HIGH };
+
+    static constexpr float CM_PER_US = 0.0343f / 2;
+
+    explicit UltrasonicRanger(uint32_t echoTimeoutUs = 30000)
+        : echoTimeoutUs(echoTimeoutUs) {}
+
+    void IRAM_ATTR onTrigger(uint32_t nowUs) {
+        if (state != IDLE) {
+            timeouts++;
+            complete(-1, nowUs);
+        }
+        triggerUs = nowUs;
+        state = TRIGGERED;
+    }
+
+    void IRAM_ATTR onEchoEdge(bool high, uint32_t nowUs) {
+        if (high) {
+            if (state == TRIGGERED) {
+                riseUs = nowUs;
+                state = ECHO_HIGH;
+            }
+            return;
+        }
+
+        if (state != ECHO_HIGH) return;
+        state = IDLE;
+
+        uint32_t width = nowUs - riseUs;
+        if (width > echoTimeoutUs) {
+            timeouts++;
+            complete(-1, nowUs);
+        } else {
+            complete(width * CM_PER_US, nowUs);
+        }
+    }
+
+    bool IRAM_ATTR takeSample(RangeSample& out) {
+        uint32_t seq;
+        do {
+            seq = sampleSeq.load(std::memory_order_acquire);
+            if (seq & 1) continue;
+            out.distance = latest.distance;
+            out.timestampUs = latest.timestampUs;
+        } while ((seq & 1) || seq != sampleSeq.load(std::memory_order_acquire));
+
+        if (seq == consumedSeq) return false;
+        consumedSeq = seq;
+        return true;
+    }
+
+    State currentState() const { return state; }
+    uint32_t sampleCount() const { return sampleSeq.load(std::memory_order_relaxed) / 2; }
+    uint32_t timeoutCount() const { return timeouts; }
+
+private:
+    void IRAM_ATTR complete(float distance, uint32_t nowUs) {
+        sampleSeq.fetch_add(1, std::memory_order_acq_rel);
+        latest.distance = distance;
+        latest.timestampUs = nowUs;
+        sampleSeq.fetch_add(1, std::memory_order_release);
+    }
+
+    const uint32_t echoTimeoutUs;
+    volatile State state = IDLE;
+    volatile uint32_t triggerUs = 0;
+    volatile uint32_t riseUs = 0;
+    volatile uint32_t timeouts = 0;
+
+    volatile RangeSample latest = {-1, 0, 0};
+    std::atomic<uint32_t> sampleSeq{0};
+    uint32_t consumedSeq = 0;
+};
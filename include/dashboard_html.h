@@ -0,0 +1,179 @@
+#pragma once
+
+// Generated by tools/build_dashboard.py from web/dashboard.html. Do not edit.
+// source-sha256: 5042d673210a700ecf696a52b6f971b0a21df98395e4646b2cf7b0937247c83f
+
+#include <Arduino.h>
+
+#define DASHBOARD_HTML_ETAG "\"b75091d84ce962f3\""
+
+const uint8_t DASHBOARD_HTML_GZ[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xc5, 0x59, 0x5b, 0x8f, 0xdb, 0xb8,
+    0x15, 0x7e, 0xf7, 0xaf, 0xe0, 0x3a, 0x48, 0x25, 0x77, 0x2d, 0x8f, 0x6f, 0x33, 0x49, 0x7c, 0xcb,
+    0x66, 0x27, 0x33, 0xed, 0x14, 0xb9, 0x61, 0x3d, 0xdb, 0xc5, 0x62, 0xb1, 0x08, 0x68, 0x89, 0xb6,
+    0xb9, 0x91, 0x45, 0x95, 0xa2, 0xe7, 0xd2, 0x60, 0xde, 0xfa, 0x54, 0x14, 0x6d, 0x81, 0x3e, 0xb5,
+    0x2f, 0xfd, 0x07, 0x7d, 0x6e, 0xff, 0xce, 0xfe, 0x81, 0xf6, 0x27, 0xf4, 0x1c, 0x52, 0x94, 0x28,
+    0x5f, 0x32, 0xde, 0xa4, 0x40, 0x31, 0x80, 0x2d, 0x93, 0x87, 0xe7, 0x7e, 0xbe, 0x73, 0xa8, 0x19,
+    0x7d, 0xf6, 0xfc, 0xf5, 0xe9, 0xe5, 0xb7, 0x6f, 0xce, 0xc8, 0x52, 0xad, 0xe2, 0xc9, 0x28, 0xff,
+    0x64, 0x34, 0x9a, 0x8c, 0x56, 0x4c, 0x51, 0x92, 0xd0, 0x15, 0x1b, 0xd7, 0xaf, 0x38, 0xbb, 0x4e,
+    0x85, 0x54, 0x75, 0x12, 0x8a, 0x44, 0xb1, 0x44, 0x8d, 0xeb, 0xd7, 0x3c, 0x52, 0xcb, 0x71, 0xc4,
+    0xae, 0x78, 0xc8, 0x02, 0xfd, 0xa3, 0x49, 0x78, 0xc2, 0x15, 0xa7, 0x71, 0x90, 0x85, 0x34, 0x66,
+    0xe3, 0x4e, 0x7d, 0x32, 0x52, 0x5c, 0xc5, 0x6c, 0x72, 0x36, 0x7d, 0xd3, 0xeb, 0x92, 0x0b, 0x71,
+    0x49, 0x9e, 0xd3, 0x6c, 0x39, 0x13, 0x54, 0x46, 0xa3, 0x23, 0xb3, 0x35, 0xca, 0xd4, 0x2d, 0x7c,
+    0xd5, 0x7e, 0x4e, 0xde, 0x93, 0x15, 0x95, 0x0b, 0x9e, 0x0c, 0x48, 0x7b, 0x48, 0x52, 0x1a, 0x45,
+    0x3c, 0x59, 0xe8, 0xe7, 0x99, 0xb8, 0x09, 0x32, 0xfe, 0x5b, 0xfd, 0x73, 0x26, 0x64, 0xc4, 0x64,
+    0x00, 0x4b, 0x43, 0x72, 0x57, 0x9b, 0x89, 0xe8, 0x96, 0xbc, 0xaf, 0xcd, 0x41, 0xa7, 0x60, 0x4e,
+    0x57, 0x3c, 0xbe, 0x1d, 0x10, 0x6f, 0xca, 0x16, 0x82, 0x91, 0xaf, 0x2f, 0xbc, 0x26, 0xb9, 0xa4,
+    0x4b, 0xb1, 0xa2, 0x4d, 0xf2, 0x0b, 0x96, 0xb0, 0x2b, 0xf8, 0xfe, 0x35, 0x93, 0x11, 0x4d, 0xe0,
+    0x21, 0xa3, 0x49, 0x16, 0x64, 0x4c, 0xf2, 0xf9, 0xb0, 0x36, 0xa3, 0xe1, 0xbb, 0x85, 0x14, 0xeb,
+    0x24, 0x1a, 0x90, 0x98, 0x27, 0x8c, 0xca, 0x60, 0x21, 0x69, 0xc4, 0xc1, 0x4a, 0xbf, 0xd3, 0x3b,
+    0x8e, 0xd8, 0xa2, 0x49, 0x1e, 0x9c, 0x9c, 0x3c, 0x62, 0x8c, 0x92, 0xf6, 0x43, 0x78, 0x7e, 0x74,
+    0xd2, 0x9f, 0xd1, 0x2e, 0xe9, 0xb4, 0xdb, 0x0f, 0x1b, 0xc3, 0xda, 0x8a, 0x27, 0xc1, 0x92, 0xf1,
+    0xc5, 0x52, 0x0d, 0x70, 0xe9, 0x6a, 0x39, 0xac, 0x15, 0xca, 0x77, 0xdb, 0xe9, 0xcd, 0xb0, 0x76,
+    0x57, 0x6b, 0xa1, 0xd7, 0x28, 0xf0, 0x96, 0xa0, 0xed, 0x8a, 0xde, 0x18, 0x7f, 0x0d, 0xc8, 0xe3,
+    0xb6, 0x26, 0x28, 0xec, 0x26, 0x74, 0xad, 0x84, 0x3e, 0x80, 0x11, 0xd0, 0xd4, 0xae, 0x76, 0xd7,
+    0x4b, 0xae, 0x98, 0xcb, 0xfe, 0x18, 0x4f, 0xe7, 0x2e, 0x41, 0x95, 0xd7, 0x19, 0xe8, 0x90, 0x2f,
+    0x82, 0xcf, 0x96, 0x34, 0x12, 0xd7, 0xc8, 0xb6, 0x03, 0x62, 0x48, 0x0f, 0x3f, 0xe4, 0x62, 0x46,
+    0xfd, 0x76, 0x53, 0xff, 0xb5, 0xba, 0x0d, 0x2b, 0x1b, 0x1c, 0xaa, 0x94, 0x58, 0x59, 0x8d, 0x15,
+    0xbb, 0x51, 0x01, 0x8d, 0xf9, 0x02, 0x94, 0x0a, 0xc1, 0x0f, 0x4c, 0xba, 0x4a, 0x2d, 0x3b, 0xa0,
+    0x57, 0x28, 0x62, 0x21, 0x07, 0xd6, 0x31, 0x5b, 0x7c, 0x8e, 0x73, 0xc3, 0xf3, 0x23, 0x69, 0xe5,
+    0xc4, 0xc9, 0xd0, 0x84, 0x0c, 0x82, 0xca, 0x40, 0xe1, 0xbe, 0x75, 0x12, 0xa4, 0xc5, 0xff, 0xcb,
+    0x62, 0x2b, 0x7e, 0xd9, 0x75, 0x34, 0xed, 0xf5, 0x7a, 0x7b, 0xc8, 0x1d, 0xf5, 0xcd, 0x42, 0x91,
+    0x97, 0x39, 0x15, 0x08, 0xce, 0x44, 0xcc, 0xa3, 0xd2, 0x41, 0xb9, 0x0d, 0x05, 0x49, 0xc7, 0xca,
+    0xcd, 0x58, 0x92, 0x09, 0x19, 0x44, 0x14, 0xaa, 0xed, 0x7d, 0x2d, 0xe2, 0x59, 0x1a, 0x53, 0xc8,
+    0xe3, 0x85, 0xe4, 0xd1, 0xb0, 0x86, 0x9f, 0x81, 0x62, 0x2b, 0x58, 0x53, 0x2c, 0x00, 0xc5, 0xd6,
+    0xab, 0x04, 0x4c, 0x96, 0x2c, 0x65, 0x54, 0xf9, 0x98, 0x2e, 0xc1, 0x9c, 0xab, 0x26, 0x81, 0x2c,
+    0x84, 0xbc, 0xf2, 0xbb, 0x98, 0x50, 0x4d, 0xd2, 0x99, 0xcb, 0x06, 0x58, 0xba, 0xa0, 0xa9, 0xf5,
+    0xce, 0x3e, 0xa3, 0x51, 0x6a, 0x00, 0x3e, 0x5e, 0x6d, 0x38, 0xfe, 0x23, 0x0a, 0x61, 0x23, 0xeb,
+    0x37, 0x83, 0xa4, 0x17, 0x73, 0xcf, 0xe6, 0x61, 0xdd, 0x93, 0x66, 0x5a, 0xa7, 0x2b, 0x1a, 0xaf,
+    0x99, 0xad, 0x6d, 0xe3, 0xe9, 0xde, 0x49, 0xe1, 0xfa, 0xeb, 0xbc, 0xe0, 0x66, 0x22, 0x8e, 0xca,
+    0xfa, 0xd1, 0x41, 0x6f, 0x97, 0x3c, 0x62, 0x3a, 0x63, 0x71, 0x95, 0x87, 0x49, 0x36, 0x91, 0xd2,
+    0x90, 0x2b, 0x70, 0x72, 0xbb, 0xf5, 0xc4, 0xc4, 0x40, 0x51, 0xb5, 0xce, 0x02, 0x9e, 0x44, 0x3c,
+    0xa4, 0x4a, 0x48, 0x37, 0x10, 0x3c, 0x41, 0x67, 0x04, 0xb3, 0x58, 0x84, 0xef, 0x86, 0xb5, 0xbc,
+    0x72, 0x3b, 0x5d, 0xe4, 0x53, 0xd4, 0x7d, 0x77, 0x87, 0xc5, 0xc7, 0xed, 0x87, 0x85, 0xdf, 0xa5,
+    0xa1, 0x7b, 0x6c, 0x43, 0x6e, 0xc4, 0x89, 0x04, 0x40, 0xcf, 0xf5, 0xfa, 0x83, 0xfe, 0xe9, 0xb3,
+    0xf3, 0xe3, 0x36, 0x42, 0x5b, 0x41, 0x33, 0x9f, 0x6f, 0x12, 0xcd, 0xfb, 0xfd, 0x5e, 0xef, 0x44,
+    0x13, 0x21, 0xae, 0x48, 0x11, 0x67, 0xae, 0xbe, 0xf3, 0x98, 0xdd, 0xd8, 0xd8, 0x9b, 0x64, 0x85,
+    0x85, 0xe0, 0x5a, 0xe2, 0x02, 0x7e, 0x6a, 0x0d, 0x66, 0x2a, 0x41, 0xc7, 0xc0, 0x0e, 0x50, 0x19,
+    0x10, 0x2b, 0x2c, 0xd3, 0x87, 0x8a, 0x68, 0x62, 0xfe, 0x54, 0xea, 0x6e, 0x40, 0x12, 0x91, 0xb0,
+    0x2d, 0x73, 0x1f, 0x6f, 0xd4, 0x45, 0x67, 0x5f, 0xb4, 0xc2, 0xb5, 0xcc, 0x30, 0x09, 0x52, 0xc1,
+    0x4d, 0xc8, 0x95, 0x04, 0x34, 0x86, 0xc6, 0x21, 0x20, 0x84, 0x34, 0x8e, 0x21, 0x28, 0xbd, 0xcc,
+    0x2a, 0xa9, 0x7d, 0x54, 0xdb, 0xe5, 0xa3, 0x8d, 0x5c, 0x2a, 0xc8, 0x07, 0x4b, 0x71, 0xb5, 0x85,
+    0x9c, 0x0f, 0xfa, 0xc7, 0xb4, 0xdd, 0x7f, 0x92, 0xcb, 0x9a, 0x0b, 0x09, 0x35, 0xa0, 0x1f, 0xb1,
+    0xac, 0xbe, 0xf5, 0x03, 0x88, 0x5f, 0x63, 0x13, 0x42, 0xd0, 0x6e, 0x6d, 0xbc, 0x46, 0x90, 0x47,
+    0x27, 0xcd, 0xce, 0xa3, 0xe3, 0xe6, 0x63, 0x44, 0x91, 0x7e, 0xa3, 0x94, 0x87, 0xe1, 0xa9, 0xed,
+    0x0a, 0xcf, 0x1e, 0xfd, 0xe6, 0xf3, 0xdd, 0x0a, 0x46, 0xb4, 0xf3, 0xa4, 0x3d, 0xfb, 0x04, 0x05,
+    0xbb, 0xfd, 0x7e, 0xf3, 0xe4, 0x51, 0xf3, 0xb8, 0x5f, 0x55, 0x10, 0x21, 0x62, 0x53, 0x56, 0xb7,
+    0xf3, 0xe4, 0xe4, 0xbc, 0xb7, 0x47, 0x43, 0x3c, 0xb0, 0x5b, 0xc5, 0xf6, 0xec, 0x51, 0x14, 0xd1,
+    0x4f, 0x50, 0xb1, 0xd7, 0x6b, 0x76, 0x8e, 0xdb, 0xcd, 0x6e, 0xbf, 0x57, 0xea, 0xc8, 0x93, 0xb9,
+    0x08, 0x10, 0xe5, 0x76, 0x60, 0x5f, 0x99, 0xc2, 0x96, 0x50, 0x8a, 0xeb, 0xed, 0x54, 0xff, 0x61,
+    0x9d, 0x29, 0x3e, 0xbf, 0x0d, 0xf2, 0xd1, 0x64, 0x40, 0x32, 0x28, 0x6f, 0x28, 0x58, 0xa6, 0xae,
+    0x19, 0x4b, 0xdc, 0x54, 0x36, 0xc0, 0x54, 0x09, 0xd6, 0x31, 0xfe, 0x6d, 0xd7, 0xae, 0x2b, 0xb4,
+    0x02, 0x23, 0x1b, 0xb9, 0xec, 0xf6, 0x34, 0x4b, 0x6f, 0xa1, 0xab, 0xd2, 0x46, 0x5c, 0x0b, 0x78,
+    0x92, 0xae, 0x15, 0x10, 0xd8, 0x8a, 0xeb, 0x54, 0x2b, 0x0e, 0x20, 0x8a, 0x9c, 0xb8, 0xf5, 0xd6,
+    0x29, 0xbb, 0x49, 0x18, 0x86, 0x5b, 0xca, 0xf6, 0x37, 0x5b, 0xb6, 0x46, 0x1b, 0x14, 0xf9, 0xc5,
+    0x8a, 0x45, 0x9c, 0x12, 0xdf, 0x19, 0x39, 0x4e, 0xb0, 0x43, 0x34, 0x40, 0x78, 0x05, 0x66, 0x89,
+    0xdb, 0xd0, 0xb0, 0x92, 0x89, 0xc5, 0x08, 0xe2, 0x42, 0x03, 0x00, 0x3d, 0xee, 0xdc, 0xd5, 0x46,
+    0x47, 0x66, 0x6c, 0x1b, 0x1d, 0x99, 0x51, 0x11, 0x07, 0xb1, 0xc9, 0x28, 0xe2, 0x57, 0x24, 0x8c,
+    0x69, 0x96, 0x8d, 0xeb, 0xc5, 0xc0, 0x53, 0xaf, 0x2c, 0x9b, 0x71, 0x00, 0xd6, 0x96, 0x9d, 0xc9,
+    0x7f, 0xfe, 0xfe, 0x87, 0x3f, 0x93, 0x9d, 0x93, 0x21, 0x6c, 0x8e, 0xd2, 0xc9, 0x57, 0x0c, 0x26,
+    0x49, 0xc5, 0x57, 0x8c, 0xbc, 0x14, 0x30, 0x57, 0x0a, 0x09, 0xce, 0x21, 0x3f, 0x23, 0xa7, 0x06,
+    0xf2, 0x46, 0x47, 0x29, 0x48, 0x07, 0xd6, 0x55, 0xb1, 0x70, 0x1e, 0xb9, 0x77, 0x81, 0xfb, 0x5f,
+    0x7e, 0x4f, 0xa6, 0xba, 0xb5, 0x02, 0x6b, 0x45, 0x81, 0x6b, 0xb7, 0x42, 0xea, 0xb4, 0xdd, 0xaa,
+    0x8e, 0x45, 0x4b, 0xdc, 0xb1, 0xac, 0x53, 0xa1, 0x3e, 0x79, 0xce, 0x01, 0x9d, 0x93, 0x90, 0x6d,
+    0x2b, 0x50, 0x3a, 0xb5, 0x4e, 0x78, 0x04, 0xbf, 0x73, 0xca, 0xfa, 0x24, 0x08, 0xf6, 0x50, 0xe7,
+    0x3c, 0xb1, 0x01, 0x82, 0xb1, 0x80, 0x88, 0x59, 0x4e, 0xb8, 0x9b, 0xfc, 0xc3, 0x9a, 0xbd, 0x38,
+    0x7b, 0x4e, 0xa6, 0xba, 0x73, 0xdc, 0xaf, 0x5b, 0xcc, 0x22, 0x43, 0x7a, 0x80, 0x72, 0x6b, 0x29,
+    0x41, 0x3f, 0x82, 0x4d, 0x89, 0x55, 0xd4, 0xdb, 0x3a, 0xe6, 0xfa, 0x55, 0x8b, 0x31, 0x0b, 0x20,
+    0x64, 0xdf, 0x09, 0x37, 0x68, 0x7f, 0xfc, 0x07, 0x79, 0x49, 0x93, 0x35, 0x8d, 0x09, 0x5a, 0x52,
+    0xc4, 0x7a, 0x23, 0x76, 0xb6, 0xed, 0xc1, 0xa9, 0xd9, 0x1a, 0x26, 0x9a, 0xc4, 0x6e, 0x60, 0xca,
+    0x9a, 0x36, 0x50, 0x27, 0x22, 0x09, 0x63, 0x1e, 0xbe, 0x2b, 0xa8, 0x81, 0xa1, 0xef, 0x89, 0xc4,
+    0x6b, 0xd4, 0x27, 0x97, 0x6b, 0x99, 0x90, 0xd7, 0xaf, 0x46, 0x47, 0xe6, 0xf4, 0x5e, 0x2e, 0xf3,
+    0xf9, 0x3e, 0x36, 0xf3, 0x79, 0xc9, 0xe7, 0xfc, 0xfc, 0x3e, 0x46, 0x88, 0xa9, 0x7b, 0x38, 0xe1,
+    0x16, 0xb2, 0x7a, 0x86, 0x38, 0xfd, 0x52, 0x44, 0xac, 0xe4, 0x65, 0x1c, 0x95, 0x12, 0x5d, 0x6a,
+    0xe3, 0x7a, 0x3e, 0x4a, 0x28, 0x61, 0x87, 0x3a, 0xe2, 0xa2, 0x0f, 0xd9, 0x1c, 0x72, 0xc0, 0x37,
+    0x80, 0x83, 0x85, 0x2a, 0x9b, 0x13, 0x8e, 0x89, 0xcd, 0x0a, 0x04, 0x5e, 0x14, 0x4b, 0x20, 0x12,
+    0x8f, 0xe4, 0x07, 0xed, 0xfe, 0x25, 0x20, 0x4b, 0x7d, 0x82, 0xaa, 0x0d, 0xc8, 0x0b, 0x41, 0x11,
+    0xa3, 0x5a, 0xad, 0x96, 0x25, 0xbd, 0xa7, 0x0c, 0x7f, 0xfc, 0xdd, 0xbf, 0xfe, 0xfd, 0xcf, 0x3f,
+    0x91, 0xe9, 0x6d, 0x86, 0x33, 0xe6, 0x45, 0x82, 0x6d, 0x83, 0x62, 0xab, 0xdf, 0x8a, 0x69, 0xd1,
+    0x08, 0xea, 0xdb, 0xcb, 0x00, 0x9a, 0x1b, 0xe6, 0x94, 0xc0, 0x5c, 0x9f, 0x5c, 0xbc, 0x21, 0xcf,
+    0xa2, 0x48, 0xb2, 0x2c, 0x1b, 0x54, 0x0c, 0x70, 0x49, 0x9d, 0xb4, 0xe7, 0x69, 0x4e, 0x6d, 0xd2,
+    0x3e, 0x37, 0x63, 0xd3, 0x84, 0x03, 0xe4, 0x7e, 0xc3, 0xcf, 0x39, 0x99, 0x4e, 0x2f, 0x9e, 0x1f,
+    0x24, 0x36, 0xcb, 0xd0, 0xb4, 0x4f, 0x93, 0x38, 0x05, 0x78, 0x87, 0xd2, 0x98, 0x2a, 0x28, 0xc6,
+    0x05, 0x20, 0xf2, 0x21, 0x72, 0x25, 0x08, 0xfe, 0x54, 0xb9, 0xcf, 0xbe, 0x99, 0x22, 0x46, 0x1f,
+    0x24, 0x8f, 0x5e, 0x67, 0x2e, 0xaa, 0xb8, 0x42, 0xef, 0xad, 0xff, 0x1f, 0xff, 0xf6, 0x57, 0x9d,
+    0x2d, 0x4c, 0x29, 0xc8, 0xb2, 0xec, 0x03, 0x39, 0x92, 0x23, 0x8b, 0xa1, 0xab, 0xef, 0x62, 0x6a,
+    0x21, 0x62, 0x6f, 0xf9, 0xd4, 0x0f, 0xac, 0xd6, 0x8c, 0x5e, 0x31, 0x00, 0xa2, 0x39, 0x5f, 0xf8,
+    0x50, 0xa7, 0x53, 0xf8, 0xf5, 0x3f, 0x2b, 0xd1, 0x8a, 0x15, 0xd6, 0x6b, 0x4e, 0x49, 0x99, 0xcf,
+    0x2c, 0x94, 0x3c, 0x55, 0x93, 0x5a, 0xcc, 0x14, 0x0c, 0xcd, 0x71, 0x7c, 0x09, 0x6d, 0x42, 0x92,
+    0x31, 0x49, 0xd6, 0x71, 0x0c, 0x13, 0xf6, 0x3a, 0x09, 0xb1, 0xa0, 0x08, 0x4d, 0xd3, 0xf8, 0x16,
+    0x5b, 0x9d, 0x8f, 0xd8, 0x8b, 0x2d, 0x9e, 0xcf, 0x89, 0xef, 0xd9, 0x0e, 0xe4, 0xc1, 0xd8, 0x41,
+    0xcc, 0x4e, 0x24, 0xc2, 0xf5, 0x0a, 0xe0, 0xbc, 0xb5, 0x60, 0xea, 0x2c, 0x66, 0xf8, 0xf8, 0xe5,
+    0xed, 0x45, 0xe4, 0xd0, 0x36, 0x5a, 0x38, 0x4f, 0x9c, 0x9a, 0x81, 0x0a, 0x44, 0xe1, 0xb9, 0x96,
+    0xdd, 0x6d, 0x29, 0x71, 0xce, 0x6f, 0x58, 0xe4, 0x77, 0x60, 0x84, 0xd3, 0x32, 0x72, 0x88, 0x77,
+    0x44, 0x68, 0x65, 0x4c, 0xfb, 0xcd, 0xb4, 0x3e, 0xf9, 0x35, 0x37, 0xb3, 0x47, 0xa0, 0xf9, 0xbc,
+    0x35, 0x98, 0x74, 0x88, 0x62, 0x45, 0xab, 0xda, 0xad, 0x59, 0xc9, 0x2c, 0xe7, 0xce, 0xd3, 0x43,
+    0xb8, 0x16, 0x48, 0xb0, 0x9b, 0x2b, 0x4f, 0xad, 0x79, 0x50, 0xba, 0x87, 0xf0, 0xd3, 0x74, 0x3b,
+    0x59, 0xe1, 0x4e, 0xce, 0x0c, 0xeb, 0xf1, 0x10, 0x66, 0x9a, 0x6e, 0x27, 0x33, 0xdc, 0x21, 0x9f,
+    0x13, 0x8f, 0x44, 0x5f, 0xae, 0xbc, 0x9c, 0x2b, 0x54, 0xdd, 0x5b, 0x48, 0xf9, 0x84, 0x85, 0x8a,
+    0x1d, 0xa4, 0x6b, 0x51, 0xa6, 0xbb, 0x65, 0x54, 0xf8, 0x91, 0xa7, 0xc4, 0x3b, 0x2d, 0x99, 0x0f,
+    0x88, 0x07, 0x03, 0x50, 0x29, 0x2d, 0x57, 0x61, 0xa5, 0xfb, 0xf6, 0x5b, 0x6c, 0x19, 0x8e, 0x02,
+    0x38, 0x06, 0x27, 0x99, 0x22, 0x95, 0x4e, 0x83, 0x52, 0xf6, 0x29, 0x56, 0x21, 0xf4, 0x1a, 0x43,
+    0xe7, 0x3c, 0x76, 0xa2, 0xfb, 0x8e, 0x22, 0x8d, 0x97, 0x27, 0x99, 0xb6, 0xc4, 0x51, 0x0b, 0xb5,
+    0xa9, 0xb0, 0x6f, 0xe9, 0xca, 0x7f, 0x45, 0x61, 0xc6, 0x1c, 0x13, 0x6f, 0xeb, 0x25, 0x40, 0x71,
+    0x4d, 0x07, 0x13, 0x2d, 0xef, 0x0d, 0x67, 0x79, 0xa6, 0x2f, 0xe6, 0x33, 0x4b, 0x3e, 0xaf, 0x00,
+    0xf9, 0x1d, 0x61, 0x71, 0xc6, 0x3e, 0x52, 0x1e, 0x0c, 0x17, 0xf7, 0x09, 0xc4, 0x71, 0x01, 0x1b,
+    0x69, 0x48, 0x7c, 0x3b, 0x8c, 0x06, 0x33, 0x9a, 0xb1, 0xa8, 0x81, 0xc2, 0xf5, 0xdf, 0xd1, 0x11,
+    0x79, 0x9d, 0xc4, 0xb7, 0x84, 0x4a, 0x49, 0x6f, 0x33, 0x22, 0xe6, 0x24, 0x63, 0x70, 0xab, 0x03,
+    0x35, 0xf3, 0x52, 0xc4, 0xef, 0x88, 0xa4, 0x70, 0x93, 0x30, 0x0b, 0x44, 0x32, 0xdd, 0xdd, 0xb3,
+    0xd6, 0x06, 0xa8, 0xd8, 0x3a, 0xb6, 0x25, 0x5c, 0x04, 0x55, 0xdf, 0xdb, 0x3e, 0x10, 0x10, 0x8b,
+    0x0b, 0x10, 0x0f, 0xb8, 0x64, 0xc6, 0x8c, 0xf8, 0x78, 0xa2, 0x15, 0xc2, 0x33, 0xd4, 0x5d, 0x02,
+    0x75, 0x8b, 0x6d, 0x8c, 0x8c, 0xac, 0x46, 0xf9, 0x42, 0x29, 0x40, 0xbf, 0x99, 0x72, 0x04, 0x84,
+    0xa0, 0xa2, 0x62, 0xb9, 0x0c, 0xc4, 0xab, 0x2b, 0x1d, 0x6b, 0xa0, 0xaa, 0xba, 0xb6, 0x98, 0x94,
+    0xbd, 0x7c, 0x97, 0x43, 0xb2, 0xca, 0x5f, 0x5e, 0xbe, 0x7c, 0x81, 0xbb, 0xfb, 0xa6, 0xdc, 0xfc,
+    0xba, 0xe0, 0x41, 0x71, 0xed, 0x56, 0xf4, 0x73, 0xd2, 0x69, 0x60, 0xe5, 0x19, 0x60, 0x06, 0xba,
+    0x9a, 0xb7, 0x67, 0xc0, 0xfe, 0xe9, 0xe3, 0xbe, 0x67, 0x5e, 0xf6, 0xb5, 0xc0, 0xe3, 0x10, 0x96,
+    0x53, 0x94, 0xec, 0xa3, 0xea, 0xfa, 0x9a, 0x6c, 0xfd, 0x03, 0xe3, 0xd3, 0x19, 0x0d, 0x97, 0xbe,
+    0x1f, 0x35, 0x09, 0x6f, 0x90, 0xf1, 0x04, 0x3c, 0x55, 0xd1, 0xf4, 0x3b, 0xfe, 0x7d, 0xeb, 0x37,
+    0x6b, 0x26, 0x21, 0x66, 0x31, 0x54, 0xa7, 0x90, 0xbe, 0xe7, 0x5c, 0xf4, 0xb6, 0x6b, 0x1d, 0x7c,
+    0xdf, 0xc6, 0xf2, 0x0e, 0x02, 0xac, 0xeb, 0xa8, 0x02, 0xed, 0x77, 0x5a, 0x74, 0x91, 0x0a, 0xeb,
+    0x14, 0x18, 0x31, 0xdd, 0x60, 0x30, 0x40, 0x73, 0xa6, 0x40, 0x11, 0xef, 0x08, 0xb9, 0x7b, 0x8d,
+    0x5a, 0x4b, 0x2d, 0x59, 0xe2, 0x03, 0x98, 0xa6, 0x10, 0x38, 0x86, 0x9a, 0xd9, 0xe7, 0xd6, 0x0f,
+    0x99, 0x48, 0xfc, 0x86, 0x25, 0x29, 0xda, 0x54, 0x03, 0x5f, 0xb9, 0x22, 0x0f, 0x26, 0x25, 0x42,
+    0xc2, 0x04, 0xff, 0xb7, 0x00, 0xd7, 0x5c, 0xd6, 0xd2, 0x0b, 0xbe, 0x77, 0x86, 0x5f, 0x03, 0xaf,
+    0x49, 0xf4, 0xef, 0x46, 0x55, 0x1b, 0xc8, 0x79, 0xa9, 0xde, 0x40, 0x37, 0x84, 0x84, 0xf5, 0x6d,
+    0xb3, 0xfb, 0xac, 0x68, 0x8f, 0x8d, 0x4a, 0xa7, 0x84, 0x16, 0x7b, 0x81, 0xef, 0x9a, 0xc0, 0x09,
+    0x7e, 0x69, 0x46, 0x13, 0x2f, 0xb4, 0xed, 0x4d, 0xb6, 0x22, 0xdd, 0xe4, 0xea, 0x30, 0x85, 0xbc,
+    0x8c, 0x19, 0x95, 0x05, 0xb3, 0x72, 0x0b, 0xee, 0xef, 0x5b, 0xad, 0xf9, 0xce, 0xe5, 0xec, 0x0c,
+    0xfd, 0x54, 0xaf, 0xb8, 0x4e, 0x84, 0x06, 0xf6, 0xd4, 0xac, 0x8e, 0x31, 0xfb, 0x72, 0x82, 0x0f,
+    0x39, 0x15, 0xe3, 0x58, 0x3a, 0x55, 0xbf, 0x3c, 0xd6, 0xd9, 0x60, 0x7d, 0x18, 0x8b, 0x85, 0x99,
+    0x03, 0x86, 0x9b, 0x36, 0xb8, 0x71, 0xc4, 0x20, 0x7f, 0x4c, 0x18, 0x70, 0x14, 0xc1, 0xb9, 0x28,
+    0x32, 0x83, 0x11, 0x58, 0xfc, 0xfe, 0xce, 0x19, 0x45, 0x62, 0xb8, 0x26, 0xd8, 0x91, 0xc9, 0xb1,
+    0x32, 0xd4, 0x4b, 0x3f, 0x25, 0x59, 0xc2, 0x9c, 0x3d, 0x5a, 0x56, 0x95, 0x67, 0x76, 0x6c, 0x77,
+    0xb0, 0x33, 0xd4, 0x87, 0xc1, 0xc8, 0xd0, 0x20, 0x62, 0xd8, 0xe7, 0x2a, 0x2e, 0x78, 0xf8, 0xbe,
+    0x52, 0x12, 0xdf, 0xf0, 0x7c, 0xc7, 0x6e, 0xb1, 0x8d, 0x19, 0x41, 0x25, 0x24, 0xe1, 0x0b, 0x9c,
+    0x7b, 0x11, 0x09, 0x88, 0xaa, 0x80, 0x64, 0x87, 0x6c, 0xcf, 0xec, 0x55, 0xe1, 0x68, 0xdf, 0xd8,
+    0x6d, 0xa7, 0x67, 0xf3, 0xbe, 0x48, 0xdd, 0xa6, 0x30, 0x62, 0x26, 0xeb, 0xd5, 0x8c, 0xc1, 0xed,
+    0x6d, 0xc5, 0x93, 0x71, 0xbd, 0x5d, 0x9f, 0xe4, 0x0c, 0xe7, 0x5c, 0x66, 0x4a, 0x83, 0xc6, 0x46,
+    0x85, 0x83, 0x15, 0x2d, 0xc9, 0xd2, 0x98, 0x86, 0xcc, 0x3f, 0x7a, 0x7b, 0xb4, 0x68, 0x02, 0xbc,
+    0x79, 0x1a, 0xc4, 0x06, 0xf9, 0x51, 0x90, 0x9b, 0x9f, 0xd4, 0x60, 0xee, 0x85, 0xf3, 0xc5, 0x5b,
+    0x4c, 0x42, 0x38, 0xb9, 0x49, 0x60, 0xde, 0x16, 0x59, 0xe7, 0x7f, 0x07, 0x14, 0xdf, 0x3b, 0xbe,
+    0x74, 0x91, 0x0b, 0xce, 0xe9, 0x44, 0xb9, 0xfb, 0xc4, 0x2a, 0x77, 0x66, 0xef, 0x22, 0x02, 0x29,
+    0x95, 0x74, 0x85, 0xa1, 0x4e, 0xd8, 0x35, 0xf9, 0xfa, 0xab, 0x17, 0x53, 0xa8, 0xc8, 0x70, 0xf9,
+    0x46, 0xaf, 0x62, 0x4a, 0x6f, 0xc7, 0xd0, 0x49, 0x9d, 0x92, 0x8d, 0x35, 0x66, 0x6f, 0xc2, 0x38,
+    0x8e, 0x68, 0x18, 0xd3, 0x4d, 0x2d, 0x99, 0x83, 0x9f, 0x8d, 0xc7, 0x78, 0x11, 0x43, 0xa0, 0x70,
+    0xd8, 0x6b, 0x9f, 0x34, 0x1a, 0xb9, 0x8e, 0xb9, 0x4b, 0x7c, 0x58, 0x6c, 0x1a, 0x79, 0xda, 0xbc,
+    0x3c, 0x67, 0x75, 0xb7, 0x3f, 0x24, 0x63, 0xed, 0xa0, 0x36, 0xcc, 0x41, 0xce, 0xf0, 0x56, 0x22,
+    0x17, 0xdf, 0x40, 0x9b, 0x0c, 0xb7, 0xcd, 0x61, 0xe1, 0x95, 0x20, 0xe1, 0x92, 0x26, 0x0b, 0x96,
+    0x61, 0xb0, 0x99, 0x5a, 0xcb, 0x44, 0xfb, 0xb7, 0x52, 0x90, 0x4f, 0xd1, 0xc8, 0x6d, 0xa6, 0x87,
+    0xa3, 0x8f, 0xd2, 0x73, 0xd9, 0x64, 0x9f, 0x16, 0xf8, 0x4b, 0xa7, 0x09, 0x02, 0x90, 0x58, 0x2b,
+    0xbf, 0x84, 0x87, 0x26, 0x39, 0x36, 0x08, 0xfc, 0x51, 0x69, 0x82, 0xde, 0xb8, 0x86, 0xf1, 0x09,
+    0x72, 0xf4, 0xec, 0x0a, 0x64, 0x4d, 0xc5, 0x5a, 0x86, 0xac, 0x8c, 0x30, 0xc3, 0x45, 0x9b, 0x28,
+    0x0e, 0x05, 0x58, 0x6e, 0xb6, 0xd0, 0xa5, 0xe6, 0xa9, 0x45, 0xa3, 0x48, 0x53, 0xbc, 0x80, 0x69,
+    0x8a, 0x41, 0x71, 0xfa, 0x7a, 0x86, 0x40, 0x79, 0xa8, 0x4c, 0x79, 0xb7, 0xfa, 0xd5, 0xf4, 0xf5,
+    0xab, 0x16, 0x38, 0x2b, 0x63, 0x3e, 0xd3, 0x9d, 0xb5, 0xd1, 0x28, 0x99, 0x88, 0x44, 0x40, 0xbc,
+    0xb1, 0xe1, 0x94, 0x6d, 0xc4, 0xd9, 0xcc, 0x6d, 0xab, 0xf4, 0x2e, 0x67, 0x54, 0xac, 0xb6, 0x34,
+    0x34, 0xb0, 0x0a, 0xd5, 0x2e, 0xaa, 0x0e, 0xf1, 0x15, 0xac, 0xb9, 0x17, 0xc2, 0x6d, 0x54, 0xbf,
+    0x7d, 0x3d, 0xd2, 0xff, 0xbb, 0xff, 0x2f, 0x9a, 0x95, 0xc2, 0x55, 0xd1, 0x1f, 0x00, 0x00,
+};
+const size_t DASHBOARD_HTML_GZ_LEN = sizeof(DASHBOARD_HTML_GZ);
@@ -0,0 +1,271 @@
+#include "ResumableTlsClient.h"
+
+#include <string.h>
+#include <mbedtls/platform.h>
+
+static const size_t TLS_SESSION_CAPACITY = 2048;
+static const uint32_t TLS_WRITE_TIMEOUT_MS = 5000;
+
+// Survives deep sleep; cleared on power loss, which just costs one full handshake.
+RTC_DATA_ATTR static uint8_t rtcSession[TLS_SESSION_CAPACITY];
+RTC_DATA_ATTR static uint16_t rtcSessionLength = 0;
+RTC_DATA_ATTR static char rtcSessionHost[64];
+
+ResumableTlsClient::ResumableTlsClient() {
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&drbg);
+    mbedtls_x509_crt_init(&caChain);
+    mbedtls_x509_crt_init(&ownCert);
+    mbedtls_pk_init(&ownKey);
+    mbedtls_ssl_config_init(&conf);
+    mbedtls_ssl_init(&ssl);
+    mbedtls_net_init(&socket);
+}
+
+ResumableTlsClient::~ResumableTlsClient() {
+    stop();
+    mbedtls_ssl_free(&ssl);
+    mbedtls_ssl_config_free(&conf);
+    mbedtls_pk_free(&ownKey);
+    mbedtls_x509_crt_free(&ownCert);
+    mbedtls_x509_crt_free(&caChain);
+    mbedtls_ctr_drbg_free(&drbg);
+    mbedtls_entropy_free(&entropy);
+}
+
+void ResumableTlsClient::setCredentials(const char* ca, const char* cert, const char* key) {
+    caCert = ca;
+    clientCert = cert;
+    privateKey = key;
+}
+
+void ResumableTlsClient::forgetSession() {
+    rtcSessionLength = 0;
+}
+
+bool ResumableTlsClient::setup() {
+    if (!caCert || !clientCert || !privateKey) return false;
+
+    static const char personalization[] = "aws-iot-client";
+    int ret = mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy,
+                                    (const unsigned char*)personalization, sizeof(personalization) - 1);
+    if (ret == 0) ret = mbedtls_x509_crt_parse(&caChain, (const unsigned char*)caCert, strlen(caCert) + 1);
+    if (ret == 0) ret = mbedtls_x509_crt_parse(&ownCert, (const unsigned char*)clientCert, strlen(clientCert) + 1);
+    if (ret == 0) ret = mbedtls_pk_parse_key(&ownKey, (const unsigned char*)privateKey, strlen(privateKey) + 1, nullptr, 0);
+    if (ret == 0) {
+        ret = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                          MBEDTLS_SSL_PRESET_DEFAULT);
+    }
+    if (ret == 0) {
+        mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+        mbedtls_ssl_conf_ca_chain(&conf, &caChain, nullptr);
+        mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &drbg);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+        mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+        ret = mbedtls_ssl_conf_own_cert(&conf, &ownCert, &ownKey);
+    }
+    if (ret == 0) ret = mbedtls_ssl_setup(&ssl, &conf);
+
+    if (ret != 0) {
+        stats.error = ret;
+        return false;
+    }
+    ready = true;
+    return true;
+}
+
+int ResumableTlsClient::connect(IPAddress ip, uint16_t port) {
+    char host[16];
+    snprintf(host, sizeof(host), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    return connect(host, port);
+}
+
+int ResumableTlsClient::connect(const char* host, uint16_t port) {
+    stop();
+    stats = TlsConnectStats();
+    if (!ready && !setup()) return 0;
+
+    stats.freeHeapBefore = ESP.getFreeHeap();
+    uint32_t start = millis();
+
+    char portText[6];
+    snprintf(portText, sizeof(portText), "%u", port);
+    int ret = mbedtls_net_connect(&socket, host, portText, MBEDTLS_NET_PROTO_TCP);
+    stats.tcpMs = millis() - start;
+    if (ret != 0) {
+        stats.error = ret;
+        mbedtls_net_free(&socket);
+        return 0;
+    }
+
+    // The context reads the config at every handshake, so a changed
+    // timeout applies from this connect on.
+    mbedtls_ssl_conf_read_timeout(&conf, handshakeTimeoutMs);
+    mbedtls_ssl_session_reset(&ssl);
+    mbedtls_ssl_set_hostname(&ssl, host);
+    mbedtls_ssl_set_bio(&ssl, &socket, mbedtls_net_send, mbedtls_net_recv, mbedtls_net_recv_timeout);
+
+    // A resumed handshake keeps the original session's start time while a
+    // full one stamps a new one, which is how resumption is detected below.
+    mbedtls_time_t offeredStart = 0;
+    if (rtcSessionLength > 0 && strncmp(rtcSessionHost, host, sizeof(rtcSessionHost)) == 0) {
+        mbedtls_ssl_session session;
+        mbedtls_ssl_session_init(&session);
+        if (mbedtls_ssl_session_load(&session, rtcSession, rtcSessionLength) == 0 &&
+            mbedtls_ssl_set_session(&ssl, &session) == 0) {
+            stats.offeredSession = true;
+            offeredStart = session.start;
+        }
+        mbedtls_ssl_session_free(&session);
+    }
+
+    // Stepping through the handshake samples the free heap after every
+    // message, which is what this handshake cost. ESP.getMinFreeHeap() is the
+    // low-water mark since boot and would not move once a first full
+    // handshake had set it. Buffers freed within a single step are missed.
+    uint32_t handshakeStart = millis();
+    stats.minFreeHeap = stats.freeHeapBefore;
+    while (ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+        ret = mbedtls_ssl_handshake_step(&ssl);
+        uint32_t freeHeap = ESP.getFreeHeap();
+        if (freeHeap < stats.minFreeHeap) stats.minFreeHeap = freeHeap;
+        if (ret == 0) continue;
+        if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) break;
+        if (millis() - handshakeStart > handshakeTimeoutMs) {
+            ret = MBEDTLS_ERR_SSL_TIMEOUT;
+            break;
+        }
+        vTaskDelay(1);
+    }
+    stats.handshakeMs = millis() - handshakeStart;
+    stats.freeHeapAfter = ESP.getFreeHeap();
+
+    if (ret != 0) {
+        stats.error = ret;
+        if (stats.offeredSession) forgetSession();
+        mbedtls_net_free(&socket);
+        return 0;
+    }
+
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    if (mbedtls_ssl_get_session(&ssl, &session) == 0) {
+        stats.resumed = stats.offeredSession && session.start == offeredStart;
+
+#if defined(MBEDTLS_SSL_KEEP_PEER_CERTIFICATE)
+        // The broker's certificate was checked during the full handshake and
+        // a resumed one does not send it again. Saved with the session it
+        // would take most of the RTC buffer, or more than all of it with a
+        // longer chain, so the copy saved here leaves it out.
+        if (session.peer_cert) {
+            mbedtls_x509_crt_free(session.peer_cert);
+            mbedtls_free(session.peer_cert);
+            session.peer_cert = nullptr;
+        }
+#endif
+
+        size_t length = 0;
+        int saved = mbedtls_ssl_session_save(&session, rtcSession, sizeof(rtcSession), &length);
+        if (saved == 0) {
+            rtcSessionLength = length;
+            stats.sessionBytes = length;
+            strncpy(rtcSessionHost, host, sizeof(rtcSessionHost) - 1);
+            rtcSessionHost[sizeof(rtcSessionHost) - 1] = 0;
+        } else {
+            rtcSessionLength = 0;
+            stats.sessionSaveError = saved;
+            sessionSaveFailures++;
+        }
+    }
+    mbedtls_ssl_session_free(&session);
+
+    // From here on PubSubClient polls available(), so reads must not block.
+    mbedtls_net_set_nonblock(&socket);
+    mbedtls_ssl_set_bio(&ssl, &socket, mbedtls_net_send, mbedtls_net_recv, nullptr);
+
+    open = true;
+    connects++;
+    if (stats.resumed) resumptions++;
+    return 1;
+}
+
+size_t ResumableTlsClient::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t ResumableTlsClient::write(const uint8_t* buf, size_t size) {
+    if (!open) return 0;
+
+    size_t sent = 0;
+    uint32_t start = millis();
+    while (sent < size) {
+        int ret = mbedtls_ssl_write(&ssl, buf + sent, size - sent);
+        if (ret > 0) {
+            sent += ret;
+        } else if ((ret == MBEDTLS_ERR_SSL_WANT_WRITE || ret == MBEDTLS_ERR_SSL_WANT_READ) &&
+                   millis() - start < TLS_WRITE_TIMEOUT_MS) {
+            vTaskDelay(1);
+        } else {
+            stop();
+            break;
+        }
+    }
+    return sent;
+}
+
+bool ResumableTlsClient::fillReceiveBuffer() {
+    int ret = mbedtls_ssl_read(&ssl, rxBuffer, sizeof(rxBuffer));
+    if (ret > 0) {
+        rxLength = ret;
+        rxPosition = 0;
+        return true;
+    }
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        stop();
+    }
+    return false;
+}
+
+int ResumableTlsClient::available() {
+    if (rxPosition == rxLength && open) {
+        fillReceiveBuffer();
+    }
+    return rxLength - rxPosition;
+}
+
+int ResumableTlsClient::read() {
+    if (!available()) return -1;
+    return rxBuffer[rxPosition++];
+}
+
+int ResumableTlsClient::read(uint8_t* buf, size_t size) {
+    size_t count = 0;
+    while (count < size && available()) {
+        size_t chunk = rxLength - rxPosition;
+        if (chunk > size - count) chunk = size - count;
+        memcpy(buf + count, rxBuffer + rxPosition, chunk);
+        rxPosition += chunk;
+        count += chunk;
+    }
+    return count > 0 ? (int)count : -1;
+}
+
+int ResumableTlsClient::peek() {
+    if (!available()) return -1;
+    return rxBuffer[rxPosition];
+}
+
+void ResumableTlsClient::stop() {
+    if (open) {
+        mbedtls_ssl_close_notify(&ssl);
+        open = false;
+    }
+    mbedtls_net_free(&socket);
+    rxLength = 0;
+    rxPosition = 0;
+}
+
+uint8_t ResumableTlsClient::connected() {
+    return open || rxPosition < rxLength;
+}
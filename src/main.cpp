@@ -1,6 +1,5 @@
 #include <Arduino.h>
 #include <WiFi.h>
-#include <WiFiClientSecure.h>
 #include <PubSubClient.h>
 #include "secrets.h"
 #include <ArduinoJson.h>
@@ -8,40 +7,802 @@
 #include <Preferences.h>
 #include <ESPAsyncWebServer.h>
 #include <AsyncTCP.h>
+#include <LittleFS.h>
 #include <time.h>
+#include "UltrasonicRanger.h"
+#include "RingBuffer.h"
+#include "DistanceFilter.h"
+#include "LedController.h"
+#include "PublishPolicy.h"
+#include "TelemetryPayload.h"
+#include "TelemetryQueue.h"
+#include "TelemetryBatch.h"
+#include "PayloadWriter.h"
+#include "dashboard_html.h"
+#include "ReconnectBackoff.h"
+#include "ResumableTlsClient.h"
+#include "TaskLoad.h"
+#include "DeviceState.h"
+#include "DashboardData.h"
+#include "CommandDispatch.h"
+#include "DeviceConfig.h"
+#include "ShadowSync.h"
+#include "EnergyModel.h"
+#include "LatencyHistogram.h"
+#include "Logger.h"
+#include "TraceLog.h"
+#include "SensorArray.h"
+#include "SensingPipeline.h"
+#include <atomic>
+#ifdef LOW_POWER_MODE
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#endif
+
+// The broker and the TLS credentials come from secrets.h. To test against a
+// local broker without editing it, override them in build_flags, e.g.
+// -DAWS_IOT_HOST='"192.168.1.20"' -DAWS_IOT_PORT=8884 and, for the
+// credentials, -include local_broker.h with AWS_IOT_CA, AWS_IOT_CERT and
+// AWS_IOT_KEY naming the arrays that header defines.
+#ifndef AWS_IOT_HOST
+#define AWS_IOT_HOST AWS_IOT_ENDPOINT
+#endif
+#ifndef AWS_IOT_PORT
+#define AWS_IOT_PORT 8883
+#endif
+#ifndef AWS_IOT_CA
+#define AWS_IOT_CA AWS_CERT_CA
+#endif
+#ifndef AWS_IOT_CERT
+#define AWS_IOT_CERT AWS_CERT_CRT
+#endif
+#ifndef AWS_IOT_KEY
+#define AWS_IOT_KEY AWS_CERT_PRIVATE
+#endif
 
 #define AWS_IOT_PUBLISH_TOPIC "devices/" AWS_IOT_CLIENT_ID "/data"
 #define AWS_IOT_SUBSCRIBE_TOPIC  "devices/" AWS_IOT_CLIENT_ID "/commands"
-
-WiFiClientSecure net;
+#define AWS_IOT_BACKLOG_TOPIC "devices/" AWS_IOT_CLIENT_ID "/backlog"
+#define AWS_IOT_BATCH_TOPIC "devices/" AWS_IOT_CLIENT_ID "/batch"
+#define AWS_IOT_ACK_TOPIC "devices/" AWS_IOT_CLIENT_ID "/ack"
+#define AWS_IOT_METRICS_TOPIC "devices/" AWS_IOT_CLIENT_ID "/metrics"
+
+// The thing name defaults to the client ID; point AWS_IOT_SHADOW_PREFIX at a
+// local broker's emulated topics to test without AWS.
+#ifndef AWS_IOT_SHADOW_PREFIX
+#define AWS_IOT_SHADOW_PREFIX "$aws/things/" AWS_IOT_CLIENT_ID "/shadow"
+#endif
+#define SHADOW_UPDATE_TOPIC AWS_IOT_SHADOW_PREFIX "/update"
+#define SHADOW_DELTA_TOPIC AWS_IOT_SHADOW_PREFIX "/update/delta"
+#define SHADOW_GET_TOPIC AWS_IOT_SHADOW_PREFIX "/get"
+#define SHADOW_GET_ACCEPTED_TOPIC AWS_IOT_SHADOW_PREFIX "/get/accepted"
+
+ResumableTlsClient net;
 PubSubClient client(net);
 WiFiManager wifiManager;
 AsyncWebServer server(80);
+AsyncEventSource events("/events");
+
+// HC-SR04 wiring, one {trigger pin, echo pin, trigger slot} per sensor. Up to
+// eight sensors take turns by slot, see SensorArray.h; sensors that share a
+// slot fire together. Boards with an array set SENSOR_LAYOUT in platformio.ini.
+struct SensorPins {
+    uint8_t trig;
+    uint8_t echo;
+    uint8_t slot;
+};
+#ifndef SENSOR_LAYOUT
+#define SENSOR_LAYOUT {{5, 18, 0}}
+#endif
+const SensorPins SENSORS[] = SENSOR_LAYOUT;
+const uint8_t SENSOR_COUNT = sizeof(SENSORS) / sizeof(SENSORS[0]);
+static_assert(SENSOR_COUNT <= DeviceSnapshot::MAX_SENSORS, "SENSOR_LAYOUT has too many sensors");
 
-bool manualLEDControl = false;
-
-const int TRIG_PIN = 5;
-const int ECHO_PIN = 18;
 const int LED_PIN = 2;
-const int DISTANCE_THRESHOLD = 50;
-
-float distance = 0.0;
-
-bool awsConnected = false;
-unsigned long lastAWSReconnectAttempt = 0;
-const long awsReconnectInterval = 5000;
+const uint32_t LED_MIN_DWELL_MS = 500;
+
+// Runtime settings, see DeviceConfig.h. SET_CONFIG runs on the sensing task,
+// which applies its share and publishes the new values under configLock;
+// the network task applies the rest and saves to NVS once the settings have
+// been left alone for CONFIG_SAVE_DELAY_MS, so a burst of changes costs one
+// flash write, and none at all if they end up where they started.
+DeviceConfig deviceConfig;
+portMUX_TYPE configLock = portMUX_INITIALIZER_UNLOCKED;
+std::atomic<uint32_t> configVersion(0);
+uint32_t appliedConfigVersion = 0;
+uint32_t savedConfigVersion = 0;
+DeviceConfig savedConfig;
+unsigned long configChangedTime = 0;
+const unsigned long CONFIG_SAVE_DELAY_MS = 10000;
+const size_t CONFIG_PAYLOAD_SIZE = 256;
+Preferences preferences;
+
+LedController ledController(deviceConfig.thresholdCm, deviceConfig.thresholdCm + deviceConfig.hysteresisCm,
+                            LED_MIN_DWELL_MS);
+
+DeviceState deviceState;
+
+// The trigger timer ticks every SCHEDULER_TICK_US and lets the scheduler
+// decide which sensors fire. A sensor that hears nothing holds ECHO high for
+// about 38 ms, so a slot gives up after SENSOR_SLOT_TIMEOUT_US; the guard
+// lets late reflections die down before the next slot fires. The rangers
+// keep their default 30 ms echo timeout.
+const uint32_t SCHEDULER_TICK_US = 500;
+const uint32_t SENSOR_SLOT_TIMEOUT_US = 40000;
+const uint32_t SENSOR_GUARD_US = 10000;
+UltrasonicRanger rangers[SENSOR_COUNT];
+TriggerScheduler<SENSOR_COUNT> triggerScheduler(SENSOR_SLOT_TIMEOUT_US, SENSOR_GUARD_US);
+hw_timer_t* rangingTimer = nullptr;
+RingBuffer<RangeSample, 64> sampleRing;
+
+enum AwsLinkState : uint8_t { AWS_DISCONNECTED, AWS_CONNECTING, AWS_CONNECTED };
+std::atomic<AwsLinkState> awsLinkState(AWS_DISCONNECTED);
+const uint32_t NTP_SYNC_TIMEOUT_MS = 10000;
+ReconnectBackoff awsBackoff(deviceConfig.reconnectBaseMs, deviceConfig.reconnectMaxMs);
+bool awsEverConnected = false;
+bool timeSyncStarted = false;
+bool timeSyncDone = false;
+unsigned long timeSyncStart = 0;
 
 unsigned long lastPublishTime = 0;
 const long publishInterval = 2000;
 
-void publishCloudAcknowledgment(const char* command, const char* status);
-void publishMessage();
+PublishPolicy publishPolicy(deviceConfig.deadbandCm, deviceConfig.minPublishIntervalMs, deviceConfig.heartbeatMs,
+                            publishInterval);
+
+// Filtered readings and the LED and publish decisions. Only the sensing task
+// touches these, the LED controller and the publish policy; every other task
+// reads deviceState instead.
+SensingPipeline<SENSOR_COUNT> sensing(ledController, publishPolicy, SENSOR_COUNT);
+
+const uint32_t OFFLINE_QUEUE_CAPACITY = 10000;
+const size_t REPLAY_BATCH_SIZE = 20;
+const unsigned long REPLAY_INTERVAL_MS = 1000;
+const unsigned long OFFLINE_FLUSH_INTERVAL_MS = 30000;
+const uint16_t MQTT_BUFFER_SIZE = 1024;
+// The client's own buffer also holds incoming messages, and a shadow
+// get/accepted document carries metadata for every field.
+const uint16_t MQTT_CLIENT_BUFFER_SIZE = 2048;
+// Every counter at ten digits and a 128-character client ID come to 1539
+// bytes of JSON.
+const size_t METRICS_PAYLOAD_SIZE = 1792;
+static_assert(METRICS_PAYLOAD_SIZE + MQTT_MAX_HEADER_SIZE + 2 + sizeof(AWS_IOT_METRICS_TOPIC) <= MQTT_CLIENT_BUFFER_SIZE,
+              "the metrics message must fit the MQTT client buffer");
+
+enum WireTopic : uint8_t { TOPIC_DATA, TOPIC_ACK, TOPIC_BACKLOG, TOPIC_METRICS, TOPIC_COUNT };
+const char* const WIRE_TOPIC_NAMES[TOPIC_COUNT] = {"data", "ack", "backlog", "metrics"};
+const uint8_t PAYLOAD_SCHEMA_VERSION = 2;
+PayloadWriter::Format topicFormats[TOPIC_COUNT] = {PayloadWriter::JSON, PayloadWriter::JSON, PayloadWriter::JSON,
+                                                  PayloadWriter::JSON};
+
+const size_t TELEMETRY_PAYLOAD_SIZE = 384;
+const size_t ACK_PAYLOAD_SIZE = 192;
+// IP and SSID as of the last GOT_IP event. The WiFi event task writes them
+// while the network and web tasks read them, so both sides go through
+// networkLock and readers work on a copy from currentNetworkInfo(). version
+// counts the updates, which is how the dashboard notices a change.
+struct NetworkInfo {
+    char ip[16];
+    char ssid[33];
+    uint32_t version;
+};
+NetworkInfo networkInfo = {"0.0.0.0", "", 1};
+portMUX_TYPE networkLock = portMUX_INITIALIZER_UNLOCKED;
+int32_t wifiRssi = 0;
+unsigned long lastRssiPollTime = 0;
+const unsigned long RSSI_POLL_INTERVAL_MS = 5000;
+
+// Reported shadow state: the LED, then every DeviceConfig field in table
+// order. Only the network task touches it.
+enum ShadowField : uint8_t { SHADOW_LED_STATUS, SHADOW_MANUAL_MODE, SHADOW_CONFIG_FIRST, SHADOW_FIELD_COUNT = SHADOW_CONFIG_FIRST + DeviceConfig::FIELD_COUNT };
+ShadowSync<SHADOW_FIELD_COUNT> shadow;
+// Fields changed by a web or cloud command, whose desired value must go. Set
+// by the sensing task, taken by the network task.
+std::atomic<uint32_t> shadowOverrides(0);
+const unsigned long SHADOW_MIN_INTERVAL_MS = 1000;
+// Every field reported and every desired value cleared comes to 584 bytes.
+const size_t SHADOW_PAYLOAD_SIZE = 640;
+unsigned long lastShadowUpdateTime = 0;
+uint32_t shadowUpdates = 0;
+uint32_t shadowDeltasApplied = 0;
+uint32_t shadowDeltasStale = 0;
+
+const size_t DATA_SNAPSHOT_SIZE = 384;
+const unsigned long DATA_SNAPSHOT_MIN_INTERVAL_MS = 200;
+char dataSnapshot[2][DATA_SNAPSHOT_SIZE];
+size_t dataSnapshotLength[2] = {0, 0};
+volatile uint8_t dataSnapshotIndex = 0;
+uint32_t dashboardNetworkVersion = 0;
+DashboardState dashboardState;
+unsigned long lastSnapshotTime = 0;
+uint32_t dashboardEventsSent = 0;
+TelemetryQueue offlineQueue("/littlefs/telemetry.log", "/littlefs/telemetry.cur", OFFLINE_QUEUE_CAPACITY);
+bool offlineQueueReady = false;
+
+// Arrays carry a column per sensor, so larger ones batch fewer rows to stay
+// inside BATCH_PAYLOAD_SIZE.
+const size_t TELEMETRY_BATCH_SIZE = SENSOR_COUNT > 4 ? 25 : 50;
+const size_t BATCH_PAYLOAD_SIZE = SENSOR_COUNT > 1 ? 1792 : MQTT_BUFFER_SIZE;
+TelemetryBatch<TELEMETRY_BATCH_SIZE, SENSOR_COUNT> telemetryBatches[2];
+uint8_t fillingBatch = 0;
+std::atomic<bool> batchInFlight(false);
+std::atomic<bool> batchedTelemetry(false);
+unsigned long lastReplayTime = 0;
+unsigned long lastQueueFlushTime = 0;
+
+// Trace capture for tools/replay_trace.cpp, see TraceLog.h. Only the sensing
+// task records, so a single-producer ring is enough; the logging task writes
+// the lines to LittleFS and closes the file once recording stops or
+// TRACE_MAX_BYTES is reached. Starting a trace resets the distance filters so
+// the replay begins from the same filter state as the device.
+const size_t TRACE_RING_SIZE = 64;
+const size_t TRACE_LINE_SIZE = 112;
+const uint32_t TRACE_MAX_BYTES = 256 * 1024;
+#define TRACE_FILE "/trace.log"
+#define TRACE_PATH "/littlefs" TRACE_FILE
+RingBuffer<TraceEvent, TRACE_RING_SIZE> traceRing;
+std::atomic<bool> traceActive(false);
+std::atomic<bool> traceFileOpen(false);
+std::atomic<uint32_t> traceDropsAtStart(0);
+bool traceStartRequested = false;
+uint8_t tracedLink = 0xff;
+FILE* traceFile = nullptr;
+uint32_t traceBytes = 0;
+
+// Task layout. Sensing and LED control run on the APP core so WiFi, lwIP
+// and TLS on the PRO core never delay them; everything that can block on
+// the network or on Serial lives on core 0.
+//
+//   task      core  prio  owns
+//   sensing     1     3   sample ring, filters, LED controller and GPIO, publish policy
+//   network     0     2   TLS/MQTT client, publishing, offline queue and replay
+//   logging     0     1   Serial output, status and task reports, trace file
+//   loopTask    1     1   dashboard snapshot and SSE pushes
+//
+// AsyncTCP is pinned to core 0 from platformio.ini. Tasks only talk through
+// the bounded queues below and never wait on a full one: a telemetry event
+// that does not fit is offered again on the next sample, a log line is
+// dropped and counted.
+const BaseType_t SENSING_CORE = 1;
+const UBaseType_t SENSING_PRIORITY = 3;
+const uint32_t SENSING_STACK_SIZE = 4096;
+const uint32_t SENSING_IDLE_TIMEOUT_MS = 100;
+const BaseType_t NETWORK_CORE = 0;
+const UBaseType_t NETWORK_PRIORITY = 2;
+const uint32_t NETWORK_STACK_SIZE = 8192;
+const uint32_t NETWORK_POLL_INTERVAL_MS = 20;
+const BaseType_t LOGGING_CORE = 0;
+const UBaseType_t LOGGING_PRIORITY = 1;
+const uint32_t LOGGING_STACK_SIZE = 3072;
+const uint32_t LOG_DRAIN_INTERVAL_MS = 20;
+const uint32_t DASHBOARD_REFRESH_INTERVAL_MS = 50;
+const unsigned long TASK_REPORT_INTERVAL_MS = 30000;
+
+struct TelemetrySample {
+    uint32_t uptimeMs;
+    float distance;
+    bool ledOn;
+    bool manual;
+    PublishPolicy::Reason reason;
+    uint8_t batchIndex;
+    float sensors[SENSOR_COUNT];
+};
+
+const size_t LOG_LINE_SIZE = 128;
+const size_t LOG_RING_SIZE = 32;
+LogRing<LOG_RING_SIZE> logRing;
+#define LOG_RING logRing
+#define LOG_CLOCK_MS() millis()
+
+const UBaseType_t TELEMETRY_QUEUE_DEPTH = 32;
+const UBaseType_t COMMAND_QUEUE_DEPTH = 16;
+const UBaseType_t ACK_QUEUE_DEPTH = 16;
+const size_t ACK_BATCH_SIZE = 8;
+QueueHandle_t telemetryEvents = nullptr;
+QueueHandle_t commandQueue = nullptr;
+SemaphoreHandle_t commandSubmitLock = nullptr;
+QueueHandle_t ackRequests = nullptr;
+std::atomic<uint32_t> telemetryEventsDropped(0);
+
+enum TaskId : uint8_t { TASK_SENSING, TASK_NETWORK, TASK_LOGGING, TASK_LOOP, TASK_COUNT };
+struct TaskInfo {
+    const char* name;
+    TaskHandle_t handle;
+    BaseType_t core;
+    UBaseType_t priority;
+    TaskLoad load;
+};
+TaskInfo tasks[TASK_COUNT] = {
+    {"sensing", nullptr, SENSING_CORE, SENSING_PRIORITY, {}},
+    {"network", nullptr, NETWORK_CORE, NETWORK_PRIORITY, {}},
+    {"logging", nullptr, LOGGING_CORE, LOGGING_PRIORITY, {}},
+    {"loopTask", nullptr, ARDUINO_RUNNING_CORE, 1, {}},
+};
+
+// Per-stage timing for /metrics and the metrics message. Stages are timed
+// with the CPU cycle counter, a single-instruction read; every stage runs on
+// a task pinned to one core, so both ends come from the same counter. The
+// counter wraps after ~17 s at 240 MHz, so anything that can take longer
+// (the AWS connect) is timed with millis() instead.
+enum Stage : uint8_t {
+    STAGE_COMMANDS, STAGE_SENSE, STAGE_SUBMIT, STAGE_MQTT_LOOP, STAGE_PUBLISH, STAGE_BATCH_PUBLISH,
+    STAGE_ACKS, STAGE_SHADOW, STAGE_REPLAY, STAGE_DASHBOARD, STAGE_SERIAL, STAGE_COUNT
+};
+const char* const STAGE_NAMES[STAGE_COUNT] = {
+    "commands", "sense", "submit", "mqtt_loop", "publish", "batch_publish",
+    "acks", "shadow", "replay", "dashboard", "serial",
+};
+LatencyHistogram stageLatency[STAGE_COUNT];
+LatencyHistogram samplePeriodJitter;    // |actual - expected| ranging period per sensor, sensing task
+LatencyHistogram awsConnectDuration;    // one connect attempt, network task
+LatencyHistogram awsOutageDuration;     // connection lost until back, network task
+uint32_t cpuMhz = 240;
+uint32_t awsConnectAttempts = 0;
+uint32_t awsConnectFailures = 0;
+unsigned long awsLostTime = 0;
+uint32_t lastRangeSampleUs[SENSOR_COUNT];
+unsigned long lastMetricsTime = 0;
+const unsigned long METRICS_MIN_INTERVAL_MS = 5000;
+
+class StageTimer {
+public:
+    explicit StageTimer(Stage stage) : stage(stage), startCycles(ESP.getCycleCount()) {}
+    ~StageTimer() { stageLatency[stage].record((ESP.getCycleCount() - startCycles) / cpuMhz); }
+
+private:
+    Stage stage;
+    uint32_t startCycles;
+};
+
+void publishCloudAcknowledgment(const char* command, const char* status, const char* id = "");
+void publishMetrics();
+void flushAcks();
+bool publishDocument(const char* topic, WireTopic wireTopic, JsonDocument& doc);
+bool setTopicFormat(const char* topicName, const char* formatName);
+bool publishMessage(const TelemetrySample& sample, const char* reason = "request");
 void messageHandler(char* topic, byte* payload, unsigned int length);
-void reconnectAWS();
+void networkTask(void* parameter);
 void connectToAWS();
+bool cloudReady();
 void setupWebServer();
-void readSensorData();
-float readUltrasonicDistance();
+void readSensorData(bool batching);
+void queueOfflineSample(const TelemetrySample& sample);
+void replayOfflineQueue();
+template <size_t N, size_t S>
+bool publishTelemetryBatch(const TelemetryBatch<N, S>& batch, uint32_t nowMs);
+template <size_t N, size_t S>
+void queueOfflineBatch(const TelemetryBatch<N, S>& batch, bool manual);
+void applyLEDState();
+void refreshDataSnapshot();
+void printSensorData();
+void startRanging();
+bool sendTelemetry(const TelemetrySample& sample);
+
+// Formats and prints everything logged so far. Runs on the logging task, or
+// inline before sleeping in low-power mode, which has no tasks.
+void drainLogs() {
+    LogRecord record;
+    char line[LOG_LINE_SIZE];
+    while (logRing.pop(record)) {
+        record.render(line, sizeof(line));
+        Serial.print(line);
+        if (record.suppressed) {
+            Serial.print(" (+");
+            Serial.print(record.suppressed);
+            Serial.print(" similar suppressed)");
+        }
+        Serial.println();
+    }
+}
+
+void copyText(char* dest, const char* src, size_t size) {
+    strncpy(dest, src, size - 1);
+    dest[size - 1] = 0;
+}
+
+DeviceConfig currentConfig() {
+    portENTER_CRITICAL(&configLock);
+    DeviceConfig config = deviceConfig;
+    portEXIT_CRITICAL(&configLock);
+    return config;
+}
+
+// Settings owned by the sensing task: LED thresholds, the publish policy and
+// the ranging rate.
+void applySensingConfig(const DeviceConfig& config) {
+    sensing.applyConfig(config);
+    triggerScheduler.setMinPeriod(1000000 / config.sampleRateHz);
+}
+
+size_t writeConfigPayload(uint8_t* buffer, size_t size, PayloadWriter::Format format, const DeviceConfig& config) {
+    size_t count;
+    const DeviceConfig::Field* fields = DeviceConfig::fields(count);
+    PayloadWriter writer(buffer, size, format);
+    writer.beginObject(count);
+    for (size_t i = 0; i < count; i++) {
+        writer.add(fields[i].key, config.*(fields[i].member));
+    }
+    return writer.end();
+}
+
+// Settings stored by an older firmware are rewritten in the current layout
+// right away, so the next boot reads them directly.
+void loadConfig() {
+    uint32_t layout = preferences.getUInt("layout", 0);
+    size_t length = preferences.getBytesLength("settings");
+    uint8_t blob[sizeof(DeviceConfig)];
+    if (length > 0 && length <= sizeof(blob) && preferences.getBytes("settings", blob, length) == length &&
+        deviceConfig.restore(layout, blob, length)) {
+        Serial.println("✓ Configuration loaded from NVS");
+        if (layout != DeviceConfig::LAYOUT) {
+            preferences.putUInt("layout", DeviceConfig::LAYOUT);
+            preferences.putBytes("settings", &deviceConfig, sizeof(deviceConfig));
+            Serial.print("✓ Configuration migrated from layout ");
+            Serial.println(layout);
+        }
+    } else {
+        Serial.println("⚙️ Using default configuration");
+    }
+    savedConfig = deviceConfig;
+
+    applySensingConfig(deviceConfig);
+    awsBackoff.setLimits(deviceConfig.reconnectBaseMs, deviceConfig.reconnectMaxMs);
+}
+
+// Network task side of a configuration change, see configLock above.
+void maintainConfig() {
+    uint32_t version = configVersion;
+    if (version != appliedConfigVersion) {
+        DeviceConfig config = currentConfig();
+        awsBackoff.setLimits(config.reconnectBaseMs, config.reconnectMaxMs);
+        appliedConfigVersion = version;
+        configChangedTime = millis();
+    }
+
+    if (savedConfigVersion == appliedConfigVersion || millis() - configChangedTime < CONFIG_SAVE_DELAY_MS) {
+        return;
+    }
+    savedConfigVersion = appliedConfigVersion;
+
+    DeviceConfig config = currentConfig();
+    if (memcmp(&config, &savedConfig, sizeof(config)) == 0) return;
+
+    preferences.putUInt("layout", DeviceConfig::LAYOUT);
+    if (preferences.putBytes("settings", &config, sizeof(config)) == sizeof(config)) {
+        savedConfig = config;
+        LOG_INFO("💾 Configuration saved to NVS");
+    } else {
+        LOG_ERROR("❌ Failed to save configuration");
+    }
+}
+
+const char* commandOrigin(const Command& command) {
+    switch (command.source) {
+        case COMMAND_FROM_WEB: return "web dashboard";
+        case COMMAND_FROM_SHADOW: return "device shadow";
+        default: return "AWS IoT Cloud";
+    }
+}
+
+// The sensing task's current readings, as handed to the network task.
+TelemetrySample currentSample(uint32_t now, PublishPolicy::Reason reason) {
+    TelemetrySample sample = {now, sensing.distance, ledController.isOn(), ledController.isManual(), reason, 0, {}};
+    memcpy(sample.sensors, sensing.sensorDistance, sizeof(sample.sensors));
+    return sample;
+}
+
+// Trace recording, sensing task only. Each call is a flag check while no
+// trace is running.
+
+void startTrace(uint32_t now) {
+    traceStartRequested = false;
+    if (traceActive) return;
+
+    sensing.reset();
+    tracedLink = 0xff;
+    traceDropsAtStart = traceRing.droppedCount();
+    traceActive = true;
+
+    TraceEvent event = TraceEvent::make(now, 'H');
+    event.a = TraceEvent::VERSION;
+    event.b = LED_MIN_DWELL_MS;
+    event.c = TELEMETRY_BATCH_SIZE;
+    event.flags = SENSOR_COUNT;
+    traceRing.push(event);
+
+    size_t count;
+    const DeviceConfig::Field* fields = DeviceConfig::fields(count);
+    for (size_t i = 0; i < count; i++) {
+        event = TraceEvent::make(now, 'K');
+        event.name = fields[i].key;
+        event.a = deviceConfig.*(fields[i].member);
+        traceRing.push(event);
+    }
+
+    event = TraceEvent::make(now, 'X');
+    event.flags = ledController.isOn() | ledController.isManual() << 1;
+    event.a = ledController.lastTransition();
+    event.b = ledController.transitionCount();
+    traceRing.push(event);
+
+    float sentDistance;
+    bool sentLed, sentManual;
+    uint32_t sentMs;
+    bool sent = publishPolicy.lastCommitted(sentDistance, sentLed, sentManual, sentMs);
+    event = TraceEvent::make(now, 'Y');
+    event.flags = sent | sentLed << 1 | sentManual << 2;
+    event.value = sentDistance;
+    event.a = sentMs;
+    event.extra = sensing.distance;
+    event.b = telemetryBatches[fillingBatch].size();
+    traceRing.push(event);
+
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        event = TraceEvent::make(now, 'R');
+        event.a = i;
+        event.value = sensing.sensorDistance[i];
+        traceRing.push(event);
+    }
+
+    LOG_INFO("🎞️ Trace recording started");
+}
+
+void traceLink(uint32_t now, bool batching) {
+    if (!traceActive) return;
+    uint8_t flags = cloudReady() | batching << 1 | batchInFlight.load() << 2;
+    if (flags == tracedLink) return;
+    tracedLink = flags;
+    TraceEvent event = TraceEvent::make(now, 'N');
+    event.flags = flags;
+    traceRing.push(event);
+}
+
+void traceSample(uint32_t now, uint8_t sensor, float raw) {
+    if (!traceActive) return;
+    TraceEvent event = TraceEvent::make(now, 'S');
+    event.value = raw;
+    event.a = sensor;
+    traceRing.push(event);
+}
+
+void traceTick(uint32_t now) {
+    if (traceActive) traceRing.push(TraceEvent::make(now, 'T'));
+}
+
+void traceLed(uint32_t now) {
+    if (!traceActive) return;
+    TraceEvent event = TraceEvent::make(now, 'L');
+    event.flags = ledController.isOn() | ledController.isManual() << 1;
+    traceRing.push(event);
+}
+
+void traceSend(const TelemetrySample& sample) {
+    if (!traceActive) return;
+    TraceEvent event = TraceEvent::make(sample.uptimeMs, 'P');
+    event.name = PublishPolicy::reasonName(sample.reason);
+    event.value = sample.distance;
+    traceRing.push(event);
+}
+
+void traceCommand(uint32_t now, const char* name, const Command& command) {
+    TraceEvent event = TraceEvent::make(now, 'C');
+    event.flags = command.source == COMMAND_FROM_WEB ? 'w' : command.source == COMMAND_FROM_SHADOW ? 's' : 'c';
+    event.name = name;
+    for (uint8_t i = 0; i < COMMAND_ARG_COUNT && command.args[i][0]; i++) {
+        size_t used = strlen(event.text);
+        snprintf(event.text + used, sizeof(event.text) - used, "%s%s", used ? " " : "", command.args[i]);
+    }
+    traceRing.push(event);
+}
+
+void traceResult(uint32_t now, const char* name, const char* status) {
+    TraceEvent event = TraceEvent::make(now, 'A');
+    event.name = name;
+    event.detail = status;
+    traceRing.push(event);
+}
+
+// Command handlers, run on the sensing task.
+
+const char* handleBatchModeOff(const Command& command) {
+    batchedTelemetry = false;
+    LOG_INFO("✓ Batched telemetry disabled via %s", commandOrigin(command));
+    return "SUCCESS";
+}
+
+const char* handleBatchModeOn(const Command& command) {
+    batchedTelemetry = true;
+    LOG_INFO("✓ Batched telemetry enabled via %s", commandOrigin(command));
+    return "SUCCESS";
+}
+
+const char* handleGetStatus(const Command& command) {
+    TelemetrySample sample = currentSample(millis(), PublishPolicy::REQUEST);
+    LOG_INFO("✓ Status request from %s", commandOrigin(command));
+    sendTelemetry(sample);
+    return nullptr;
+}
+
+const char* handleLedAuto(const Command& command) {
+    if (ledController.setAuto()) traceLed(millis());
+    LOG_INFO("✓ LED set to AUTO mode via %s", commandOrigin(command));
+    return "SUCCESS";
+}
+
+const char* handleLedOff(const Command& command) {
+    uint32_t now = millis();
+    if (ledController.setManual(false, now)) traceLed(now);
+    applyLEDState();
+    LOG_INFO("✓ LED turned OFF via %s", commandOrigin(command));
+    return "SUCCESS";
+}
+
+const char* handleLedOn(const Command& command) {
+    uint32_t now = millis();
+    if (ledController.setManual(true, now)) traceLed(now);
+    applyLEDState();
+    LOG_INFO("✓ LED turned ON via %s", commandOrigin(command));
+    return "SUCCESS";
+}
+
+const char* handleSetConfig(const Command& command) {
+    DeviceConfig config = deviceConfig;
+    DeviceConfig::Result result = config.set(command.args[0], command.args[1]);
+    if (result == DeviceConfig::UNKNOWN_KEY || result == DeviceConfig::INVALID_VALUE) {
+        LOG_WARN("⚠️ Invalid setting %s=%s", command.args[0], command.args[1]);
+        return "INVALID_ARGUMENT";
+    }
+
+    if (result == DeviceConfig::CHANGED) {
+        applySensingConfig(config);
+        portENTER_CRITICAL(&configLock);
+        deviceConfig = config;
+        portEXIT_CRITICAL(&configLock);
+        configVersion++;
+    }
+    LOG_INFO("⚙️ %s set to %s via %s", command.args[0], command.args[1], commandOrigin(command));
+    return "SUCCESS";
+}
+
+const char* handleSetFormat(const Command& command) {
+    const char* topicName = command.args[0][0] ? command.args[0] : "all";
+    const char* formatName = command.args[1][0] ? command.args[1] : "json";
+    if (!setTopicFormat(topicName, formatName)) {
+        LOG_WARN("⚠️ Invalid SET_FORMAT request");
+        return "INVALID_ARGUMENT";
+    }
+    LOG_INFO("✓ Wire format for %s set to %s", topicName, formatName);
+    return "SUCCESS";
+}
+
+// Takes effect at the start of the next sensing pass, see startTrace().
+const char* handleTraceStart(const Command& command) {
+    traceStartRequested = true;
+    return "SUCCESS";
+}
+
+const char* handleTraceStop(const Command& command) {
+    if (traceActive) {
+        traceActive = false;
+        LOG_INFO("🎞️ Trace recording stopped via %s", commandOrigin(command));
+    }
+    return "SUCCESS";
+}
+
+// Sorted by name for findCommand(); the static_assert keeps it that way.
+constexpr CommandEntry COMMANDS[] = {
+    {"BATCH_MODE_OFF", handleBatchModeOff, {nullptr, nullptr}},
+    {"BATCH_MODE_ON", handleBatchModeOn, {nullptr, nullptr}},
+    {"GET_STATUS", handleGetStatus, {nullptr, nullptr}},
+    {"LED_AUTO", handleLedAuto, {nullptr, nullptr}},
+    {"LED_OFF", handleLedOff, {nullptr, nullptr}},
+    {"LED_ON", handleLedOn, {nullptr, nullptr}},
+    {"SET_CONFIG", handleSetConfig, {"key", "value"}},
+    {"SET_FORMAT", handleSetFormat, {"topic", "format"}},
+    {"TRACE_START", handleTraceStart, {nullptr, nullptr}},
+    {"TRACE_STOP", handleTraceStop, {nullptr, nullptr}},
+};
+static_assert(isSortedTable(COMMANDS), "COMMANDS must stay sorted by name");
+
+int prepareCommand(Command& command, const char* name, CommandSource source, const char* id) {
+    return prepareCommand(command, COMMANDS, name, source, id);
+}
+
+// Queues all of the commands or none of them, for a request that changes
+// several settings at once. Front-ends only submit while holding
+// commandSubmitLock and the sensing task only takes commands out, so the free
+// space counted here can only grow until they are all in.
+bool submitCommands(const Command* commands, size_t count) {
+    if (!commandQueue || !commandSubmitLock) return false;
+
+    xSemaphoreTake(commandSubmitLock, portMAX_DELAY);
+    bool fits = uxQueueSpacesAvailable(commandQueue) >= count;
+    for (size_t i = 0; fits && i < count; i++) {
+        xQueueSend(commandQueue, &commands[i], 0);
+    }
+    xSemaphoreGive(commandSubmitLock);
+    if (!fits) return false;
+
+    if (tasks[TASK_SENSING].handle) {
+        xTaskNotifyGive(tasks[TASK_SENSING].handle);
+    }
+    return true;
+}
+
+bool submitCommand(const Command& command) {
+    return submitCommands(&command, 1);
+}
+
+void queueAck(const Command& command, const char* status) {
+    // Shadow changes are answered by the next reported update.
+    if (command.source == COMMAND_FROM_SHADOW) return;
+    if (!cloudReady() || !ackRequests) return;
+
+    AckRequest ack = makeAck(command, status);
+    if (xQueueSend(ackRequests, &ack, 0) != pdPASS) {
+        LOG_WARN("⚠️ Acknowledgment queue full, %s dropped", ack.command);
+    }
+}
+
+// Shadow fields a command sets, as ShadowSync bits.
+uint32_t shadowFieldsOf(const Command& command) {
+    if (strncmp(command.name, "LED_", 4) == 0) {
+        return (1u << SHADOW_LED_STATUS) | (1u << SHADOW_MANUAL_MODE);
+    }
+    if (strcmp(command.name, "SET_CONFIG") == 0) {
+        size_t count;
+        const DeviceConfig::Field* fields = DeviceConfig::fields(count);
+        const DeviceConfig::Field* field = DeviceConfig::find(command.args[0]);
+        if (field) return 1u << (SHADOW_CONFIG_FIRST + (field - fields));
+    }
+    return 0;
+}
+
+void runCommands() {
+    bool traced = false;
+    dispatchCommands(
+        COMMANDS, [](Command& command) { return xQueueReceive(commandQueue, &command, 0) == pdPASS; },
+        [&traced](const Command& command, const CommandEntry& entry) {
+            traced = traceActive;
+            if (traced) traceCommand(millis(), entry.name, command);
+        },
+        [&traced](const Command& command, const CommandEntry& entry, const char* status) {
+            if (status) {
+                if (traced && traceActive) traceResult(millis(), entry.name, status);
+                queueAck(command, status);
+            }
+            if (command.source != COMMAND_FROM_SHADOW && status && strcmp(status, "SUCCESS") == 0) {
+                shadowOverrides.fetch_or(shadowFieldsOf(command));
+            }
+        });
+}
+
+void cacheNetworkInfo() {
+    // WiFi.SSID() allocates, so build the copy before taking the lock.
+    NetworkInfo info;
+    IPAddress ip = WiFi.localIP();
+    snprintf(info.ip, sizeof(info.ip), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    copyText(info.ssid, WiFi.SSID().c_str(), sizeof(info.ssid));
+    wifiRssi = WiFi.RSSI();
+
+    portENTER_CRITICAL(&networkLock);
+    info.version = networkInfo.version + 1;
+    networkInfo = info;
+    portEXIT_CRITICAL(&networkLock);
+}
+
+NetworkInfo currentNetworkInfo() {
+    portENTER_CRITICAL(&networkLock);
+    NetworkInfo info = networkInfo;
+    portEXIT_CRITICAL(&networkLock);
+    return info;
+}
+
+void onWiFiEvent(WiFiEvent_t event) {
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        cacheNetworkInfo();
+    }
+}
 
 void connectToWiFi() {
     Serial.println("\n=== WiFi Configuration ===");
@@ -87,6 +848,9 @@ void connectToWiFi() {
         ESP.restart();
     }
 
+    cacheNetworkInfo();
+    WiFi.onEvent(onWiFiEvent, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+
     Serial.println("\n╔════════════════════════════════════════════════╗");
     Serial.println("║          ✓ WiFi Connected Successfully!        ║");
     Serial.println("╚════════════════════════════════════════════════╝");
@@ -100,628 +864,1638 @@ void connectToWiFi() {
     Serial.println("════════════════════════════════════════════════\n");
 }
 
+void writeHistogram(AsyncResponseStream* out, const char* name, const char* label, const LatencyHistogram& histogram) {
+    LatencyHistogram::Snapshot stats = histogram.snapshot();
+    const uint32_t* bounds = LatencyHistogram::bounds();
+    const char* separator = label[0] ? "," : "";
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < LatencyHistogram::BOUND_COUNT; i++) {
+        cumulative += stats.buckets[i];
+        out->printf("%s_bucket{%s%sle=\"%g\"} %u\n", name, label, separator, bounds[i] / 1e6, cumulative);
+    }
+    out->printf("%s_bucket{%s%sle=\"+Inf\"} %u\n", name, label, separator, stats.count);
+    out->printf("%s_sum{%s} %.6f\n", name, label, stats.sumUs / 1e6);
+    out->printf("%s_count{%s} %u\n", name, label, stats.count);
+}
+
+// Prometheus text format. Streamed, since all the histograms together run
+// to several kilobytes.
+void writeMetrics(AsyncResponseStream* out) {
+    char label[32];
+    out->print("# HELP esp32_stage_duration_seconds Time spent in each pipeline stage.\n"
+               "# TYPE esp32_stage_duration_seconds histogram\n");
+    for (uint8_t i = 0; i < STAGE_COUNT; i++) {
+        snprintf(label, sizeof(label), "stage=\"%s\"", STAGE_NAMES[i]);
+        writeHistogram(out, "esp32_stage_duration_seconds", label, stageLatency[i]);
+    }
+    out->print("# HELP esp32_sample_jitter_seconds Deviation of each sensor's ranging period from its trigger cycle.\n"
+               "# TYPE esp32_sample_jitter_seconds histogram\n");
+    writeHistogram(out, "esp32_sample_jitter_seconds", "", samplePeriodJitter);
+
+    DeviceSnapshot device = deviceState.read();
+    out->print("# TYPE esp32_sensor_distance_cm gauge\n");
+    for (uint8_t i = 0; i < device.sensorCount; i++) {
+        out->printf("esp32_sensor_distance_cm{sensor=\"%u\"} %.1f\n", i, device.sensors[i]);
+    }
+    out->print("# TYPE esp32_sensor_timeouts_total counter\n");
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        out->printf("esp32_sensor_timeouts_total{sensor=\"%u\"} %u\n", i, rangers[i].timeoutCount());
+    }
+    out->printf("# HELP esp32_trigger_cycle_seconds Time for every trigger slot to fire once.\n"
+                "# TYPE esp32_trigger_cycle_seconds gauge\nesp32_trigger_cycle_seconds %.6f\n",
+                triggerScheduler.cycleUs() / 1e6);
+    out->print("# HELP esp32_aws_connect_duration_seconds Duration of one AWS IoT connect attempt.\n"
+               "# TYPE esp32_aws_connect_duration_seconds histogram\n");
+    writeHistogram(out, "esp32_aws_connect_duration_seconds", "", awsConnectDuration);
+    out->print("# HELP esp32_aws_outage_seconds Time from losing AWS IoT until reconnected.\n"
+               "# TYPE esp32_aws_outage_seconds histogram\n");
+    writeHistogram(out, "esp32_aws_outage_seconds", "", awsOutageDuration);
+
+    const PublishPolicy::Counters& counters = publishPolicy.counters();
+    out->print("# TYPE esp32_mqtt_published_total counter\n");
+    for (uint8_t i = PublishPolicy::STATE_CHANGE; i < PublishPolicy::REASON_COUNT; i++) {
+        out->printf("esp32_mqtt_published_total{reason=\"%s\"} %u\n",
+                    PublishPolicy::reasonName((PublishPolicy::Reason)i), counters.published[i]);
+    }
+    out->printf("# TYPE esp32_mqtt_publish_failures_total counter\nesp32_mqtt_publish_failures_total %u\n", counters.failed);
+    out->printf("# TYPE esp32_mqtt_queued_total counter\nesp32_mqtt_queued_total %u\n", counters.queued);
+    out->printf("# TYPE esp32_aws_connect_attempts_total counter\nesp32_aws_connect_attempts_total %u\n", awsConnectAttempts);
+    out->printf("# TYPE esp32_aws_connect_failures_total counter\nesp32_aws_connect_failures_total %u\n", awsConnectFailures);
+    out->printf("# TYPE esp32_dropped_total counter\n"
+                "esp32_dropped_total{queue=\"telemetry\"} %u\nesp32_dropped_total{queue=\"log\"} %u\n",
+                (unsigned)telemetryEventsDropped, (unsigned)logRing.dropped());
+    out->printf("# HELP esp32_dashboard_viewers Open /events streams, one socket each.\n"
+                "# TYPE esp32_dashboard_viewers gauge\nesp32_dashboard_viewers %u\n", (unsigned)events.count());
+    out->printf("# TYPE esp32_dashboard_events_total counter\nesp32_dashboard_events_total %u\n", dashboardEventsSent);
+    out->printf("# TYPE esp32_heap_free_bytes gauge\nesp32_heap_free_bytes %u\n", ESP.getFreeHeap());
+    out->printf("# TYPE esp32_heap_min_free_bytes gauge\nesp32_heap_min_free_bytes %u\n", ESP.getMinFreeHeap());
+    out->printf("# TYPE esp32_heap_max_alloc_bytes gauge\nesp32_heap_max_alloc_bytes %u\n", ESP.getMaxAllocHeap());
+    out->printf("# TYPE esp32_uptime_seconds counter\nesp32_uptime_seconds %lu\n", millis() / 1000);
+}
+
 void setupWebServer() {
     server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
-        String html = R"rawliteral(
-<!DOCTYPE html>
-<html>
-<head>
-    <meta name="viewport" content="width=device-width, initial-scale=1">
-    <title>ESP32 IoT Dashboard</title>
-    <style>
-        * { margin: 0; padding: 0; box-sizing: border-box; }
-        body {
-            font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif;
-            background: linear-gradient(135deg, #667eea 0%, #764ba2 100%);
-            min-height: 100vh;
-            padding: 20px;
-        }
-        .container {
-            max-width: 800px;
-            margin: 0 auto;
-        }
-        .header {
-            background: white;
-            padding: 25px;
-            border-radius: 15px;
-            box-shadow: 0 10px 30px rgba(0,0,0,0.2);
-            margin-bottom: 20px;
-            text-align: center;
-        }
-        .header h1 {
-            color: #667eea;
-            margin-bottom: 5px;
-        }
-        .header p {
-            color: #666;
-            font-size: 14px;
-        }
-        .card {
-            background: white;
-            padding: 25px;
-            border-radius: 15px;
-            box-shadow: 0 10px 30px rgba(0,0,0,0.2);
-            margin-bottom: 20px;
-        }
-        .card h2 {
-            color: #333;
-            margin-bottom: 20px;
-            font-size: 20px;
-            border-bottom: 2px solid #667eea;
-            padding-bottom: 10px;
-        }
-        .sensor-data {
-            display: grid;
-            grid-template-columns: repeat(auto-fit, minmax(200px, 1fr));
-            gap: 15px;
-            margin-bottom: 20px;
-        }
-        .data-item {
-            background: linear-gradient(135deg, #667eea 0%, #764ba2 100%);
-            padding: 20px;
-            border-radius: 10px;
-            color: white;
-            text-align: center;
-        }
-        .data-value {
-            font-size: 36px;
-            font-weight: bold;
-            margin: 10px 0;
-        }
-        .data-label {
-            font-size: 14px;
-            opacity: 0.9;
-        }
-        .status-indicator {
-            display: inline-block;
-            width: 12px;
-            height: 12px;
-            border-radius: 50%;
-            margin-right: 8px;
-        }
-        .status-on { background: #4CAF50; }
-        .status-off { background: #f44336; }
-        .controls {
-            display: flex;
-            gap: 10px;
-            flex-wrap: wrap;
-        }
-        .btn {
-            flex: 1;
-            min-width: 120px;
-            padding: 15px 25px;
-            border: none;
-            border-radius: 8px;
-            font-size: 16px;
-            font-weight: bold;
-            cursor: pointer;
-            transition: all 0.3s;
-        }
-        .btn-on {
-            background: #4CAF50;
-            color: white;
-        }
-        .btn-on:hover {
-            background: #45a049;
-            transform: translateY(-2px);
-            box-shadow: 0 5px 15px rgba(76,175,80,0.4);
-        }
-        .btn-off {
-            background: #f44336;
-            color: white;
-        }
-        .btn-off:hover {
-            background: #da190b;
-            transform: translateY(-2px);
-            box-shadow: 0 5px 15px rgba(244,67,54,0.4);
-        }
-        .btn-auto {
-            background: #2196F3;
-            color: white;
-        }
-        .btn-auto:hover {
-            background: #0b7dda;
-            transform: translateY(-2px);
-            box-shadow: 0 5px 15px rgba(33,150,243,0.4);
-        }
-        .info-grid {
-            display: grid;
-            gap: 10px;
-        }
-        .info-row {
-            display: flex;
-            justify-content: space-between;
-            padding: 10px;
-            background: #f5f5f5;
-            border-radius: 5px;
-        }
-        .info-label {
-            font-weight: bold;
-            color: #666;
-        }
-        .info-value {
-            color: #333;
-        }
-        @media (max-width: 600px) {
-            .data-value { font-size: 28px; }
-            .btn { min-width: 100%; }
-        }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <div class="header">
-            <h1>🌐 ESP32 IoT Dashboard</h1>
-            <p>Real-time Monitoring & Control</p>
-        </div>
-
-        <div class="card">
-            <h2>📊 Sensor Data</h2>
-            <div class="sensor-data">
-                <div class="data-item">
-                    <div class="data-label">Distance</div>
-                    <div class="data-value" id="distance">--</div>
-                    <div class="data-label">centimeters</div>
-                </div>
-                <div class="data-item">
-                    <div class="data-label">LED Status</div>
-                    <div class="data-value" id="ledStatus">--</div>
-                    <div class="data-label">current state</div>
-                </div>
-            </div>
-        </div>
-
-        <div class="card">
-            <h2>🎮 Manual LED Control</h2>
-            <div class="controls">
-                <button class="btn btn-on" onclick="controlLED('on')">Turn ON</button>
-                <button class="btn btn-off" onclick="controlLED('off')">Turn OFF</button>
-                <button class="btn btn-auto" onclick="controlLED('auto')">Auto Mode</button>
-            </div>
-            <p style="margin-top: 15px; color: #666; font-size: 14px;">
-                <span class="status-indicator" id="modeIndicator"></span>
-                <span id="modeText">Mode: Loading...</span>
-            </p>
-        </div>
-
-        <div class="card">
-            <h2>ℹ️ System Information</h2>
-            <div class="info-grid">
-                <div class="info-row">
-                    <span class="info-label">IP Address:</span>
-                    <span class="info-value" id="ipAddress">--</span>
-                </div>
-                <div class="info-row">
-                    <span class="info-label">WiFi SSID:</span>
-                    <span class="info-value" id="ssid">--</span>
-                </div>
-                <div class="info-row">
-                    <span class="info-label">Signal Strength:</span>
-                    <span class="info-value" id="rssi">--</span>
-                </div>
-                <div class="info-row">
-                    <span class="info-label">AWS IoT:</span>
-                    <span class="info-value" id="awsStatus">--</span>
-                </div>
-            </div>
-        </div>
-    </div>
-
-    <script>
-        function updateData() {
-            fetch('/data')
-                .then(response => response.json())
-                .then(data => {
-                    document.getElementById('distance').textContent = data.distance.toFixed(1);
-                    document.getElementById('ledStatus').textContent = data.led_status;
-                    document.getElementById('ipAddress').textContent = data.ip;
-                    document.getElementById('ssid').textContent = data.ssid;
-                    document.getElementById('rssi').textContent = data.rssi + ' dBm';
-                    document.getElementById('awsStatus').textContent = data.aws_connected ? 'Connected' : 'Disconnected';
-
-                    const modeIndicator = document.getElementById('modeIndicator');
-                    const modeText = document.getElementById('modeText');
-                    if (data.manual_mode) {
-                        modeIndicator.className = 'status-indicator status-on';
-                        modeText.textContent = 'Mode: Manual Control';
-                    } else {
-                        modeIndicator.className = 'status-indicator status-off';
-                        modeText.textContent = 'Mode: Automatic (Distance-based)';
-                    }
-                })
-                .catch(error => console.error('Error:', error));
-        }
-
-        function controlLED(action) {
-            fetch('/led?action=' + action)
-                .then(response => response.text())
-                .then(data => {
-                    console.log(data);
-                    updateData();
-                })
-                .catch(error => console.error('Error:', error));
-        }
-
-        setInterval(updateData, 1000);
-        updateData();
-    </script>
-</body>
-</html>
-)rawliteral";
-        request->send(200, "text/html", html);
+        if (request->hasHeader("If-None-Match") &&
+            strcmp(request->getHeader("If-None-Match")->value().c_str(), DASHBOARD_HTML_ETAG) == 0) {
+            AsyncWebServerResponse *response = request->beginResponse(304);
+            response->addHeader("ETag", DASHBOARD_HTML_ETAG);
+            response->addHeader("Cache-Control", "no-cache");
+            request->send(response);
+            return;
+        }
+
+        AsyncWebServerResponse *response = request->beginResponse_P(200, "text/html", DASHBOARD_HTML_GZ, DASHBOARD_HTML_GZ_LEN);
+        response->addHeader("Content-Encoding", "gzip");
+        response->addHeader("ETag", DASHBOARD_HTML_ETAG);
+        response->addHeader("Cache-Control", "no-cache");
+        request->send(response);
     });
 
     server.on("/data", HTTP_GET, [](AsyncWebServerRequest *request){
-        String json = "{";
-        json += "\"distance\":" + String(distance) + ",";
-        json += "\"led_status\":\"" + String(digitalRead(LED_PIN) ? "ON" : "OFF") + "\",";
-        json += "\"manual_mode\":" + String(manualLEDControl ? "true" : "false") + ",";
-        json += "\"ip\":\"" + WiFi.localIP().toString() + "\",";
-        json += "\"ssid\":\"" + WiFi.SSID() + "\",";
-        json += "\"rssi\":" + String(WiFi.RSSI()) + ",";
-        json += "\"aws_connected\":" + String(client.connected() ? "true" : "false");
-        json += "}";
-        request->send(200, "application/json", json);
+        uint8_t index = dataSnapshotIndex;
+        request->send_P(200, "application/json", (const uint8_t*)dataSnapshot[index], dataSnapshotLength[index]);
     });
 
     server.on("/led", HTTP_GET, [](AsyncWebServerRequest *request){
+        if (!request->hasParam("action")) {
+            request->send(400, "text/plain", "Missing action parameter");
+            return;
+        }
+
+        String action = request->getParam("action")->value();
+        const char* name;
+        const char* reply;
+        if (action == "on") {
+            name = "LED_ON";
+            reply = "LED turned ON (Manual Mode)";
+        }
+        else if (action == "off") {
+            name = "LED_OFF";
+            reply = "LED turned OFF (Manual Mode)";
+        }
+        else if (action == "auto") {
+            name = "LED_AUTO";
+            reply = "LED set to Auto Mode (Distance-based)";
+        }
+        else {
+            request->send(400, "text/plain", "Invalid action");
+            return;
+        }
+
+        Command command;
+        const char* id = request->hasParam("correlation_id") ? request->getParam("correlation_id")->value().c_str() : "";
+        prepareCommand(command, name, COMMAND_FROM_WEB, id);
+        if (!submitCommand(command)) {
+            request->send(503, "text/plain", "Busy, try again");
+            return;
+        }
+        request->send(200, "text/plain", reply);
+    });
+
+    // ?action=start|stop controls recording; without it, downloads the last
+    // finished trace.
+    server.on("/trace", HTTP_GET, [](AsyncWebServerRequest *request){
         if (request->hasParam("action")) {
             String action = request->getParam("action")->value();
+            const char* name = action == "start" ? "TRACE_START" : action == "stop" ? "TRACE_STOP" : nullptr;
+            if (!name) {
+                request->send(400, "text/plain", "Invalid action");
+                return;
+            }
+            Command command;
+            prepareCommand(command, name, COMMAND_FROM_WEB, "");
+            if (!submitCommand(command)) {
+                request->send(503, "text/plain", "Busy, try again");
+                return;
+            }
+            request->send(200, "text/plain", action == "start" ? "Trace recording started" : "Trace recording stopped");
+            return;
+        }
 
-            if (action == "on") {
-                manualLEDControl = true;
-                digitalWrite(LED_PIN, HIGH);
-                request->send(200, "text/plain", "LED turned ON (Manual Mode)");
+        if (traceActive || traceFileOpen) {
+            request->send(409, "text/plain", "Trace still recording");
+            return;
+        }
+        if (!LittleFS.exists(TRACE_FILE)) {
+            request->send(404, "text/plain", "No trace recorded");
+            return;
+        }
+        request->send(LittleFS, TRACE_FILE, "text/plain", true);
+    });
 
-                if (client.connected()) {
-                    publishCloudAcknowledgment("WEB_LED_ON", "SUCCESS");
-                }
-            }
-            else if (action == "off") {
-                manualLEDControl = true;
-                digitalWrite(LED_PIN, LOW);
-                request->send(200, "text/plain", "LED turned OFF (Manual Mode)");
+    server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request){
+        AsyncResponseStream* response = request->beginResponseStream("text/plain; version=0.0.4");
+        writeMetrics(response);
+        request->send(response);
+    });
 
-                if (client.connected()) {
-                    publishCloudAcknowledgment("WEB_LED_OFF", "SUCCESS");
-                }
+    server.on("/config", HTTP_GET, [](AsyncWebServerRequest *request){
+        if (request->params() == 0) {
+            uint8_t payload[CONFIG_PAYLOAD_SIZE];
+            if (writeConfigPayload(payload, sizeof(payload), PayloadWriter::JSON, currentConfig()) == 0) {
+                request->send(500);
+                return;
             }
-            else if (action == "auto") {
-                manualLEDControl = false;
-                request->send(200, "text/plain", "LED set to Auto Mode (Distance-based)");
+            request->send(200, "application/json", (const char*)payload);
+            return;
+        }
 
-                if (client.connected()) {
-                    publishCloudAcknowledgment("WEB_LED_AUTO", "SUCCESS");
-                }
-            }
-            else {
-                request->send(400, "text/plain", "Invalid action");
+        // Check every setting first and queue them together, so a bad or
+        // busy request changes nothing.
+        if (request->params() > DeviceConfig::FIELD_COUNT) {
+            request->send(400, "text/plain", "Too many settings");
+            return;
+        }
+        DeviceConfig scratch = currentConfig();
+        Command commands[DeviceConfig::FIELD_COUNT];
+        for (size_t i = 0; i < request->params(); i++) {
+            AsyncWebParameter* param = request->getParam(i);
+            DeviceConfig::Result result = scratch.set(param->name().c_str(), param->value().c_str());
+            if (result == DeviceConfig::UNKNOWN_KEY || result == DeviceConfig::INVALID_VALUE) {
+                request->send(400, "text/plain", "Invalid setting: " + param->name());
+                return;
             }
-        } else {
-            request->send(400, "text/plain", "Missing action parameter");
+            prepareCommand(commands[i], "SET_CONFIG", COMMAND_FROM_WEB, "");
+            copyText(commands[i].args[0], param->name().c_str(), COMMAND_ARG_SIZE);
+            copyText(commands[i].args[1], param->value().c_str(), COMMAND_ARG_SIZE);
         }
+
+        if (!submitCommands(commands, request->params())) {
+            request->send(503, "text/plain", "Busy, try again");
+            return;
+        }
+        request->send(200, "text/plain", "Settings updated");
+    });
+
+    events.onConnect([](AsyncEventSourceClient *viewer){
+        viewer->send(dataSnapshot[dataSnapshotIndex], "data", millis());
     });
+    server.addHandler(&events);
 
     server.begin();
     Serial.println("✓ Web Server Started!");
     Serial.println("Access dashboard at: http://" + WiFi.localIP().toString());
 }
 
-void connectToAWS() {
-    Serial.println("\n=== AWS IoT Cloud Configuration ===");
-    Serial.println("Synchronizing time with NTP server...");
-    configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+bool cloudReady() {
+    return awsLinkState.load() == AWS_CONNECTED;
+}
+
+const char* mqttStateName(int state) {
+    switch (state) {
+        case -4: return "MQTT_CONNECTION_TIMEOUT";
+        case -3: return "MQTT_CONNECTION_LOST";
+        case -2: return "MQTT_CONNECT_FAILED";
+        case -1: return "MQTT_DISCONNECTED";
+        case 0: return "MQTT_CONNECTED";
+        case 1: return "MQTT_CONNECT_BAD_PROTOCOL";
+        case 2: return "MQTT_CONNECT_BAD_CLIENT_ID";
+        case 3: return "MQTT_CONNECT_UNAVAILABLE";
+        case 4: return "MQTT_CONNECT_BAD_CREDENTIALS";
+        case 5: return "MQTT_CONNECT_UNAUTHORIZED";
+        default: return "UNKNOWN_ERROR";
+    }
+}
+
+void printMQTTState(int state) {
+    LOG_ERROR("MQTT State: %d - %s", state, mqttStateName(state));
+}
+
+// Polled by the network task, which must keep draining telemetry while NTP
+// settles. After NTP_SYNC_TIMEOUT_MS it stops waiting and lets TLS try anyway.
+bool timeSyncSettled() {
+    if (timeSyncDone) return true;
+    if (!timeSyncStarted) {
+        LOG_INFO("Synchronizing time with NTP server...");
+        timeSyncStart = millis();
+        timeSyncStarted = true;
+    }
 
     time_t now = time(nullptr);
-    int retries = 0;
-    while (now < 8 * 3600 * 2 && retries < 20) {
-        delay(500);
-        Serial.print(".");
-        now = time(nullptr);
-        retries++;
+    if (now < 8 * 3600 * 2 && millis() - timeSyncStart < NTP_SYNC_TIMEOUT_MS) {
+        return false;
     }
+    timeSyncDone = true;
 
     if (now < 8 * 3600 * 2) {
-        Serial.println("\n❌ Failed to get time from NTP server!");
-        Serial.println("⚠️ SSL/TLS may fail without accurate time.");
+        LOG_ERROR("❌ Failed to get time from NTP server!");
+        LOG_WARN("⚠️ SSL/TLS may fail without accurate time.");
     } else {
-        Serial.println("\n✓ Time synchronized successfully!");
+        LOG_INFO("✓ Time synchronized successfully!");
         struct tm timeinfo;
         gmtime_r(&now, &timeinfo);
-        Serial.print("Current time: ");
-        Serial.println(asctime(&timeinfo));
+        char timeText[32];
+        strftime(timeText, sizeof(timeText), "%Y-%m-%d %H:%M:%S UTC", &timeinfo);
+        LOG_INFO("Current time: %s", timeText);
+    }
+    return true;
+}
+
+void onAWSConnected(bool firstConnection) {
+    if (firstConnection) {
+        LOG_INFO("✓ Connected to AWS IoT Cloud as %s", AWS_IOT_CLIENT_ID);
+        LOG_INFO("Publish Topic: %s", AWS_IOT_PUBLISH_TOPIC);
+        LOG_INFO("Subscribe Topic: %s", AWS_IOT_SUBSCRIBE_TOPIC);
+    } else {
+        LOG_INFO("✓ Reconnected to AWS IoT Cloud!");
+    }
+
+    if (client.subscribe(AWS_IOT_SUBSCRIBE_TOPIC)) {
+        LOG_INFO("✓ Subscribed to command topic");
+    } else {
+        LOG_ERROR("❌ Failed to subscribe to command topic");
+    }
+
+    // Fetch the shadow once for its version and any desired state set while
+    // we were offline; after that only deltas arrive.
+    if (client.subscribe(SHADOW_DELTA_TOPIC) && client.subscribe(SHADOW_GET_ACCEPTED_TOPIC) &&
+        client.publish(SHADOW_GET_TOPIC, "")) {
+        LOG_INFO("✓ Subscribed to device shadow");
+    } else {
+        LOG_ERROR("❌ Failed to subscribe to device shadow");
+    }
+    shadow.resync();
+
+    JsonDocument doc;
+    doc["device_id"] = AWS_IOT_CLIENT_ID;
+    doc["status"] = firstConnection ? "CONNECTED" : "RECONNECTED";
+    doc["message"] = firstConnection ? "Device connected to AWS IoT Cloud" : "Device reconnected to AWS IoT Cloud";
+    NetworkInfo network = currentNetworkInfo();
+    doc["ip_address"] = network.ip;
+    DeviceConfig config = currentConfig();
+    doc["threshold"] = config.thresholdCm;
+    doc["sample_rate_hz"] = config.sampleRateHz;
+    doc["batch_size"] = batchedTelemetry ? TELEMETRY_BATCH_SIZE : 0;
+    doc["sensors"] = SENSOR_COUNT;
+    doc["trigger_slots"] = triggerScheduler.slots();
+
+    const TlsConnectStats& tls = net.lastConnect();
+    doc["tls_handshake_ms"] = tls.handshakeMs;
+    doc["tls_resumed"] = tls.resumed;
+    doc["tls_heap_peak_bytes"] = tls.freeHeapBefore - tls.minFreeHeap;
+    doc["tls_heap_held_bytes"] = (int32_t)(tls.freeHeapBefore - tls.freeHeapAfter);
+    doc["tls_resumed_total"] = net.resumedCount();
+    doc["tls_connect_total"] = net.connectCount();
+    doc["tls_session_bytes"] = tls.sessionBytes;
+    doc["tls_session_save_failures"] = net.sessionSaveFailureCount();
+    publishDocument(AWS_IOT_PUBLISH_TOPIC, TOPIC_DATA, doc);
+}
+
+void printTlsStats() {
+    const TlsConnectStats& tls = net.lastConnect();
+    LOG_INFO("🔐 TLS: tcp %u ms, handshake %u ms (%s)", (unsigned)tls.tcpMs, (unsigned)tls.handshakeMs,
+             tls.resumed ? "resumed" : (tls.offeredSession ? "full, session rejected" : "full"));
+    LOG_INFO("🔐 TLS heap: %u before, %u lowest during handshake, %u after", (unsigned)tls.freeHeapBefore,
+             (unsigned)tls.minFreeHeap, (unsigned)tls.freeHeapAfter);
+    if (tls.error != 0) {
+        LOG_ERROR("❌ TLS error: -0x%X", (unsigned)-tls.error);
+    }
+    // Every connect would fail the same way, so once is enough.
+    static bool sessionSaveFailureLogged = false;
+    if (tls.sessionSaveError != 0 && !sessionSaveFailureLogged) {
+        LOG_WARN("⚠️ TLS session not saved (-0x%X), reconnects will do a full handshake",
+                 (unsigned)-tls.sessionSaveError);
+        sessionSaveFailureLogged = true;
+    }
+}
+
+// Keeps the MQTT session alive. The connect itself blocks for the TCP and
+// TLS handshake, which is why it runs on the network task and not where
+// sampling happens; telemetry arriving meanwhile waits in telemetryEvents.
+void maintainAWSConnection() {
+    if (cloudReady()) {
+        if (client.connected()) {
+            StageTimer timer(STAGE_MQTT_LOOP);
+            client.loop();
+            return;
+        }
+        LOG_WARN("⚠️ Lost connection to AWS IoT Cloud");
+        awsLostTime = millis();
+        awsBackoff.restart(millis(), esp_random());
+        awsLinkState = AWS_DISCONNECTED;
+        return;
+    }
+
+    if (!WiFi.isConnected() || !awsBackoff.due(millis()) || !timeSyncSettled()) {
+        return;
+    }
+
+    awsLinkState = AWS_CONNECTING;
+    LOG_INFO("%s", awsEverConnected ? "🔄 Attempting to reconnect to AWS IoT Cloud..." : "Connecting to AWS IoT Cloud...");
+
+    unsigned long connectStart = millis();
+    bool connected = client.connect(AWS_IOT_CLIENT_ID);
+    awsConnectDuration.record((millis() - connectStart) * 1000);
+    awsConnectAttempts++;
+    printTlsStats();
+    if (connected) {
+        if (awsEverConnected) {
+            awsOutageDuration.record((millis() - awsLostTime) * 1000);
+        }
+        onAWSConnected(!awsEverConnected);
+        awsEverConnected = true;
+        awsBackoff.onSuccess();
+        awsLinkState = AWS_CONNECTED;
+        return;
     }
 
+    awsBackoff.onFailure(millis(), esp_random());
+    awsLinkState = AWS_DISCONNECTED;
+    awsConnectFailures++;
+
+    LOG_ERROR("❌ AWS IoT connection failed.");
+    printMQTTState(client.state());
+    if (!awsEverConnected && awsBackoff.failureCount() == 1) {
+        LOG_WARN("⚠️ Possible causes: wrong endpoint, certificate/key format, port 8883 blocked,");
+        LOG_WARN("⚠️ policy not attached, certificate not activated, or time sync failed.");
+        LOG_WARN("⚠️ System will continue with local functionality.");
+    }
+    LOG_INFO("🔄 Retrying in %u ms", (unsigned)awsBackoff.currentDelay());
+}
+
+// Sends the reported fields that changed since the last update, at most
+// once per SHADOW_MIN_INTERVAL_MS so a burst of LED flips is one message.
+void syncShadow() {
+    StageTimer timer(STAGE_SHADOW);
+    DeviceSnapshot device = deviceState.read();
+    DeviceConfig config = currentConfig();
+    size_t count;
+    const DeviceConfig::Field* fields = DeviceConfig::fields(count);
+
+    shadow.set(SHADOW_LED_STATUS, device.ledOn);
+    shadow.set(SHADOW_MANUAL_MODE, device.manual);
+    for (size_t i = 0; i < count; i++) {
+        shadow.set(SHADOW_CONFIG_FIRST + i, config.*(fields[i].member));
+    }
+
+    shadow.clearDesired(shadowOverrides.exchange(0));
+
+    uint32_t pending = shadow.pending();
+    uint32_t clears = shadow.pendingClears();
+    if ((pending == 0 && clears == 0) || !cloudReady() || millis() - lastShadowUpdateTime < SHADOW_MIN_INTERVAL_MS) {
+        return;
+    }
+
+    JsonDocument doc;
+    JsonObject reported = doc["state"]["reported"].to<JsonObject>();
+    if (pending & (1u << SHADOW_LED_STATUS)) {
+        reported["led_status"] = shadow.value(SHADOW_LED_STATUS) ? "ON" : "OFF";
+    }
+    if (pending & (1u << SHADOW_MANUAL_MODE)) {
+        reported["manual_mode"] = shadow.value(SHADOW_MANUAL_MODE) != 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (pending & (1u << (SHADOW_CONFIG_FIRST + i))) {
+            reported[fields[i].key] = shadow.value(SHADOW_CONFIG_FIRST + i);
+        }
+    }
+    if (clears) {
+        JsonObject desired = doc["state"]["desired"].to<JsonObject>();
+        if (clears & (1u << SHADOW_LED_STATUS)) desired["led_status"] = nullptr;
+        if (clears & (1u << SHADOW_MANUAL_MODE)) desired["manual_mode"] = nullptr;
+        for (size_t i = 0; i < count; i++) {
+            if (clears & (1u << (SHADOW_CONFIG_FIRST + i))) desired[fields[i].key] = nullptr;
+        }
+    }
+
+    char payload[SHADOW_PAYLOAD_SIZE];
+    size_t length = serializeJson(doc, payload, sizeof(payload));
+    lastShadowUpdateTime = millis();
+    if (length > 0 && length < sizeof(payload) && client.publish(SHADOW_UPDATE_TOPIC, payload)) {
+        shadow.markReported(pending);
+        shadow.markCleared(clears);
+        shadowUpdates++;
+    } else {
+        LOG_ERROR("❌ Shadow update failed");
+    }
+}
+
+StageSummary summarize(const LatencyHistogram& histogram) {
+    LatencyHistogram::Snapshot stats = histogram.snapshot();
+    return {stats.count, stats.count ? (uint32_t)(stats.sumUs / stats.count) : 0,
+            LatencyHistogram::quantileUs(stats, 0.99f), stats.maxUs};
+}
+
+// Optional summary of /metrics on MQTT, every metrics_interval_ms.
+void publishMetrics() {
+    uint32_t interval = currentConfig().metricsIntervalMs;
+    if (interval == 0 || !cloudReady()) return;
+    if (interval < METRICS_MIN_INTERVAL_MS) interval = METRICS_MIN_INTERVAL_MS;
+    if (millis() - lastMetricsTime < interval) return;
+    lastMetricsTime = millis();
+
+    const PublishPolicy::Counters& counters = publishPolicy.counters();
+    StageSummary stages[STAGE_COUNT];
+    for (uint8_t i = 0; i < STAGE_COUNT; i++) stages[i] = summarize(stageLatency[i]);
+    MetricsFields fields = {AWS_IOT_CLIENT_ID, (uint32_t)(millis() / 1000), ESP.getFreeHeap(),
+                            ESP.getMinFreeHeap(), ESP.getMaxAllocHeap(), publishPolicy.totalPublished(),
+                            counters.failed, counters.queued, awsConnectAttempts, awsConnectFailures,
+                            STAGE_NAMES, stages, STAGE_COUNT, summarize(samplePeriodJitter),
+                            summarize(awsConnectDuration), PAYLOAD_SCHEMA_VERSION};
+    // Static rather than on the network task's stack, which is the only caller.
+    static uint8_t payload[METRICS_PAYLOAD_SIZE];
+    size_t length = writeMetricsPayload(payload, sizeof(payload), topicFormats[TOPIC_METRICS], fields);
+    if (length == 0 || !client.publish(AWS_IOT_METRICS_TOPIC, payload, length)) {
+        LOG_ERROR("❌ Metrics publish failed");
+    }
+}
+
+bool submitShadowCommand(const char* name, const char* key, const char* value) {
+    Command command;
+    prepareCommand(command, name, COMMAND_FROM_SHADOW, "");
+    if (key) {
+        copyText(command.args[0], key, COMMAND_ARG_SIZE);
+        copyText(command.args[1], value, COMMAND_ARG_SIZE);
+    }
+    if (!submitCommand(command)) {
+        LOG_WARN("⚠️ Command queue full, shadow change dropped");
+        return false;
+    }
+    return true;
+}
+
+// Turns desired state into commands. led_status implies manual mode;
+// manual_mode=false alone returns the LED to automatic control. Every key
+// handed on is deleted from desired with the next update, which also
+// reports the value the device ended up with.
+void applyDesiredState(JsonObjectConst desired) {
+    uint32_t applied = 0;
+    const char* led = desired["led_status"];
+    bool manualGiven = desired["manual_mode"].is<bool>();
+    bool submitted = true;
+    if (led && strcmp(led, "ON") == 0) {
+        submitted = submitShadowCommand("LED_ON", nullptr, nullptr);
+    } else if (led && strcmp(led, "OFF") == 0) {
+        submitted = submitShadowCommand("LED_OFF", nullptr, nullptr);
+    } else if (manualGiven) {
+        bool manual = desired["manual_mode"];
+        DeviceSnapshot device = deviceState.read();
+        if (!manual) {
+            submitted = submitShadowCommand("LED_AUTO", nullptr, nullptr);
+        } else if (!device.manual) {
+            submitted = submitShadowCommand(device.ledOn ? "LED_ON" : "LED_OFF", nullptr, nullptr);
+        }
+    }
+    if (submitted && led) applied |= 1u << SHADOW_LED_STATUS;
+    if (submitted && manualGiven) applied |= 1u << SHADOW_MANUAL_MODE;
+
+    size_t count;
+    const DeviceConfig::Field* fields = DeviceConfig::fields(count);
+    for (size_t i = 0; i < count; i++) {
+        JsonVariantConst value = desired[fields[i].key];
+        if (value.isNull()) continue;
+        char text[COMMAND_ARG_SIZE];
+        serializeJson(value, text, sizeof(text));
+        if (submitShadowCommand("SET_CONFIG", fields[i].key, text)) {
+            applied |= 1u << (SHADOW_CONFIG_FIRST + i);
+        }
+    }
+    shadow.clearDesired(applied);
+}
+
+void handleShadowMessage(const char* topic, JsonDocument& doc) {
+    uint32_t version = doc["version"] | 0;
+
+    if (strcmp(topic, SHADOW_GET_ACCEPTED_TOPIC) == 0) {
+        shadow.resetVersion(version);
+        LOG_INFO("✓ Device shadow at version %u", (unsigned)version);
+        JsonObjectConst delta = doc["state"]["delta"];
+        if (!delta.isNull()) {
+            applyDesiredState(delta);
+            shadowDeltasApplied++;
+        }
+        return;
+    }
+
+    if (!shadow.acceptDelta(version)) {
+        LOG_WARN("⚠️ Ignoring stale shadow delta, version %u", (unsigned)version);
+        shadowDeltasStale++;
+        return;
+    }
+    LOG_INFO("🔄 Shadow delta, version %u", (unsigned)version);
+    applyDesiredState(doc["state"]);
+    shadowDeltasApplied++;
+}
+
+void handleTelemetry(const TelemetrySample& sample) {
+    if (sample.reason == PublishPolicy::BATCH) {
+        TelemetryBatch<TELEMETRY_BATCH_SIZE, SENSOR_COUNT>& batch = telemetryBatches[sample.batchIndex];
+        if (cloudReady()) {
+            bool published = publishTelemetryBatch(batch, millis());
+            publishPolicy.markPublished(PublishPolicy::BATCH, published);
+            if (!published) queueOfflineBatch(batch, sample.manual);
+        } else {
+            queueOfflineBatch(batch, sample.manual);
+            publishPolicy.markQueued();
+        }
+        batch.clear();
+        batchInFlight = false;
+        return;
+    }
+
+    // Answers to GET_STATUS are neither counted nor replayed.
+    if (sample.reason == PublishPolicy::REQUEST) {
+        if (cloudReady()) {
+            publishMessage(sample, PublishPolicy::reasonName(sample.reason));
+        }
+        return;
+    }
+
+    if (cloudReady()) {
+        bool published = publishMessage(sample, PublishPolicy::reasonName(sample.reason));
+        publishPolicy.markPublished(sample.reason, published);
+        if (!published) {
+            queueOfflineSample(sample);
+        }
+    } else {
+        queueOfflineSample(sample);
+        publishPolicy.markQueued();
+    }
+}
+
+// The only task that touches the MQTT client, the TLS socket and the offline
+// queue. It wakes for every telemetry event and at least every
+// NETWORK_POLL_INTERVAL_MS to service the connection.
+void networkTask(void* parameter) {
+    TaskLoad& load = tasks[TASK_NETWORK].load;
+
+    for (;;) {
+        TelemetrySample sample;
+        bool received = xQueueReceive(telemetryEvents, &sample, pdMS_TO_TICKS(NETWORK_POLL_INTERVAL_MS)) == pdPASS;
+        load.begin(micros());
+
+        maintainAWSConnection();
+        maintainConfig();
+        syncShadow();
+        publishMetrics();
+
+        flushAcks();
+
+        if (received) {
+            do {
+                handleTelemetry(sample);
+            } while (xQueueReceive(telemetryEvents, &sample, 0) == pdPASS);
+        } else if (cloudReady() && offlineQueue.pending() > 0 && millis() - lastReplayTime >= REPLAY_INTERVAL_MS) {
+            replayOfflineQueue();
+            lastReplayTime = millis();
+        }
+
+        if (millis() - lastQueueFlushTime >= OFFLINE_FLUSH_INTERVAL_MS) {
+            offlineQueue.flush();
+            lastQueueFlushTime = millis();
+        }
+
+        load.end(micros());
+    }
+}
+
+void connectToAWS() {
+    Serial.println("\n=== AWS IoT Cloud Configuration ===");
+    configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+
     Serial.println("Configuring certificates...");
-    net.setCACert(AWS_CERT_CA);
-    net.setCertificate(AWS_CERT_CRT);
-    net.setPrivateKey(AWS_CERT_PRIVATE);
-    client.setServer(AWS_IOT_ENDPOINT, 8883);
+    net.setCredentials(AWS_IOT_CA, AWS_IOT_CERT, AWS_IOT_KEY);
+    client.setServer(AWS_IOT_HOST, AWS_IOT_PORT);
     client.setKeepAlive(60);
+    client.setBufferSize(MQTT_CLIENT_BUFFER_SIZE);
 
-    Serial.print("Connecting to AWS IoT Cloud");
-    Serial.println();
     Serial.print("Endpoint: ");
-    Serial.println(AWS_IOT_ENDPOINT);
+    Serial.println(AWS_IOT_HOST);
     Serial.print("Client ID: ");
     Serial.println(AWS_IOT_CLIENT_ID);
-    Serial.print("Port: 8883");
-    Serial.println();
-
-    int attempts = 0;
-    while (!client.connect(AWS_IOT_CLIENT_ID) && attempts < 50) {
-        Serial.print(".");
-        delay(200);
-        attempts++;
-
-        if (attempts % 10 == 0) {
-            int state = client.state();
-            Serial.println();
-            Serial.print("MQTT State: ");
-            Serial.print(state);
-            Serial.print(" - ");
-            switch (state) {
-                case -4: Serial.println("MQTT_CONNECTION_TIMEOUT"); break;
-                case -3: Serial.println("MQTT_CONNECTION_LOST"); break;
-                case -2: Serial.println("MQTT_CONNECT_FAILED"); break;
-                case -1: Serial.println("MQTT_DISCONNECTED"); break;
-                case 0: Serial.println("MQTT_CONNECTED"); break;
-                case 1: Serial.println("MQTT_CONNECT_BAD_PROTOCOL"); break;
-                case 2: Serial.println("MQTT_CONNECT_BAD_CLIENT_ID"); break;
-                case 3: Serial.println("MQTT_CONNECT_UNAVAILABLE"); break;
-                case 4: Serial.println("MQTT_CONNECT_BAD_CREDENTIALS"); break;
-                case 5: Serial.println("MQTT_CONNECT_UNAUTHORIZED"); break;
-                default: Serial.println("UNKNOWN_ERROR"); break;
-            }
-            Serial.print("Continuing... ");
-        }
-    }
-
-    if (!client.connected()) {
-        Serial.println("\n❌ AWS IoT connection failed (timeout).");
-        int state = client.state();
-        Serial.print("Final MQTT State Code: ");
-        Serial.println(state);
-        Serial.println("\n⚠️ Possible causes:");
-        Serial.println("  1. Incorrect AWS IoT endpoint");
-        Serial.println("  2. Certificate/key format issues");
-        Serial.println("  3. Network blocking port 8883");
-        Serial.println("  4. Policy not attached to certificate in AWS");
-        Serial.println("  5. Certificate not activated in AWS IoT Core");
-        Serial.println("  6. Time synchronization failed");
-        Serial.println("\n⚠️ System will continue with local functionality.");
-        Serial.println("🔄 Will retry connection in the background...");
-        awsConnected = false;
-        return;
+    Serial.print("Port: ");
+    Serial.println(AWS_IOT_PORT);
+
+    xTaskCreatePinnedToCore(networkTask, "network", NETWORK_STACK_SIZE, nullptr, NETWORK_PRIORITY,
+                            &tasks[TASK_NETWORK].handle, NETWORK_CORE);
+    Serial.println("🔄 Connecting to AWS IoT Cloud in the background...");
+}
+
+void IRAM_ATTR forwardRangeSample(uint8_t sensor) {
+    RangeSample sample;
+    if (!rangers[sensor].takeSample(sample)) return;
+    sample.sensor = sensor;
+    if (sampleRing.push(sample) && tasks[TASK_SENSING].handle) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(tasks[TASK_SENSING].handle, &woken);
+        if (woken) portYIELD_FROM_ISR();
     }
+}
 
-    Serial.println("\n╔════════════════════════════════════════════════╗");
-    Serial.println("║     ✓ Connected to AWS IoT Cloud!             ║");
-    Serial.println("╚════════════════════════════════════════════════╝");
-    Serial.print("Endpoint: ");
-    Serial.println(AWS_IOT_ENDPOINT);
-    Serial.print("Client ID: ");
-    Serial.println(AWS_IOT_CLIENT_ID);
-    Serial.print("Publish Topic: ");
-    Serial.println(AWS_IOT_PUBLISH_TOPIC);
-    Serial.print("Subscribe Topic: ");
-    Serial.println(AWS_IOT_SUBSCRIBE_TOPIC);
-    Serial.println("════════════════════════════════════════════════\n");
+void IRAM_ATTR triggerSensors(uint32_t mask) {
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (mask & (1u << i)) digitalWrite(SENSORS[i].trig, HIGH);
+    }
+    delayMicroseconds(10);
+    uint32_t now = micros();
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (!(mask & (1u << i))) continue;
+        digitalWrite(SENSORS[i].trig, LOW);
+        rangers[i].onTrigger(now);
+        forwardRangeSample(i);
+    }
+}
 
-    if (client.subscribe(AWS_IOT_SUBSCRIBE_TOPIC)) {
-        Serial.println("✓ Subscribed to command topic");
-    } else {
-        Serial.println("❌ Failed to subscribe to command topic");
+void IRAM_ATTR onRangingTimer() {
+    uint32_t busy = 0;
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (rangers[i].currentState() != UltrasonicRanger::IDLE) busy |= 1u << i;
     }
+    uint32_t fire = triggerScheduler.poll(micros(), busy);
+    if (fire) triggerSensors(fire);
+}
 
-    JsonDocument doc;
-    doc["device_id"] = AWS_IOT_CLIENT_ID;
-    doc["status"] = "CONNECTED";
-    doc["message"] = "Device connected to AWS IoT Cloud";
-    doc["ip_address"] = WiFi.localIP().toString();
+void IRAM_ATTR onEchoChange(void* arg) {
+    uint8_t sensor = (uint8_t)(uintptr_t)arg;
+    rangers[sensor].onEchoEdge(digitalRead(SENSORS[sensor].echo), micros());
+    forwardRangeSample(sensor);
+}
 
-    char jsonBuffer[256];
-    serializeJson(doc, jsonBuffer);
-    client.publish(AWS_IOT_PUBLISH_TOPIC, jsonBuffer);
+void attachEchoInterrupts() {
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        digitalWrite(SENSORS[i].trig, LOW);
+        attachInterruptArg(digitalPinToInterrupt(SENSORS[i].echo), onEchoChange, (void*)(uintptr_t)i, CHANGE);
+    }
+}
 
-    awsConnected = true;
+void startRanging() {
+    attachEchoInterrupts();
+    uint8_t slots[SENSOR_COUNT];
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) slots[i] = SENSORS[i].slot;
+    triggerScheduler.setSlots(slots);
+    triggerScheduler.setMinPeriod(1000000 / deviceConfig.sampleRateHz);
+
+    rangingTimer = timerBegin(0, 80, true);
+    timerAttachInterrupt(rangingTimer, &onRangingTimer, true);
+    timerAlarmWrite(rangingTimer, SCHEDULER_TICK_US, true);
+    timerAlarmEnable(rangingTimer);
 }
 
-void reconnectAWS() {
-    if (millis() - lastAWSReconnectAttempt > awsReconnectInterval) {
-        lastAWSReconnectAttempt = millis();
-        Serial.println("🔄 Attempting to reconnect to AWS IoT Cloud...");
+void readSensorData(bool batching) {
+    StageTimer timer(STAGE_SENSE);
+    // With several slots a sensor waits for the others before it fires again.
+    uint32_t periodUs = triggerScheduler.sensorPeriodUs();
+    RangeSample sample;
+    while (sampleRing.pop(sample)) {
+        uint8_t sensor = sample.sensor;
+        if (lastRangeSampleUs[sensor] != 0) {
+            int32_t error = (int32_t)(sample.timestampUs - lastRangeSampleUs[sensor] - periodUs);
+            samplePeriodJitter.record(error < 0 ? -error : error);
+        }
+        lastRangeSampleUs[sensor] = sample.timestampUs;
 
-        if (client.connect(AWS_IOT_CLIENT_ID)) {
-            Serial.println("✓ Reconnected to AWS IoT Cloud!");
-            client.subscribe(AWS_IOT_SUBSCRIBE_TOPIC);
-            awsConnected = true;
+        uint32_t now = millis();
+        traceSample(now, sensor, sample.distance);
+        SensingPipeline<SENSOR_COUNT>::Step step = sensing.addSample(sensor, sample.distance, now);
+        if (step.rowComplete && batching) {
+            telemetryBatches[fillingBatch].add(now, sensing.distance, ledController.isOn(), sensing.sensorDistance);
+        }
 
-            JsonDocument doc;
-            doc["device_id"] = AWS_IOT_CLIENT_ID;
-            doc["status"] = "RECONNECTED";
-            doc["message"] = "Device reconnected to AWS IoT Cloud";
+        if (step.ledChanged) {
+            traceLed(now);
+            applyLEDState();
+            if (ledController.isOn()) {
+                LOG_INFO("LED: ON (Object detected within %u cm)", (unsigned)ledController.onThreshold());
+            } else {
+                LOG_INFO("LED: OFF");
+            }
+        }
+    }
+}
 
-            char jsonBuffer[256];
-            serializeJson(doc, jsonBuffer);
-            client.publish(AWS_IOT_PUBLISH_TOPIC, jsonBuffer);
+bool sendTelemetry(const TelemetrySample& sample) {
+    if (xQueueSend(telemetryEvents, &sample, 0) == pdPASS) {
+        traceSend(sample);
+        return true;
+    }
+    telemetryEventsDropped++;
+    return false;
+}
+
+// Runs the publish policy next to the data and hands anything worth sending
+// to the network task. The policy only commits a sample once the queue has
+// taken it, so a full queue means the same change is offered again later.
+void submitTelemetry(bool batching) {
+    uint32_t now = millis();
+    TelemetrySample sample = currentSample(now, PublishPolicy::NONE);
+    traceLink(now, batching);
+    traceTick(now);
+
+    // A full batch goes out while the other buffer fills; the network task
+    // queues it offline if the cloud is down. While it still holds the
+    // previous batch, or the telemetry queue is full, this one stays full and
+    // is offered again on the next pass, and rows that come in meanwhile are
+    // not kept.
+    if (batching && telemetryBatches[fillingBatch].full() && sensing.canHandOffBatch(batchInFlight)) {
+        TelemetrySample handoff = sample;
+        handoff.reason = PublishPolicy::BATCH;
+        handoff.batchIndex = fillingBatch;
+        batchInFlight = true;
+        if (sendTelemetry(handoff)) {
+            sensing.commit(now);
+            fillingBatch ^= 1;
+            telemetryBatches[fillingBatch].clear();
         } else {
-            Serial.println("❌ AWS IoT reconnection failed. Will retry...");
-            awsConnected = false;
+            batchInFlight = false;
+        }
+    }
+
+    PublishPolicy::Reason reason = sensing.evaluate(batching, now);
+    if (reason == PublishPolicy::NONE) return;
+
+    sample.reason = reason;
+    if (sendTelemetry(sample)) sensing.commit(now);
+}
+
+// Woken by the echo ISR for every new sample and by submitCommand(), or after
+// SENSING_IDLE_TIMEOUT_MS so heartbeats still go out without a sensor.
+void sensingTask(void* parameter) {
+    TaskLoad& load = tasks[TASK_SENSING].load;
+    bool batching = false;
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SENSING_IDLE_TIMEOUT_MS));
+        load.begin(micros());
+
+        if (batching != batchedTelemetry) {
+            batching = batchedTelemetry;
+            telemetryBatches[fillingBatch].clear();
+        }
+        if (traceStartRequested) startTrace(millis());
+        traceLink(millis(), batching);
+        {
+            StageTimer timer(STAGE_COMMANDS);
+            runCommands();
+        }
+        readSensorData(batching);
+        {
+            StageTimer timer(STAGE_SUBMIT);
+            submitTelemetry(batching);
         }
+
+        DeviceSnapshot snapshot = {sensing.distance, (uint32_t)millis(), ledController.isOn(),
+                                   ledController.isManual(), SENSOR_COUNT, {}};
+        memcpy(snapshot.sensors, sensing.sensorDistance, sizeof(sensing.sensorDistance));
+        deviceState.publish(snapshot);
+
+        load.end(micros());
     }
 }
 
-float readUltrasonicDistance() {
-    digitalWrite(TRIG_PIN, LOW);
-    delayMicroseconds(2);
-    digitalWrite(TRIG_PIN, HIGH);
-    delayMicroseconds(10);
-    digitalWrite(TRIG_PIN, LOW);
-    long duration = pulseIn(ECHO_PIN, HIGH, 30000);
-    if (duration == 0) {
-        return -1;
+// Sends live viewers what changed since the last snapshot.
+void pushDashboardDelta(const DashboardState& state, const DeviceSnapshot& device, const NetworkInfo& network,
+                        bool full) {
+    if (events.count() == 0) return;
+
+    char delta[DATA_SNAPSHOT_SIZE];
+    if (writeDashboardDelta(delta, sizeof(delta), device, state, dashboardState, network.ip, network.ssid, full) > 0) {
+        events.send(delta, "data", millis());
+        dashboardEventsSent++;
     }
-    float dist = duration * 0.0343 / 2;
-    return dist;
 }
 
-void readSensorData() {
-    distance = readUltrasonicDistance();
+// The /data handler streams whichever buffer dataSnapshotIndex points at, so
+// the next snapshot is written into the other one and then flipped in. The
+// rebuild rate limit keeps a buffer stable while a response is in flight.
+void refreshDataSnapshot() {
+    StageTimer timer(STAGE_DASHBOARD);
+    if (millis() - lastRssiPollTime >= RSSI_POLL_INTERVAL_MS) {
+        wifiRssi = WiFi.RSSI();
+        lastRssiPollTime = millis();
+    }
+
+    DeviceSnapshot device = deviceState.read();
+    DashboardState state = {};
+    state.distanceTenths = (int32_t)(device.distance * 10);
+    state.rssi = wifiRssi;
+    state.published = publishPolicy.totalPublished();
+    state.failed = publishPolicy.counters().failed;
+    state.suppressed = publishPolicy.suppressed();
+    state.ledOn = device.ledOn;
+    state.manual = device.manual;
+    state.awsConnected = cloudReady();
+    state.sensorCount = device.sensorCount;
+    for (uint8_t i = 0; i < device.sensorCount; i++) {
+        state.sensorTenths[i] = (int32_t)(device.sensors[i] * 10);
+    }
+
+    NetworkInfo network = currentNetworkInfo();
+    bool networkChanged = network.version != dashboardNetworkVersion;
+    if (!networkChanged && !dashboardStateChanged(state, dashboardState)) return;
+    if (millis() - lastSnapshotTime < DATA_SNAPSHOT_MIN_INTERVAL_MS) return;
+
+    uint8_t next = dataSnapshotIndex ^ 1;
+    size_t length = writeDashboardData(dataSnapshot[next], DATA_SNAPSHOT_SIZE, device, state, network.ip, network.ssid);
+    if (length == 0) return;
+
+    dataSnapshotLength[next] = length;
+    dataSnapshotIndex = next;
+    pushDashboardDelta(state, device, network, networkChanged);
+    dashboardNetworkVersion = network.version;
+    dashboardState = state;
+    lastSnapshotTime = millis();
+}
+
+void applyLEDState() {
+    digitalWrite(LED_PIN, ledController.isOn() ? HIGH : LOW);
+}
+
+void printSensorData() {
+    DeviceSnapshot device = deviceState.read();
     Serial.print("Distance: ");
-    Serial.print(distance);
+    Serial.print(device.distance);
     Serial.println(" cm");
-
-    if (!manualLEDControl) {
-        if (distance <= DISTANCE_THRESHOLD && distance > 0) {
-            digitalWrite(LED_PIN, HIGH);
-            Serial.println("LED: ON (Object detected within 50 cm)");
-        } else {
-            digitalWrite(LED_PIN, LOW);
-            Serial.println("LED: OFF");
+    if (SENSOR_COUNT > 1) {
+        Serial.print("Sensors:");
+        for (uint8_t i = 0; i < device.sensorCount; i++) {
+            Serial.print(" ");
+            Serial.print(device.sensors[i]);
         }
-    } else {
-        Serial.println("LED: " + String(digitalRead(LED_PIN) ? "ON" : "OFF") + " (Manual Mode)");
+        Serial.print(" cm, one round every ");
+        Serial.print(triggerScheduler.cycleUs() / 1000);
+        Serial.println(" ms");
+    }
+
+    Serial.print("LED: ");
+    Serial.print(device.ledOn ? "ON" : "OFF");
+    Serial.println(device.manual ? " (Manual Mode)" : "");
+    if (sampleRing.droppedCount() > 0) {
+        Serial.print("⚠️ Samples dropped: ");
+        Serial.println(sampleRing.droppedCount());
     }
     Serial.println("---");
 }
 
-void publishMessage() {
+bool publishMessage(const TelemetrySample& sample, const char* reason) {
+    StageTimer timer(STAGE_PUBLISH);
+    NetworkInfo network = currentNetworkInfo();
+    TelemetryFields fields = {AWS_IOT_CLIENT_ID, sample.distance, sample.sensors, SENSOR_COUNT,
+                              sample.ledOn, sample.manual, wifiRssi, (uint32_t)(millis() / 1000),
+                              network.ip, sample.uptimeMs, reason, PAYLOAD_SCHEMA_VERSION};
+    uint8_t payload[TELEMETRY_PAYLOAD_SIZE];
+    size_t length = writeTelemetryPayload(payload, sizeof(payload), topicFormats[TOPIC_DATA], fields);
+    bool published = length > 0 && client.publish(AWS_IOT_PUBLISH_TOPIC, payload, length);
+
+    if (!published) {
+        LOG_ERROR("❌ Publish failed");
+    }
+    return published;
+}
+
+// nowMs is on the same clock as the batch timestamps. The batch is left as
+// it was, so a failed publish can still go to the offline queue.
+template <size_t N, size_t S>
+bool publishTelemetryBatch(const TelemetryBatch<N, S>& batch, uint32_t nowMs) {
+    StageTimer timer(STAGE_BATCH_PUBLISH);
+    time_t now = time(nullptr);
+    uint32_t epoch = 0;
+    if (now > 8 * 3600 * 2) {
+        epoch = now - (nowMs - batch.baseTimestamp()) / 1000;
+    }
+
+    char payload[BATCH_PAYLOAD_SIZE];
+    size_t length = batch.encodeJson(payload, sizeof(payload), epoch);
+    if (length == 0) {
+        LOG_ERROR("❌ Telemetry batch too large for MQTT buffer");
+        return false;
+    }
+    return client.publish(AWS_IOT_BATCH_TOPIC, (const uint8_t*)payload, length);
+}
+
+void queueOfflineSample(const TelemetrySample& sample) {
+    if (!offlineQueueReady) return;
+
+    QueuedSample queued;
+    time_t now = time(nullptr);
+    queued.epoch = now > 8 * 3600 * 2 ? now - (millis() - sample.uptimeMs) / 1000 : 0;
+    queued.uptimeMs = sample.uptimeMs;
+    queued.distance = sample.distance;
+    queued.ledOn = sample.ledOn;
+    queued.manual = sample.manual;
+
+    if (!offlineQueue.push(queued)) {
+        LOG_WARN("⚠️ Offline queue full, sample dropped");
+    }
+}
+
+// A batch that could not be published is kept row by row, so it replays
+// like samples queued one at a time. The per-sensor columns are not kept.
+template <size_t N, size_t S>
+void queueOfflineBatch(const TelemetryBatch<N, S>& batch, bool manual) {
+    for (size_t i = 0; i < batch.size(); i++) {
+        TelemetrySample row = {batch.timestampAt(i), batch.distanceAt(i), batch.ledAt(i), manual,
+                               PublishPolicy::BATCH, 0, {}};
+        queueOfflineSample(row);
+    }
+}
+
+void replayOfflineQueue() {
+    StageTimer timer(STAGE_REPLAY);
+    QueuedSample batch[REPLAY_BATCH_SIZE];
+    size_t count = offlineQueue.peek(batch, REPLAY_BATCH_SIZE);
+    if (count == 0) {
+        offlineQueue.consume();
+        return;
+    }
+
     JsonDocument doc;
     doc["device_id"] = AWS_IOT_CLIENT_ID;
-    doc["distance"] = distance;
-    doc["led_status"] = digitalRead(LED_PIN) ? "ON" : "OFF";
-    doc["manual_mode"] = manualLEDControl;
-    doc["threshold"] = DISTANCE_THRESHOLD;
-    doc["wifi_rssi"] = WiFi.RSSI();
-    doc["uptime"] = millis() / 1000;
-    doc["ip_address"] = WiFi.localIP().toString();
-    doc["timestamp"] = millis();
-
-    char jsonBuffer[512];
-    serializeJson(doc, jsonBuffer);
-    bool published = client.publish(AWS_IOT_PUBLISH_TOPIC, jsonBuffer);
+    doc["fields"] = "epoch,uptime_ms,distance,led_on,manual_mode";
+    JsonArray samples = doc["samples"].to<JsonArray>();
+    for (size_t i = 0; i < count; i++) {
+        JsonArray row = samples.add<JsonArray>();
+        row.add(batch[i].epoch);
+        row.add(batch[i].uptimeMs);
+        row.add(batch[i].distance);
+        row.add(batch[i].ledOn ? 1 : 0);
+        row.add(batch[i].manual ? 1 : 0);
+    }
+    doc["remaining"] = offlineQueue.pending() - count;
 
-    if (!published) {
-        Serial.println("❌ Publish failed");
+    if (publishDocument(AWS_IOT_BACKLOG_TOPIC, TOPIC_BACKLOG, doc)) {
+        offlineQueue.consume();
+        LOG_INFO("📤 Replayed %u queued samples, %u remaining", (unsigned)count, (unsigned)offlineQueue.pending());
+    } else {
+        LOG_ERROR("❌ Backlog replay failed, will retry");
     }
 }
 
 void messageHandler(char* topic, byte* payload, unsigned int length) {
-    Serial.print("☁️ Incoming AWS IoT message on topic: ");
-    Serial.println(topic);
+    LOG_DEBUG("☁️ Incoming AWS IoT message on topic: %s", topic);
 
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, payload, length);
     if (error) {
-        Serial.print("❌ Failed to parse JSON: ");
-        Serial.println(error.c_str());
+        LOG_ERROR("❌ Failed to parse JSON: %s", error.c_str());
+        return;
+    }
+
+    if (strcmp(topic, SHADOW_DELTA_TOPIC) == 0 || strcmp(topic, SHADOW_GET_ACCEPTED_TOPIC) == 0) {
+        handleShadowMessage(topic, doc);
         return;
     }
 
     if (doc["command"].is<const char*>()) {
         const char* cmd = doc["command"];
-        Serial.print("📡 Cloud Command Received: ");
-        Serial.println(cmd);
-
-        if (strcmp(cmd, "LED_ON") == 0) {
-            manualLEDControl = true;
-            digitalWrite(LED_PIN, HIGH);
-            Serial.println("✓ LED turned ON via AWS IoT Cloud");
-            publishCloudAcknowledgment("LED_ON", "SUCCESS");
-        }
-        else if (strcmp(cmd, "LED_OFF") == 0) {
-            manualLEDControl = true;
-            digitalWrite(LED_PIN, LOW);
-            Serial.println("✓ LED turned OFF via AWS IoT Cloud");
-            publishCloudAcknowledgment("LED_OFF", "SUCCESS");
-        }
-        else if (strcmp(cmd, "LED_AUTO") == 0) {
-            manualLEDControl = false;
-            Serial.println("✓ LED set to AUTO mode via AWS IoT Cloud");
-            publishCloudAcknowledgment("LED_AUTO", "SUCCESS");
-        }
-        else if (strcmp(cmd, "GET_STATUS") == 0) {
-            Serial.println("✓ Status request from AWS IoT Cloud");
-            publishMessage();
-        }
-        else {
-            Serial.println("⚠️ Unknown command from cloud");
-            publishCloudAcknowledgment(cmd, "UNKNOWN_COMMAND");
+        LOG_INFO("📡 Cloud Command Received: %s", cmd);
+
+        Command command;
+        int entry = prepareCommand(command, cmd, COMMAND_FROM_CLOUD, doc["correlation_id"] | "");
+        if (entry < 0) {
+            LOG_WARN("⚠️ Unknown command from cloud");
+            queueAck(command, "UNKNOWN_COMMAND");
+        } else {
+            for (uint8_t i = 0; i < COMMAND_ARG_COUNT; i++) {
+                const char* key = COMMANDS[entry].argKeys[i];
+                if (key && doc[key].is<const char*>()) {
+                    copyText(command.args[i], doc[key], COMMAND_ARG_SIZE);
+                } else if (key && !doc[key].isNull()) {
+                    serializeJson(doc[key], command.args[i], COMMAND_ARG_SIZE);
+                }
+            }
+            if (!submitCommand(command)) {
+                LOG_WARN("⚠️ Command queue full");
+                queueAck(command, "BUSY");
+            }
         }
     }
 
     if (doc["message"].is<const char*>()) {
         const char* msg = doc["message"];
-        Serial.print("💬 Cloud Message: ");
-        Serial.println(msg);
+        LOG_INFO("💬 Cloud Message: %s", msg);
     }
 
+    // Older clients set the threshold with a bare field instead of SET_CONFIG.
     if (doc["threshold"].is<int>()) {
-        int newThreshold = doc["threshold"];
-        Serial.print("⚙️ Distance threshold updated from cloud: ");
-        Serial.print(newThreshold);
-        Serial.println(" cm");
+        Command command;
+        prepareCommand(command, "SET_CONFIG", COMMAND_FROM_CLOUD, doc["correlation_id"] | "");
+        copyText(command.args[0], "threshold_cm", COMMAND_ARG_SIZE);
+        snprintf(command.args[1], COMMAND_ARG_SIZE, "%d", doc["threshold"].as<int>());
+        if (!submitCommand(command)) {
+            LOG_WARN("⚠️ Command queue full");
+            queueAck(command, "BUSY");
+        }
     }
 }
 
-void publishCloudAcknowledgment(const char* command, const char* status) {
-    if (!client.connected()) return;
+void publishCloudAcknowledgment(const char* command, const char* status, const char* id) {
+    if (!cloudReady()) return;
+
+    uint8_t payload[ACK_PAYLOAD_SIZE];
+    size_t length = writeAckPayload(payload, sizeof(payload), topicFormats[TOPIC_ACK], AWS_IOT_CLIENT_ID, command,
+                                    status, id, (uint32_t)millis(), PAYLOAD_SCHEMA_VERSION);
+    if (length == 0 || !client.publish(AWS_IOT_ACK_TOPIC, payload, length)) {
+        LOG_ERROR("❌ Acknowledgment publish failed");
+        return;
+    }
+
+    LOG_INFO("📤 Acknowledgment sent to cloud");
+}
+
+// A single ack keeps the flat format; when several are waiting they go out
+// as one message with an "acks" array.
+void flushAcks() {
+    AckRequest acks[ACK_BATCH_SIZE];
+    size_t count = 0;
+    while (count < ACK_BATCH_SIZE && xQueueReceive(ackRequests, &acks[count], 0) == pdPASS) {
+        count++;
+    }
+    if (count == 0 || !cloudReady()) return;
+    StageTimer timer(STAGE_ACKS);
+
+    if (count == 1) {
+        publishCloudAcknowledgment(acks[0].command, acks[0].status, acks[0].id);
+        return;
+    }
+
+    JsonDocument doc;
+    doc["device_id"] = AWS_IOT_CLIENT_ID;
+    doc["timestamp"] = (uint32_t)millis();
+    JsonArray list = doc["acks"].to<JsonArray>();
+    for (size_t i = 0; i < count; i++) {
+        JsonObject ack = list.add<JsonObject>();
+        ack["command"] = acks[i].command;
+        ack["status"] = acks[i].status;
+        if (acks[i].id[0]) ack["correlation_id"] = acks[i].id;
+    }
+
+    if (publishDocument(AWS_IOT_ACK_TOPIC, TOPIC_ACK, doc)) {
+        LOG_INFO("📤 %u acknowledgments sent to cloud", (unsigned)count);
+    } else {
+        LOG_ERROR("❌ Acknowledgment publish failed");
+    }
+}
+
+bool publishDocument(const char* topic, WireTopic wireTopic, JsonDocument& doc) {
+    doc["schema"] = PAYLOAD_SCHEMA_VERSION;
+
+    uint8_t buffer[MQTT_BUFFER_SIZE];
+    size_t length;
+    if (topicFormats[wireTopic] == PayloadWriter::MSGPACK) {
+        length = serializeMsgPack(doc, buffer, sizeof(buffer));
+    } else {
+        length = serializeJson(doc, (char*)buffer, sizeof(buffer));
+    }
+
+    if (length == 0 || length >= sizeof(buffer)) {
+        LOG_ERROR("❌ Payload too large for MQTT buffer");
+        return false;
+    }
+    return client.publish(topic, buffer, length);
+}
+
+bool setTopicFormat(const char* topicName, const char* formatName) {
+    PayloadWriter::Format format;
+    if (strcmp(formatName, "json") == 0) {
+        format = PayloadWriter::JSON;
+    } else if (strcmp(formatName, "msgpack") == 0) {
+        format = PayloadWriter::MSGPACK;
+    } else {
+        return false;
+    }
+
+    bool allTopics = strcmp(topicName, "all") == 0;
+    bool matched = false;
+    for (uint8_t i = 0; i < TOPIC_COUNT; i++) {
+        if (allTopics || strcmp(topicName, WIRE_TOPIC_NAMES[i]) == 0) {
+            topicFormats[i] = format;
+            matched = true;
+        }
+    }
+    return matched;
+}
+
+void printStatus() {
+    printSensorData();
+
+    if (cloudReady()) {
+        const PublishPolicy::Counters& stats = publishPolicy.counters();
+        Serial.print("☁️ AWS IoT Status: CONNECTED | Published: ");
+        Serial.print(publishPolicy.totalPublished());
+        Serial.print(" (state ");
+        Serial.print(stats.published[PublishPolicy::STATE_CHANGE]);
+        Serial.print(", distance ");
+        Serial.print(stats.published[PublishPolicy::DISTANCE_CHANGE]);
+        Serial.print(", heartbeat ");
+        Serial.print(stats.published[PublishPolicy::HEARTBEAT]);
+        Serial.print(") | Suppressed: ");
+        Serial.println(publishPolicy.suppressed());
+        Serial.print("🪞 Shadow: version ");
+        Serial.print(shadow.version());
+        Serial.print(" | Updates: ");
+        Serial.print(shadowUpdates);
+        Serial.print(" | Deltas applied: ");
+        Serial.print(shadowDeltasApplied);
+        Serial.print(" | Stale: ");
+        Serial.println(shadowDeltasStale);
+    } else {
+        Serial.println("⚠️ AWS IoT Status: DISCONNECTED");
+        Serial.print("   Data queued for replay, pending: ");
+        Serial.println(offlineQueue.pending());
+        Serial.println("💾 Local functionality continues (Sensor + LED + Web UI)");
+    }
+}
+
+// Stack figures are the lowest free stack seen so far, in bytes; CPU is the
+// share of wall time each task spent working since the previous report.
+void printTaskReport() {
+    uint32_t now = micros();
+    Serial.println("🧵 Tasks (core/prio, min free stack, CPU):");
+    for (uint8_t i = 0; i < TASK_COUNT; i++) {
+        TaskInfo& task = tasks[i];
+        if (!task.handle) continue;
+
+        uint16_t load = task.load.sample(now);
+        char line[LOG_LINE_SIZE];
+        snprintf(line, sizeof(line), "   %-8s %d/%u  %5u B  %3u.%u%%", task.name, (int)task.core,
+                 (unsigned)task.priority, (unsigned)uxTaskGetStackHighWaterMark(task.handle), load / 10, load % 10);
+        Serial.println(line);
+    }
+    Serial.print("   Queue drops: telemetry ");
+    Serial.print(telemetryEventsDropped.load());
+    Serial.print(", log ");
+    Serial.println(logRing.dropped());
+}
+
+void closeTrace() {
+    TraceEvent end = TraceEvent::make(millis(), 'E');
+    end.a = traceRing.droppedCount() - traceDropsAtStart;
+    char line[TRACE_LINE_SIZE];
+    if (end.format(line, sizeof(line)) > 0) fprintf(traceFile, "%s\n", line);
+    fclose(traceFile);
+    traceFile = nullptr;
+    traceFileOpen = false;
+    LOG_INFO("🎞️ Trace saved to %s, %u bytes, %u events dropped", TRACE_FILE, (unsigned)traceBytes, (unsigned)end.a);
+}
+
+// Moves recorded trace events to the file. A trace that outgrows
+// TRACE_MAX_BYTES is ended there rather than crowding out the offline queue.
+void writeTrace() {
+    TraceEvent event;
+    char line[TRACE_LINE_SIZE];
+    while (traceRing.pop(event)) {
+        if (event.kind == 'H') {
+            if (traceFile) closeTrace();
+            traceFile = fopen(TRACE_PATH, "w");
+            if (!traceFile) {
+                LOG_ERROR("❌ Cannot create %s", TRACE_FILE);
+                traceActive = false;
+                continue;
+            }
+            traceFileOpen = true;
+            traceBytes = 0;
+        }
+        if (!traceFile) continue;
+
+        int length = event.format(line, sizeof(line));
+        if (length < 0) continue;
+        if (traceBytes + length + 1 > TRACE_MAX_BYTES) {
+            LOG_WARN("⚠️ Trace reached %u bytes, recording stopped", (unsigned)TRACE_MAX_BYTES);
+            traceActive = false;
+            closeTrace();
+            continue;
+        }
+        fprintf(traceFile, "%s\n", line);
+        traceBytes += length + 1;
+    }
+    if (traceFile && !traceActive) closeTrace();
+}
+
+// Serial is slow enough at 115200 baud to stall whoever writes to it, so the
+// other tasks only push records onto logRing and this task formats and
+// prints them along with the periodic reports. The ring cannot wake a
+// waiting task without taking a lock, so it is polled.
+void loggingTask(void* parameter) {
+    TaskLoad& load = tasks[TASK_LOGGING].load;
+    unsigned long lastTaskReportTime = millis();
+
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+        load.begin(micros());
+
+        {
+            StageTimer timer(STAGE_SERIAL);
+            drainLogs();
+        }
+        writeTrace();
+
+        if (millis() - lastPublishTime >= publishInterval) {
+            StageTimer timer(STAGE_SERIAL);
+            printStatus();
+            lastPublishTime = millis();
+        }
+
+        if (millis() - lastTaskReportTime >= TASK_REPORT_INTERVAL_MS) {
+            StageTimer timer(STAGE_SERIAL);
+            printTaskReport();
+            lastTaskReportTime = millis();
+        }
+
+        load.end(micros());
+    }
+}
+
+#ifdef LOW_POWER_MODE
+// Low-power mode, built by [env:esp32dev-lowpower]. There are no tasks, no
+// web server and no continuous ranging. Each wake takes one reading, appends
+// it to a batch kept in RTC memory and goes back to sleep on a timer. WiFi
+// and MQTT come up only when the batch is full or the LED threshold has been
+// crossed. The access point (channel and BSSID) and the TLS session (see
+// ResumableTlsClient) survive deep sleep, so a wake that has to publish skips
+// the scan and the full handshake.
+
+#ifndef LOW_POWER_SAMPLE_INTERVAL_MS
+#define LOW_POWER_SAMPLE_INTERVAL_MS 10000
+#endif
+#ifndef LOW_POWER_BATCH_SIZE
+#define LOW_POWER_BATCH_SIZE 30
+#endif
+#ifndef LOW_POWER_LIGHT_SLEEP
+#define LOW_POWER_LIGHT_SLEEP 0      // 1 keeps RAM powered; for intervals of a few seconds
+#endif
+#ifndef LOW_POWER_BATTERY_MAH
+#define LOW_POWER_BATTERY_MAH 2000
+#endif
+#ifndef LOW_POWER_RETRY_MAX_WAKES
+#define LOW_POWER_RETRY_MAX_WAKES 64    // ~10 minutes at the default interval
+#endif
+
+const uint32_t LOW_POWER_MAGIC = 0x4c505731;
+const uint32_t LOW_POWER_ECHO_WAIT_MS = 40;
+const uint32_t LOW_POWER_WIFI_TIMEOUT_MS = 8000;
+// Failed publishes back off like the MQTT reconnect, counted in wakes: after
+// n failures in a row the radio stays off for between half and all of
+// min(LOW_POWER_RETRY_MAX_WAKES, 2 * 2^n) wakes. Samples are still batched
+// meanwhile (the oldest drop out once the batch is full), and a crossed
+// threshold waits too, so an AP or broker outage does not keep the radio on.
+const uint32_t LOW_POWER_RETRY_BASE_WAKES = 2;
+
+// Typical ESP32 supply currents for EnergyModel, in µA. Sleep includes the
+// HC-SR04's ~2 mA idle draw, which dominates unless its supply is switched.
+const uint32_t LOW_POWER_SLEEP_UA = (LOW_POWER_LIGHT_SLEEP ? 800 : 10) + 2000;
+const uint32_t LOW_POWER_ACTIVE_UA = 40000;
+const uint32_t LOW_POWER_RADIO_UA = 130000;
+const float LOW_POWER_SUPPLY_V = 3.3f;
+
+// Plain data only: RTC variables are not re-initialised on a timer wake.
+struct LowPowerState {
+    uint32_t magic;
+    uint32_t clockOffsetMs;          // added to millis(), which restarts on every wake
+    uint32_t wakes;
+    uint32_t publishes;
+    uint32_t dropped;
+    uint32_t lastWakeToPublishMs;
+    uint32_t publishFailures;        // in a row
+    uint32_t retryAtWake;            // no publish attempt before this wake
+    uint8_t count;
+    uint32_t timestampMs[LOW_POWER_BATCH_SIZE];
+    float distance[LOW_POWER_BATCH_SIZE];
+    bool ledState[LOW_POWER_BATCH_SIZE];
+    bool ledOn;
+    bool haveAccessPoint;
+    int32_t channel;
+    uint8_t bssid[6];
+    char ssid[33];                   // the passphrase stays in NVS, out of RTC memory
+    EnergyModel energy;
+};
+RTC_DATA_ATTR LowPowerState lowPower;
+TelemetryBatch<LOW_POWER_BATCH_SIZE> lowPowerBatch;
+
+uint32_t lowPowerNow() {
+    return lowPower.clockOffsetMs + millis();
+}
+
+// Fires the sensors one after another, without the scheduler, and keeps the
+// nearest reading; only that one is batched in low-power mode.
+float takeSingleReading() {
+    float readings[SENSOR_COUNT];
+    RangeSample sample;
+    while (sampleRing.pop(sample)) {}
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (i > 0) delayMicroseconds(SENSOR_GUARD_US);
+        readings[i] = -1;
+        triggerSensors(1u << i);
+        unsigned long start = millis();
+        while (millis() - start < LOW_POWER_ECHO_WAIT_MS) {
+            if (sampleRing.pop(sample)) {
+                readings[i] = sample.distance;
+                break;
+            }
+            delay(1);
+        }
+    }
+    return nearestReading(readings, SENSOR_COUNT);
+}
+
+void recordLowPowerSample(float distanceCm) {
+    if (lowPower.count == LOW_POWER_BATCH_SIZE) {
+        memmove(lowPower.timestampMs, lowPower.timestampMs + 1, sizeof(lowPower.timestampMs[0]) * (LOW_POWER_BATCH_SIZE - 1));
+        memmove(lowPower.distance, lowPower.distance + 1, sizeof(lowPower.distance[0]) * (LOW_POWER_BATCH_SIZE - 1));
+        memmove(lowPower.ledState, lowPower.ledState + 1, sizeof(lowPower.ledState[0]) * (LOW_POWER_BATCH_SIZE - 1));
+        lowPower.count--;
+        lowPower.dropped++;
+    }
+    lowPower.timestampMs[lowPower.count] = lowPowerNow();
+    lowPower.distance[lowPower.count] = distanceCm;
+    lowPower.ledState[lowPower.count] = ledController.isOn();
+    lowPower.count++;
+    lowPower.energy.countSample();
+}
+
+// Reconnects to the remembered access point without a scan; falls back to a
+// normal connect, which scans, if that fails.
+bool connectWiFiFast() {
+    WiFi.mode(WIFI_STA);
+    if (lowPower.haveAccessPoint) {
+        // WiFi.psk() reads the passphrase WiFiManager saved in NVS.
+        WiFi.begin(lowPower.ssid, WiFi.psk().c_str(), lowPower.channel, lowPower.bssid, true);
+    } else {
+        WiFi.begin();
+    }
+
+    unsigned long start = millis();
+    while (WiFi.status() != WL_CONNECTED) {
+        if (millis() - start >= LOW_POWER_WIFI_TIMEOUT_MS) {
+            Serial.println("❌ WiFi connect timed out");
+            lowPower.haveAccessPoint = false;
+            return false;
+        }
+        delay(10);
+    }
+    cacheNetworkInfo();
+    return true;
+}
+
+void rememberAccessPoint() {
+    copyText(lowPower.ssid, WiFi.SSID().c_str(), sizeof(lowPower.ssid));
+    uint8_t* bssid = WiFi.BSSID();
+    if (bssid) {
+        memcpy(lowPower.bssid, bssid, sizeof(lowPower.bssid));
+        lowPower.channel = WiFi.channel();
+        lowPower.haveAccessPoint = true;
+    }
+}
+
+void publishLowPowerReport(bool resumedTls, uint32_t handshakeMs) {
+    const EnergyModel& energy = lowPower.energy;
+    float averageUa = energy.averageCurrentUa();
 
     JsonDocument doc;
     doc["device_id"] = AWS_IOT_CLIENT_ID;
-    doc["command"] = command;
-    doc["status"] = status;
-    doc["timestamp"] = millis();
+    doc["status"] = "LOW_POWER";
+    doc["wakes"] = lowPower.wakes;
+    doc["samples"] = energy.sampleCount();
+    doc["dropped"] = lowPower.dropped;
+    doc["sample_interval_ms"] = LOW_POWER_SAMPLE_INTERVAL_MS;
+    doc["energy_per_sample_mj"] = energy.millijoulesPerSample(LOW_POWER_SUPPLY_V);
+    doc["avg_current_ua"] = averageUa;
+    doc["radio_share"] = energy.share(EnergyModel::RADIO);
+    doc["battery_hours"] = averageUa > 0 ? LOW_POWER_BATTERY_MAH * 1000.0f / averageUa : 0;
+    doc["wake_to_publish_ms"] = lowPower.lastWakeToPublishMs;
+    doc["failed_publishes"] = energy.failedAttemptCount();
+    doc["failed_publish_mj"] = energy.failedMillijoules(LOW_POWER_SUPPLY_V);
+    doc["tls_resumed"] = resumedTls;
+    doc["tls_handshake_ms"] = handshakeMs;
+    publishDocument(AWS_IOT_PUBLISH_TOPIC, TOPIC_DATA, doc);
+}
 
-    char jsonBuffer[256];
-    serializeJson(doc, jsonBuffer);
+// Returns whether the batch went out. radioUs is set to the time the radio
+// was on, for the energy model. wakeUs is micros() at the start of this wake.
+bool publishLowPowerBatch(uint32_t wakeUs, uint32_t& radioUs) {
+    uint32_t radioStartUs = micros();
+    if (!connectWiFiFast()) {
+        WiFi.mode(WIFI_OFF);
+        radioUs = micros() - radioStartUs;
+        return false;
+    }
+    rememberAccessPoint();
 
-    String ackTopic = "devices/" + String(AWS_IOT_CLIENT_ID) + "/ack";
-    client.publish(ackTopic.c_str(), jsonBuffer);
+    if (client.connect(AWS_IOT_CLIENT_ID)) {
+        lowPowerBatch.clear();
+        for (uint8_t i = 0; i < lowPower.count; i++) {
+            lowPowerBatch.add(lowPower.timestampMs[i], lowPower.distance[i], lowPower.ledState[i]);
+        }
+        if (publishTelemetryBatch(lowPowerBatch, lowPowerNow())) {
+            lowPower.count = 0;
+            lowPower.publishes++;
+            lowPower.lastWakeToPublishMs = (micros() - wakeUs) / 1000;
+        }
+        const TlsConnectStats& tls = net.lastConnect();
+        publishLowPowerReport(tls.resumed, tls.handshakeMs);
+        client.loop();
+        client.disconnect();
+    } else {
+        printTlsStats();
+        printMQTTState(client.state());
+    }
 
-    Serial.println("📤 Acknowledgment sent to cloud");
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+    radioUs = micros() - radioStartUs;
+    return lowPower.count == 0;
+}
+
+void printEnergyModel() {
+    const EnergyModel& energy = lowPower.energy;
+    Serial.print("🔋 ");
+    Serial.print(energy.millijoulesPerSample(LOW_POWER_SUPPLY_V));
+    Serial.print(" mJ/sample, avg ");
+    Serial.print(energy.averageCurrentUa());
+    Serial.print(" µA, radio ");
+    Serial.print(energy.share(EnergyModel::RADIO) * 100);
+    Serial.print("% of charge, last wake-to-publish ");
+    Serial.print(lowPower.lastWakeToPublishMs);
+    Serial.print(" ms, ");
+    Serial.print(energy.failedAttemptCount());
+    Serial.print(" failed publishes cost ");
+    Serial.print(energy.failedMillijoules(LOW_POWER_SUPPLY_V));
+    Serial.println(" mJ");
+}
+
+void coldBootLowPower() {
+    memset(&lowPower, 0, sizeof(lowPower));
+    lowPower.magic = LOW_POWER_MAGIC;
+    lowPower.energy.reset();
+
+    // The first boot goes through the normal WiFi setup (and the portal, if
+    // needed) and NTP; the clock keeps running through deep sleep.
+    connectToWiFi();
+    rememberAccessPoint();
+    configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+    while (!timeSyncSettled()) {
+        delay(100);
+    }
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+}
+
+void runLowPowerMode() {
+    gpio_hold_dis((gpio_num_t)LED_PIN);
+    // After deep sleep the whole boot counts as active time.
+    uint32_t cycleStartUs = 0;
+    if (lowPower.magic != LOW_POWER_MAGIC || esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER) {
+        Serial.println("🔋 Low-power mode, cold boot");
+        coldBootLowPower();
+        cycleStartUs = micros();
+    }
+
+    net.setCredentials(AWS_IOT_CA, AWS_IOT_CERT, AWS_IOT_KEY);
+    client.setServer(AWS_IOT_HOST, AWS_IOT_PORT);
+    client.setBufferSize(MQTT_CLIENT_BUFFER_SIZE);
+    attachEchoInterrupts();
+
+    for (;;) {
+        uint32_t wakeUs = cycleStartUs;
+        lowPower.wakes++;
+        ledController.restore(lowPower.ledOn, false);
+
+        float reading = takeSingleReading();
+        bool crossed = ledController.update(reading, lowPowerNow());
+        applyLEDState();
+        lowPower.ledOn = ledController.isOn();
+        recordLowPowerSample(reading);
+
+        uint32_t radioUs = 0;
+        if ((lowPower.count >= LOW_POWER_BATCH_SIZE || crossed) && lowPower.wakes >= lowPower.retryAtWake) {
+            Serial.println(crossed ? "🔋 Threshold crossed, publishing" : "🔋 Batch full, publishing");
+            if (publishLowPowerBatch(wakeUs, radioUs)) {
+                lowPower.publishFailures = 0;
+            } else {
+                uint32_t wait = ReconnectBackoff::delayAfter(lowPower.publishFailures, LOW_POWER_RETRY_BASE_WAKES,
+                                                             LOW_POWER_RETRY_MAX_WAKES, esp_random());
+                lowPower.publishFailures++;
+                lowPower.retryAtWake = lowPower.wakes + wait;
+                lowPower.energy.addFailedAttempt(radioUs, LOW_POWER_RADIO_UA);
+                Serial.print("🔋 Publish failed ");
+                Serial.print(lowPower.publishFailures);
+                Serial.print(" times in a row, next try in ");
+                Serial.print(wait);
+                Serial.println(" wakes");
+            }
+            printEnergyModel();
+        }
+
+        uint32_t awakeUs = micros() - wakeUs;
+        lowPower.energy.add(EnergyModel::RADIO, radioUs, LOW_POWER_RADIO_UA);
+        lowPower.energy.add(EnergyModel::ACTIVE, awakeUs - radioUs, LOW_POWER_ACTIVE_UA);
+        lowPower.energy.add(EnergyModel::SLEEP, LOW_POWER_SAMPLE_INTERVAL_MS * 1000, LOW_POWER_SLEEP_UA);
+
+        drainLogs();
+        Serial.flush();
+        esp_sleep_enable_timer_wakeup((uint64_t)LOW_POWER_SAMPLE_INTERVAL_MS * 1000);
+        if (LOW_POWER_LIGHT_SLEEP) {
+            esp_light_sleep_start();
+            cycleStartUs = micros();
+            continue;
+        }
+
+        // millis() restarts after deep sleep; carry the clock over, and keep
+        // the LED pin driven while the chip is off.
+        lowPower.clockOffsetMs += millis() + LOW_POWER_SAMPLE_INTERVAL_MS;
+        gpio_hold_en((gpio_num_t)LED_PIN);
+        gpio_deep_sleep_hold_en();
+        esp_deep_sleep_start();
+    }
+}
+#endif
+
+void startTasks() {
+    xTaskCreatePinnedToCore(sensingTask, "sensing", SENSING_STACK_SIZE, nullptr, SENSING_PRIORITY,
+                            &tasks[TASK_SENSING].handle, SENSING_CORE);
+    xTaskCreatePinnedToCore(loggingTask, "logging", LOGGING_STACK_SIZE, nullptr, LOGGING_PRIORITY,
+                            &tasks[TASK_LOGGING].handle, LOGGING_CORE);
 }
 
 void setup() {
     Serial.begin(115200);
     Serial.println("Starting ESP32 AWS IoT connection...");
 
-    pinMode(TRIG_PIN, OUTPUT);
-    pinMode(ECHO_PIN, INPUT);
+    tasks[TASK_LOOP].handle = xTaskGetCurrentTaskHandle();
+    cpuMhz = ESP.getCpuFreqMHz();
+    telemetryEvents = xQueueCreate(TELEMETRY_QUEUE_DEPTH, sizeof(TelemetrySample));
+    commandQueue = xQueueCreate(COMMAND_QUEUE_DEPTH, sizeof(Command));
+    commandSubmitLock = xSemaphoreCreateMutex();
+    ackRequests = xQueueCreate(ACK_QUEUE_DEPTH, sizeof(AckRequest));
+
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        pinMode(SENSORS[i].trig, OUTPUT);
+        pinMode(SENSORS[i].echo, INPUT);
+    }
     pinMode(LED_PIN, OUTPUT);
     digitalWrite(LED_PIN, LOW);
+    preferences.begin("device", false);
+    loadConfig();
 
-    connectToWiFi();
-    setupWebServer();
-    connectToAWS();
+#ifdef LOW_POWER_MODE
+    runLowPowerMode();
+#endif
 
-    client.setCallback(messageHandler);
-}
+    startRanging();
 
-void loop() {
-    if (!client.connected()) {
-        awsConnected = false;
-        reconnectAWS();
+    if (LittleFS.begin(true)) {
+        offlineQueueReady = offlineQueue.begin();
+        Serial.print("✓ Offline queue ready, pending samples: ");
+        Serial.println(offlineQueue.pending());
     } else {
-        awsConnected = true;
+        Serial.println("❌ LittleFS mount failed, offline samples will be dropped");
     }
 
-    client.loop();
+    connectToWiFi();
+    refreshDataSnapshot();
+    setupWebServer();
 
-    if (millis() - lastPublishTime >= publishInterval) {
-        readSensorData();
+    client.setCallback(messageHandler);
+    connectToAWS();
+    startTasks();
+}
 
-        if (client.connected()) {
-            Serial.print("☁️ AWS IoT Status: CONNECTED | ");
-            publishMessage();
-            Serial.println("✅ Published successfully");
-        } else {
-            Serial.println("⚠️ AWS IoT Status: DISCONNECTED");
-            Serial.println("   Data not published to cloud.");
-            Serial.println("💾 Local functionality continues (Sensor + LED + Web UI)");
-        }
+// Sensing, MQTT and logging run in their own tasks (see the task layout
+// above); the Arduino loop task is left with the dashboard.
+void loop() {
+    TaskLoad& load = tasks[TASK_LOOP].load;
+    load.begin(micros());
+    refreshDataSnapshot();
+    load.end(micros());
 
-        lastPublishTime = millis();
-    }
+    vTaskDelay(pdMS_TO_TICKS(DASHBOARD_REFRESH_INTERVAL_MS));
 }
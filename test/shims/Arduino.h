@@ -0,0 +1,301 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+// Host stand-in for the parts of the Arduino core the tests touch. Time is a
+// simulated clock that only moves when a test (or delay()) moves it, so
+// tests are deterministic and run far faster than real time. Pins keep their
+// level, and EchoSource plays an HC-SR04: a 10 µs pulse on TRIG produces an
+// ECHO pulse as wide as the round trip to the target, delivered through the
+// attached pin interrupt or picked up by pulseIn(). Everything is header-only
+// so each test program builds from its own directory.
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define PROGMEM
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define RISING 1
+#define FALLING 2
+#define CHANGE 3
+#define digitalPinToInterrupt(pin) (pin)
+
+typedef uint8_t byte;
+
+class String {
+public:
+    String() {}
+    String(const char* text) : text(text ? text : "") {}
+    String(const std::string& text) : text(text) {}
+    String(int value) : text(std::to_string(value)) {}
+    String(unsigned value) : text(std::to_string(value)) {}
+    String(long value) : text(std::to_string(value)) {}
+    String(unsigned long value) : text(std::to_string(value)) {}
+
+    const char* c_str() const { return text.c_str(); }
+    size_t length() const { return text.size(); }
+    bool isEmpty() const { return text.empty(); }
+    int toInt() const { return atoi(text.c_str()); }
+    float toFloat() const { return (float)atof(text.c_str()); }
+
+    String& operator+=(const String& other) {
+        text += other.text;
+        return *this;
+    }
+    String operator+(const String& other) const { return String(text + other.text); }
+    bool operator==(const char* other) const { return text == other; }
+    bool operator!=(const char* other) const { return text != other; }
+
+private:
+    std::string text;
+};
+
+inline String operator+(const char* a, const String& b) { return String(a) + b; }
+
+namespace shim {
+
+const uint8_t PIN_COUNT = 40;
+const uint8_t MAX_ECHO_SOURCES = 8;
+
+struct Pin {
+    uint8_t mode;
+    uint8_t level;
+    int interruptMode;
+    void (*isr)();
+    void (*isrArg)(void*);
+    void* arg;
+};
+
+// A simulated HC-SR04. distanceCm < 0 means nothing in range, which the
+// real sensor reports as a ~38 ms ECHO pulse.
+struct EchoSource {
+    static const uint32_t BURST_US = 450;
+    static const uint32_t NO_TARGET_US = 38000;
+
+    uint8_t trigPin;
+    uint8_t echoPin;
+    float distanceCm;
+    uint64_t trigHighUs;
+    uint64_t riseUs;    // 0 when nothing is pending
+    uint64_t fallUs;
+    uint32_t pings;
+
+    uint32_t echoWidthUs() const {
+        return distanceCm < 0 ? NO_TARGET_US : (uint32_t)(distanceCm * 2 / 0.0343f + 0.5f);
+    }
+};
+
+struct Board {
+    uint64_t nowUs;
+    Pin pins[PIN_COUNT];
+    EchoSource echoes[MAX_ECHO_SOURCES];
+    uint8_t echoCount;
+};
+
+inline Board& board() {
+    static Board state;
+    return state;
+}
+
+inline void reset() { memset(&board(), 0, sizeof(Board)); }
+
+inline EchoSource& addEchoSource(uint8_t trigPin, uint8_t echoPin, float distanceCm) {
+    Board& b = board();
+    EchoSource& source = b.echoes[b.echoCount++];
+    memset(&source, 0, sizeof(source));
+    source.trigPin = trigPin;
+    source.echoPin = echoPin;
+    source.distanceCm = distanceCm;
+    return source;
+}
+
+inline void setLevel(uint8_t pin, uint8_t level) {
+    Pin& p = board().pins[pin];
+    if (p.level == level) return;
+    p.level = level;
+    bool fire = p.interruptMode == CHANGE || (p.interruptMode == RISING && level) ||
+                (p.interruptMode == FALLING && !level);
+    if (!fire) return;
+    if (p.isr) p.isr();
+    if (p.isrArg) p.isrArg(p.arg);
+}
+
+// Earliest pending echo edge, on any pin or only on `pin`.
+inline bool nextEdge(uint64_t& atUs, EchoSource*& source, int pin = -1) {
+    Board& b = board();
+    bool found = false;
+    for (uint8_t i = 0; i < b.echoCount; i++) {
+        EchoSource& s = b.echoes[i];
+        if (s.riseUs == 0 || (pin >= 0 && s.echoPin != pin)) continue;
+        uint64_t edge = b.pins[s.echoPin].level ? s.fallUs : s.riseUs;
+        if (!found || edge < atUs) {
+            atUs = edge;
+            source = &s;
+            found = true;
+        }
+    }
+    return found;
+}
+
+// Moves the clock to targetUs, playing every echo edge due on the way.
+inline void advanceTo(uint64_t targetUs) {
+    Board& b = board();
+    uint64_t edgeUs = 0;
+    EchoSource* source = nullptr;
+    while (nextEdge(edgeUs, source) && edgeUs <= targetUs) {
+        if (edgeUs > b.nowUs) b.nowUs = edgeUs;
+        bool rising = !b.pins[source->echoPin].level;
+        if (!rising) source->riseUs = 0;
+        setLevel(source->echoPin, rising ? HIGH : LOW);
+    }
+    if (targetUs > b.nowUs) b.nowUs = targetUs;
+}
+
+inline void advanceUs(uint64_t us) { advanceTo(board().nowUs + us); }
+
+inline void onTrigWrite(uint8_t pin, uint8_t level) {
+    Board& b = board();
+    for (uint8_t i = 0; i < b.echoCount; i++) {
+        EchoSource& s = b.echoes[i];
+        if (s.trigPin != pin) continue;
+        if (level) {
+            s.trigHighUs = b.nowUs;
+        } else if (b.nowUs - s.trigHighUs >= 10 && s.riseUs == 0 && !b.pins[s.echoPin].level) {
+            s.riseUs = b.nowUs + EchoSource::BURST_US;
+            s.fallUs = s.riseUs + s.echoWidthUs();
+            s.pings++;
+        }
+    }
+}
+
+}  // namespace shim
+
+inline unsigned long millis() { return (unsigned long)(uint32_t)(shim::board().nowUs / 1000); }
+inline unsigned long micros() { return (unsigned long)(uint32_t)shim::board().nowUs; }
+inline void delay(unsigned long ms) { shim::advanceUs((uint64_t)ms * 1000); }
+inline void delayMicroseconds(unsigned int us) { shim::advanceUs(us); }
+inline void yield() {}
+
+inline void pinMode(uint8_t pin, uint8_t mode) { shim::board().pins[pin].mode = mode; }
+inline int digitalRead(uint8_t pin) { return shim::board().pins[pin].level; }
+
+inline void digitalWrite(uint8_t pin, uint8_t level) {
+    level = level ? HIGH : LOW;
+    if (shim::board().pins[pin].level == level) return;
+    shim::setLevel(pin, level);
+    shim::onTrigWrite(pin, level);
+}
+
+inline void attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+    shim::Pin& p = shim::board().pins[pin];
+    p.isr = isr;
+    p.isrArg = nullptr;
+    p.interruptMode = mode;
+}
+
+inline void attachInterruptArg(uint8_t pin, void (*isr)(void*), void* arg, int mode) {
+    shim::Pin& p = shim::board().pins[pin];
+    p.isr = nullptr;
+    p.isrArg = isr;
+    p.arg = arg;
+    p.interruptMode = mode;
+}
+
+inline void detachInterrupt(uint8_t pin) {
+    shim::Pin& p = shim::board().pins[pin];
+    p.isr = nullptr;
+    p.isrArg = nullptr;
+    p.interruptMode = 0;
+}
+
+// Same contract as the Arduino one: waits for the pin to reach `state`,
+// then returns how long it stayed there, or 0 if that did not finish within
+// timeoutUs. Waiting moves the simulated clock.
+inline unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeoutUs = 1000000) {
+    uint64_t deadline = shim::board().nowUs + timeoutUs;
+    uint64_t edgeUs = 0;
+    shim::EchoSource* source = nullptr;
+    while (digitalRead(pin) == state) {
+        if (!shim::nextEdge(edgeUs, source, pin) || edgeUs > deadline) break;
+        shim::advanceTo(edgeUs);
+    }
+    while (digitalRead(pin) != state) {
+        if (!shim::nextEdge(edgeUs, source, pin) || edgeUs > deadline) {
+            shim::advanceTo(deadline);
+            return 0;
+        }
+        shim::advanceTo(edgeUs);
+    }
+    uint64_t startUs = shim::board().nowUs;
+    if (!shim::nextEdge(edgeUs, source, pin) || edgeUs > deadline) {
+        shim::advanceTo(deadline);
+        return 0;
+    }
+    shim::advanceTo(edgeUs);
+    return (unsigned long)(shim::board().nowUs - startUs);
+}
+
+class HardwareSerial {
+public:
+    void begin(unsigned long) {}
+    void flush() {}
+    size_t print(const char* text) { return append(text); }
+    size_t print(const String& text) { return append(text.c_str()); }
+    size_t print(char c) { return append(std::string(1, c).c_str()); }
+    size_t print(int value) { return format("%d", value); }
+    size_t print(unsigned value) { return format("%u", value); }
+    size_t print(long value) { return format("%ld", value); }
+    size_t print(unsigned long value) { return format("%lu", value); }
+    size_t print(double value) { return format("%.2f", value); }
+    template <typename T>
+    size_t println(const T& value) {
+        return print(value) + append("\r\n");
+    }
+    size_t println() { return append("\r\n"); }
+
+    template <typename... Args>
+    size_t printf(const char* fmt, Args... args) {
+        char line[256];
+        snprintf(line, sizeof(line), fmt, args...);
+        return append(line);
+    }
+
+    // Everything printed so far; tests may clear it.
+    std::string output;
+
+private:
+    size_t append(const char* text) {
+        output += text;
+        return strlen(text);
+    }
+
+    template <typename T>
+    size_t format(const char* fmt, T value) {
+        char text[32];
+        snprintf(text, sizeof(text), fmt, value);
+        return append(text);
+    }
+};
+
+static HardwareSerial Serial;
+
+class EspClass {
+public:
+    uint32_t getFreeHeap() const { return freeHeap; }
+    uint32_t getMinFreeHeap() const { return minFreeHeap; }
+    uint32_t getMaxAllocHeap() const { return maxAllocHeap; }
+    uint32_t getCpuFreqMHz() const { return 240; }
+    uint32_t getCycleCount() const { return (uint32_t)(shim::board().nowUs * 240); }
+
+    uint32_t freeHeap = 200000;
+    uint32_t minFreeHeap = 180000;
+    uint32_t maxAllocHeap = 110000;
+};
+
+static EspClass ESP;
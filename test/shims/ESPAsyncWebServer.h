@@ -0,0 +1,113 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+
+// Host stand-in for ESPAsyncWebServer. Handlers are registered as on the
+// device; a test builds an AsyncWebServerRequest, hands it to handle() and
+// looks at the response it captured. AsyncEventSource records what would
+// have been pushed to each connected viewer.
+
+enum WebRequestMethod { HTTP_GET = 0b00000001, HTTP_POST = 0b00000010, HTTP_ANY = 0b01111111 };
+
+class AsyncWebParameter {
+public:
+    AsyncWebParameter(const String& name, const String& value) : paramName(name), paramValue(value) {}
+    const String& name() const { return paramName; }
+    const String& value() const { return paramValue; }
+
+private:
+    String paramName;
+    String paramValue;
+};
+
+class AsyncWebServerRequest {
+public:
+    void addParam(const char* name, const char* value) { params.push_back(AsyncWebParameter(name, value)); }
+
+    bool hasParam(const char* name) const { return find(name) != nullptr; }
+    AsyncWebParameter* getParam(const char* name) { return const_cast<AsyncWebParameter*>(find(name)); }
+
+    void send(int code, const char* contentType = "", const String& content = String()) {
+        respond(code, contentType, content.c_str(), content.length());
+    }
+    void send(int code, const String& contentType, const String& content = String()) {
+        respond(code, contentType.c_str(), content.c_str(), content.length());
+    }
+    void send_P(int code, const char* contentType, const uint8_t* content, size_t length) {
+        respond(code, contentType, (const char*)content, length);
+    }
+
+    int responseCode = 0;
+    std::string contentType;
+    std::string body;
+    uint32_t responses = 0;
+
+private:
+    const AsyncWebParameter* find(const char* name) const {
+        for (const AsyncWebParameter& param : params) {
+            if (param.name() == name) return &param;
+        }
+        return nullptr;
+    }
+
+    void respond(int code, const char* type, const char* content, size_t length) {
+        responseCode = code;
+        contentType = type;
+        body.assign(content, length);
+        responses++;
+    }
+
+    std::vector<AsyncWebParameter> params;
+};
+
+typedef std::function<void(AsyncWebServerRequest*)> ArRequestHandlerFunction;
+
+class AsyncWebServer {
+public:
+    explicit AsyncWebServer(uint16_t) {}
+
+    void on(const char* uri, int, ArRequestHandlerFunction handler) { routes[uri] = handler; }
+    void begin() {}
+
+    // Test side: runs the handler for uri, or answers 404 like the server.
+    bool handle(const char* uri, AsyncWebServerRequest& request) {
+        std::map<std::string, ArRequestHandlerFunction>::iterator route = routes.find(uri);
+        if (route == routes.end()) {
+            request.send(404);
+            return false;
+        }
+        route->second(&request);
+        return true;
+    }
+
+private:
+    std::map<std::string, ArRequestHandlerFunction> routes;
+};
+
+class AsyncEventSource {
+public:
+    struct Event {
+        std::string data;
+        std::string name;
+        uint32_t id;
+    };
+
+    explicit AsyncEventSource(const char*) {}
+
+    size_t count() const { return viewers; }
+    void send(const char* message, const char* event = nullptr, uint32_t id = 0) {
+        Event sent;
+        sent.data = message ? message : "";
+        sent.name = event ? event : "";
+        sent.id = id;
+        events.push_back(sent);
+    }
+
+    // Test side.
+    size_t viewers = 0;
+    std::vector<Event> events;
+};
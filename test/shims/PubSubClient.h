@@ -0,0 +1,99 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+
+// Host stand-in for PubSubClient 2.8. Publishes are refused the way the real
+// client refuses them: when not connected, or when the packet does not fit
+// the client buffer. Like the real client, a publish is copied into the
+// buffer allocated by setBufferSize() and allocates nothing itself; tests
+// that want the messages set record and find them in published.
+
+#define MQTT_MAX_HEADER_SIZE 5
+#define MQTT_CONNECTED 0
+#define MQTT_DISCONNECTED -1
+
+class Client {};
+
+class PubSubClient {
+public:
+    typedef std::function<void(char*, uint8_t*, unsigned int)> Callback;
+
+    struct Message {
+        std::string topic;
+        std::vector<uint8_t> payload;
+    };
+
+    PubSubClient() {}
+    explicit PubSubClient(Client&) {}
+
+    PubSubClient& setServer(const char*, uint16_t) { return *this; }
+    PubSubClient& setCallback(Callback handler) {
+        callback = handler;
+        return *this;
+    }
+    bool setBufferSize(uint16_t size) {
+        bufferSize = size;
+        packet.resize(size);
+        return true;
+    }
+    uint16_t getBufferSize() const { return bufferSize; }
+
+    bool connect(const char*) {
+        isConnected = acceptConnect;
+        return isConnected;
+    }
+    void disconnect() { isConnected = false; }
+    bool connected() const { return isConnected; }
+    int state() const { return isConnected ? MQTT_CONNECTED : MQTT_DISCONNECTED; }
+    bool loop() { return isConnected; }
+    bool subscribe(const char* topic) {
+        subscriptions.push_back(topic);
+        return isConnected;
+    }
+
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length) {
+        if (!isConnected || MQTT_MAX_HEADER_SIZE + 2 + strlen(topic) + length > bufferSize) {
+            rejected++;
+            return false;
+        }
+        size_t topicLength = strlen(topic);
+        memcpy(&packet[MQTT_MAX_HEADER_SIZE + 2], topic, topicLength);
+        memcpy(&packet[MQTT_MAX_HEADER_SIZE + 2 + topicLength], payload, length);
+        publishCount++;
+        publishedBytes += length;
+        if (!record) return true;
+
+        Message message;
+        message.topic = topic;
+        message.payload.assign(payload, payload + length);
+        published.push_back(message);
+        return true;
+    }
+    bool publish(const char* topic, const char* payload) {
+        return publish(topic, (const uint8_t*)payload, strlen(payload));
+    }
+
+    // Test side: hands an incoming message to the callback.
+    void deliver(const char* topic, const uint8_t* payload, unsigned int length) {
+        std::string name = topic;
+        std::vector<uint8_t> copy(payload, payload + length);
+        if (callback) callback(&name[0], copy.data(), length);
+    }
+
+    bool acceptConnect = true;
+    bool record = true;
+    std::vector<Message> published;
+    uint32_t publishCount = 0;
+    uint64_t publishedBytes = 0;
+    std::vector<std::string> subscriptions;
+    uint32_t rejected = 0;
+
+private:
+    Callback callback;
+    uint16_t bufferSize = 256;
+    std::vector<uint8_t> packet = std::vector<uint8_t>(256);
+    bool isConnected = false;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdio.h>
+#include "Arduino.h"
+
+// Host stand-in for the ESP32 WiFi object. Tests set the link state and
+// what the driver would report; nothing touches a network.
+
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_CONNECT_FAILED = 4, WL_DISCONNECTED = 6 } wl_status_t;
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1 } wifi_mode_t;
+
+class IPAddress {
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : octets{a, b, c, d} {}
+
+    uint8_t operator[](int i) const { return octets[i]; }
+
+    String toString() const {
+        char text[16];
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+        return String(text);
+    }
+
+private:
+    uint8_t octets[4];
+};
+
+class WiFiClass {
+public:
+    wl_status_t begin(const char* ssid = nullptr, const char* = nullptr) {
+        if (ssid) currentSsid = ssid;
+        return currentStatus;
+    }
+    bool disconnect(bool = false) {
+        currentStatus = WL_DISCONNECTED;
+        return true;
+    }
+    bool mode(wifi_mode_t) { return true; }
+
+    wl_status_t status() const { return currentStatus; }
+    IPAddress localIP() const { return currentIp; }
+    String SSID() const { return String(currentSsid.c_str()); }
+    int32_t RSSI() const { return currentRssi; }
+
+    // Test side.
+    void simulateConnected(const char* ssid, IPAddress ip, int32_t rssi) {
+        currentStatus = WL_CONNECTED;
+        currentSsid = ssid;
+        currentIp = ip;
+        currentRssi = rssi;
+    }
+
+    wl_status_t currentStatus = WL_DISCONNECTED;
+    IPAddress currentIp;
+    std::string currentSsid;
+    int32_t currentRssi = 0;
+};
+
+static WiFiClass WiFi;
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+// Microbenchmark harness for the native test suite. bench::run() calls the
+// body in growing batches until BENCH_MIN_MS (default 200) have passed, then
+// prints and returns ns/op and heap allocations/op. Allocations are counted
+// by replacing the global allocator below, so they are exact and a test can
+// assert that a hot path allocates nothing; times are only printed, since
+// they depend on the host.
+//
+// Include this from exactly one file per test program, because it defines
+// the allocation functions. On glibc, malloc itself is wrapped (which also
+// covers operator new) and live bytes are tracked for a heap high-water
+// mark; elsewhere only operator new is counted.
+
+namespace bench {
+
+struct HeapCounters {
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> bytes;
+    std::atomic<int64_t> liveBytes;
+    std::atomic<int64_t> peakLiveBytes;
+};
+
+inline HeapCounters& heap() {
+    static HeapCounters counters;
+    return counters;
+}
+
+inline void noteAllocation(size_t size) {
+    HeapCounters& h = heap();
+    h.allocations.fetch_add(1, std::memory_order_relaxed);
+    h.bytes.fetch_add(size, std::memory_order_relaxed);
+    int64_t live = h.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t peak = h.peakLiveBytes.load(std::memory_order_relaxed);
+    while (live > peak && !h.peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+}
+
+inline void noteRelease(size_t size) { heap().liveBytes.fetch_sub(size, std::memory_order_relaxed); }
+
+// Allocation counts between two points in a test.
+class HeapScope {
+public:
+    HeapScope()
+        : startAllocations(heap().allocations.load()), startBytes(heap().bytes.load()),
+          startLive(heap().liveBytes.load()) {
+        heap().peakLiveBytes.store(startLive);
+    }
+
+    uint64_t allocations() const { return heap().allocations.load() - startAllocations; }
+    uint64_t bytes() const { return heap().bytes.load() - startBytes; }
+    // Most heap held at once since the scope began, above what was live then.
+    int64_t peakBytes() const { return heap().peakLiveBytes.load() - startLive; }
+
+private:
+    uint64_t startAllocations;
+    uint64_t startBytes;
+    int64_t startLive;
+};
+
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result {
+    uint64_t ops;
+    double nsPerOp;
+    double allocationsPerOp;
+    double bytesPerOp;
+};
+
+inline uint32_t minimumMs() {
+    const char* setting = getenv("BENCH_MIN_MS");
+    return setting ? (uint32_t)atoi(setting) : 200;
+}
+
+template <typename Body>
+Result run(const char* name, Body body) {
+    typedef std::chrono::steady_clock Clock;
+    body();    // warm up caches and any lazy state outside the measurement
+
+    uint64_t ops = 0;
+    uint64_t batch = 1;
+    double elapsedNs = 0;
+    double limitNs = minimumMs() * 1e6;
+    HeapScope scope;
+    Clock::time_point start = Clock::now();
+    while (elapsedNs < limitNs) {
+        for (uint64_t i = 0; i < batch; i++) body();
+        ops += batch;
+        if (batch < (1u << 20)) batch *= 2;
+        elapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    Result result = {ops, elapsedNs / ops, (double)scope.allocations() / ops, (double)scope.bytes() / ops};
+    printf("[bench] %-36s %12.1f ns/op %8.2f allocs/op %8.1f B/op  (%llu ops)\n", name, result.nsPerOp,
+           result.allocationsPerOp, result.bytesPerOp, (unsigned long long)ops);
+    return result;
+}
+
+}  // namespace bench
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void __libc_free(void* pointer);
+
+void* malloc(size_t size) {
+    void* pointer = __libc_malloc(size);
+    if (pointer) bench::noteAllocation(malloc_usable_size(pointer));
+    return pointer;
+}
+
+void* calloc(size_t count, size_t size) {
+    void* pointer = __libc_calloc(count, size);
+    if (pointer) bench::noteAllocation(malloc_usable_size(pointer));
+    return pointer;
+}
+
+void* realloc(void* pointer, size_t size) {
+    size_t before = pointer ? malloc_usable_size(pointer) : 0;
+    void* moved = __libc_realloc(pointer, size);
+    if (moved) {
+        bench::noteRelease(before);
+        bench::noteAllocation(malloc_usable_size(moved));
+    }
+    return moved;
+}
+
+void free(void* pointer) {
+    if (pointer) bench::noteRelease(malloc_usable_size(pointer));
+    __libc_free(pointer);
+}
+}
+#else
+void* operator new(size_t size) {
+    bench::noteAllocation(size);
+    void* pointer = malloc(size ? size : 1);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* pointer) noexcept { free(pointer); }
+void operator delete[](void* pointer) noexcept { free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { free(pointer); }
+#endif
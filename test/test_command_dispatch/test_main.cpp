@@ -0,0 +1,200 @@
+// Command dispatch: name lookup in the sorted table, and the whole path a
+// command takes through CommandDispatch.h (front-end resolves the name and
+// copies the correlation ID, the queue carries it to the sensing task, the
+// table entry's handler runs, the ack is queued). The FreeRTOS queues are
+// stood in for by RingBuffer, which has the same copy-in/copy-out semantics.
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Bench.h"
+#include "CommandDispatch.h"
+#include "RingBuffer.h"
+
+// The firmware's handlers drive the LED and the network; these only count.
+uint32_t handled = 0;
+const char* succeed(const Command&) {
+    handled++;
+    return "SUCCESS";
+}
+
+const char* answerElsewhere(const Command&) {
+    handled++;
+    return nullptr;
+}
+
+// The names and argument keys main.cpp's table has.
+constexpr CommandEntry COMMANDS[] = {
+    {"BATCH_MODE_OFF", succeed, {nullptr, nullptr}},
+    {"BATCH_MODE_ON", succeed, {nullptr, nullptr}},
+    {"GET_STATUS", answerElsewhere, {nullptr, nullptr}},
+    {"LED_AUTO", succeed, {nullptr, nullptr}},
+    {"LED_OFF", succeed, {nullptr, nullptr}},
+    {"LED_ON", succeed, {nullptr, nullptr}},
+    {"SET_CONFIG", succeed, {"key", "value"}},
+    {"SET_FORMAT", succeed, {"topic", "format"}},
+    {"TRACE_START", succeed, {nullptr, nullptr}},
+    {"TRACE_STOP", succeed, {nullptr, nullptr}},
+};
+static_assert(isSortedTable(COMMANDS), "COMMANDS must stay sorted by name");
+
+struct Named {
+    const char* name;
+};
+constexpr Named UNSORTED[] = {{"LED_ON"}, {"LED_OFF"}};
+static_assert(!isSortedTable(UNSORTED), "isSortedTable must catch a swapped pair");
+constexpr Named DUPLICATED[] = {{"LED_ON"}, {"LED_ON"}};
+static_assert(!isSortedTable(DUPLICATED), "isSortedTable must catch a duplicate");
+
+int prepareCommand(Command& command, const char* name, const char* id,
+                   CommandSource source = COMMAND_FROM_CLOUD) {
+    return prepareCommand(command, COMMANDS, name, source, id);
+}
+
+// The FreeRTOS queues main.cpp hands to dispatchCommands().
+RingBuffer<Command, 16> commandQueue;
+RingBuffer<AckRequest, 16> ackRequests;
+uint32_t started = 0;
+
+size_t runCommands() {
+    return dispatchCommands(
+        COMMANDS, [](Command& command) { return commandQueue.pop(command); },
+        [](const Command&, const CommandEntry&) { started++; },
+        [](const Command& command, const CommandEntry&, const char* status) {
+            if (status) ackRequests.push(makeAck(command, status));
+        });
+}
+
+TEST(CommandTable, CompareOrdersLikeStrcmp) {
+    EXPECT_EQ(0, compareCommandNames("LED_ON", "LED_ON"));
+    EXPECT_LT(compareCommandNames("LED_OFF", "LED_ON"), 0);
+    EXPECT_GT(compareCommandNames("LED_ON", "LED"), 0);
+    EXPECT_LT(compareCommandNames("", "A"), 0);
+}
+
+TEST(CommandTable, FindsEveryEntry) {
+    for (size_t i = 0; i < sizeof(COMMANDS) / sizeof(COMMANDS[0]); i++) {
+        EXPECT_EQ((int)i, findCommand(COMMANDS, COMMANDS[i].name)) << COMMANDS[i].name;
+    }
+}
+
+TEST(CommandTable, RejectsNearMisses) {
+    EXPECT_EQ(-1, findCommand(COMMANDS, ""));
+    EXPECT_EQ(-1, findCommand(COMMANDS, "LED"));
+    EXPECT_EQ(-1, findCommand(COMMANDS, "LED_ONN"));
+    EXPECT_EQ(-1, findCommand(COMMANDS, "led_on"));
+    EXPECT_EQ(-1, findCommand(COMMANDS, "AAA"));
+    EXPECT_EQ(-1, findCommand(COMMANDS, "ZZZ"));
+}
+
+TEST(CommandDispatch, AckCarriesTheCorrelationId) {
+    Command command;
+    ASSERT_GE(prepareCommand(command, "LED_ON", "abc123"), 0);
+    ASSERT_TRUE(commandQueue.push(command));
+    runCommands();
+    AckRequest ack;
+    ASSERT_TRUE(ackRequests.pop(ack));
+    EXPECT_STREQ("LED_ON", ack.command);
+    EXPECT_STREQ("abc123", ack.id);
+    EXPECT_STREQ("SUCCESS", ack.status);
+}
+
+TEST(CommandDispatch, WebCommandsAreAckedWithAPrefix) {
+    Command command;
+    ASSERT_GE(prepareCommand(command, "LED_OFF", "", COMMAND_FROM_WEB), 0);
+    ASSERT_TRUE(commandQueue.push(command));
+    runCommands();
+    AckRequest ack;
+    ASSERT_TRUE(ackRequests.pop(ack));
+    EXPECT_STREQ("WEB_LED_OFF", ack.command);
+    EXPECT_STREQ("", ack.id);
+}
+
+TEST(CommandDispatch, HandlersThatAnswerElsewhereRaiseNoAck) {
+    Command command;
+    ASSERT_GE(prepareCommand(command, "GET_STATUS", "req-7"), 0);
+    ASSERT_TRUE(commandQueue.push(command));
+    uint32_t before = handled;
+    EXPECT_EQ(1u, runCommands());
+    EXPECT_EQ(before + 1, handled);
+    EXPECT_TRUE(ackRequests.empty());
+}
+
+TEST(CommandDispatch, UnknownEntriesAreSkipped) {
+    Command command;
+    EXPECT_EQ(-1, prepareCommand(command, "SELF_DESTRUCT", ""));
+    ASSERT_TRUE(commandQueue.push(command));
+    uint32_t before = started;
+    EXPECT_EQ(0u, runCommands());
+    EXPECT_EQ(before, started);
+    EXPECT_TRUE(commandQueue.empty());
+    EXPECT_TRUE(ackRequests.empty());
+}
+
+TEST(CommandDispatch, LongIdsAreCutNotOverrun) {
+    char id[100];
+    memset(id, 'x', sizeof(id) - 1);
+    id[sizeof(id) - 1] = 0;
+    Command command;
+    prepareCommand(command, "GET_STATUS", id);
+    EXPECT_EQ(COMMAND_ID_SIZE - 1, strlen(command.id));
+}
+
+TEST(CommandDispatch, FullQueueRefusesRatherThanBlocks) {
+    Command command;
+    prepareCommand(command, "LED_AUTO", "");
+    size_t accepted = 0;
+    while (commandQueue.push(command)) accepted++;
+    EXPECT_EQ(commandQueue.capacity(), accepted);
+    runCommands();
+    AckRequest ack;
+    size_t acks = 0;
+    while (ackRequests.pop(ack)) acks++;
+    EXPECT_EQ(accepted, acks);
+}
+
+// The lookups the table replaced: an strcmp chain in table order.
+int findByChain(const char* name) {
+    for (size_t i = 0; i < sizeof(COMMANDS) / sizeof(COMMANDS[0]); i++) {
+        if (strcmp(name, COMMANDS[i].name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+const char* const MIX[] = {"LED_ON", "LED_OFF", "GET_STATUS", "SET_CONFIG", "TRACE_STOP", "NOPE"};
+const size_t MIX_COUNT = sizeof(MIX) / sizeof(MIX[0]);
+
+TEST(CommandDispatchBench, Lookup) {
+    size_t i = 0;
+    bench::Result table = bench::run("findCommand (10 entries)", [&] {
+        bench::doNotOptimize(findCommand(COMMANDS, MIX[i++ % MIX_COUNT]));
+    });
+    i = 0;
+    bench::run("strcmp chain (10 entries)", [&] { bench::doNotOptimize(findByChain(MIX[i++ % MIX_COUNT])); });
+    EXPECT_EQ(0, table.allocationsPerOp);
+}
+
+// Front-end to ack: prepare, queue, dispatch, queue the ack, collect it.
+TEST(CommandDispatchBench, Throughput) {
+    size_t i = 0;
+    AckRequest ack;
+    bench::Result result = bench::run("command prepare+queue+dispatch+ack", [&] {
+        Command command;
+        prepareCommand(command, MIX[i++ % (MIX_COUNT - 1)], "req-0001");
+        commandQueue.push(command);
+        runCommands();
+        ackRequests.pop(ack);
+        bench::doNotOptimize(ack);
+    });
+    printf("[bench] %-36s %12.0f commands/s\n", "command dispatch", 1e9 / result.nsPerOp);
+    EXPECT_EQ(0, result.allocationsPerOp);
+    EXPECT_TRUE(commandQueue.empty());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    if (RUN_ALL_TESTS()) {
+    }
+    return 0;
+}
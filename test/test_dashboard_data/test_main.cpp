@@ -0,0 +1,235 @@
+// The /data snapshot and live deltas, and the cost of serving /data: the
+// snapshot builder on its own, then the handler from main.cpp on the web
+// server stand-in with 10 clients polling at once while the snapshot keeps
+// being rebuilt underneath them, and what /events viewers receive instead.
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Bench.h"
+#include "Arduino.h"
+#include "DashboardData.h"
+#include "ESPAsyncWebServer.h"
+
+DeviceSnapshot device(float distance, uint8_t sensorCount = 1) {
+    DeviceSnapshot snapshot = {distance, 1000, distance > 0 && distance < 50, false, sensorCount, {}};
+    for (uint8_t i = 0; i < sensorCount; i++) snapshot.sensors[i] = distance + i * 10;
+    return snapshot;
+}
+
+DashboardState stateOf(const DeviceSnapshot& device, uint32_t published = 10) {
+    DashboardState state = {};
+    state.distanceTenths = (int32_t)(device.distance * 10);
+    state.rssi = -61;
+    state.published = published;
+    state.failed = 1;
+    state.suppressed = 200;
+    state.ledOn = device.ledOn;
+    state.manual = device.manual;
+    state.awsConnected = true;
+    state.sensorCount = device.sensorCount;
+    for (uint8_t i = 0; i < device.sensorCount; i++) state.sensorTenths[i] = (int32_t)(device.sensors[i] * 10);
+    return state;
+}
+
+TEST(DashboardData, FullSnapshot) {
+    DeviceSnapshot snapshot = device(42.5f);
+    char buffer[384];
+    size_t length = writeDashboardData(buffer, sizeof(buffer), snapshot, stateOf(snapshot), "192.168.1.123", "lab");
+    EXPECT_EQ("{\"distance\":42.50,\"led_status\":\"ON\",\"manual_mode\":false,\"ip\":\"192.168.1.123\","
+              "\"ssid\":\"lab\",\"rssi\":-61,\"aws_connected\":true,\"mqtt_published\":10,\"mqtt_failed\":1,"
+              "\"mqtt_suppressed\":200}",
+              std::string(buffer, length));
+}
+
+TEST(DashboardData, ArraysListEverySensor) {
+    DeviceSnapshot snapshot = device(42.5f, 3);
+    char buffer[384];
+    size_t length = writeDashboardData(buffer, sizeof(buffer), snapshot, stateOf(snapshot), "10.0.0.2", "lab");
+    EXPECT_NE(std::string::npos, std::string(buffer, length).find("\"sensors\":[42.50,52.50,62.50]"));
+}
+
+TEST(DashboardData, WorstCaseFitsTheSnapshotBuffer) {
+    DeviceSnapshot snapshot = device(399.99f, DeviceSnapshot::MAX_SENSORS);
+    DashboardState state = stateOf(snapshot, UINT32_MAX);
+    state.failed = UINT32_MAX;
+    state.suppressed = UINT32_MAX;
+    state.rssi = -100;
+    char buffer[384];    // DATA_SNAPSHOT_SIZE in main.cpp
+    EXPECT_GT(writeDashboardData(buffer, sizeof(buffer), snapshot, state, "255.255.255.255",
+                                 "0123456789abcdef0123456789abcdef"),
+              0u);
+}
+
+TEST(DashboardData, StateChangesAtDisplayResolution) {
+    DeviceSnapshot snapshot = device(42.5f, 2);
+    DashboardState a = stateOf(snapshot);
+    DashboardState b = a;
+    EXPECT_FALSE(dashboardStateChanged(a, b));
+    b.published++;
+    EXPECT_TRUE(dashboardStateChanged(a, b));
+    b = a;
+    b.sensorTenths[1]++;
+    EXPECT_TRUE(dashboardStateChanged(a, b));
+    b = a;
+    b.sensorTenths[5] = 7;    // beyond sensorCount
+    EXPECT_FALSE(dashboardStateChanged(a, b));
+}
+
+TEST(DashboardData, DeltaCarriesOnlyWhatChanged) {
+    DeviceSnapshot before = device(80);
+    DeviceSnapshot after = device(30);
+    DashboardState previous = stateOf(before);
+    DashboardState state = stateOf(after, 11);
+    char buffer[384];
+    size_t length = writeDashboardDelta(buffer, sizeof(buffer), after, state, previous, "1.2.3.4", "lab", false);
+    EXPECT_EQ("{\"distance\":30.00,\"led_status\":\"ON\"}", std::string(buffer, length));
+
+    // Only a counter moved: /data changes, viewers get nothing.
+    state = stateOf(before, 12);
+    EXPECT_EQ(0u, writeDashboardDelta(buffer, sizeof(buffer), before, state, previous, "1.2.3.4", "lab", false));
+
+    length = writeDashboardDelta(buffer, sizeof(buffer), before, state, previous, "1.2.3.4", "lab", true);
+    EXPECT_EQ("{\"distance\":80.00,\"led_status\":\"OFF\",\"manual_mode\":false,\"aws_connected\":true,"
+              "\"rssi\":-61,\"ip\":\"1.2.3.4\",\"ssid\":\"lab\"}",
+              std::string(buffer, length));
+}
+
+// The snapshot cache and handler as main.cpp has them.
+const size_t DATA_SNAPSHOT_SIZE = 384;
+char dataSnapshot[2][DATA_SNAPSHOT_SIZE];
+size_t dataSnapshotLength[2] = {0, 0};
+volatile uint8_t dataSnapshotIndex = 0;
+
+void rebuildSnapshot(uint32_t step) {
+    DeviceSnapshot snapshot = device(20 + step % 300);
+    uint8_t next = dataSnapshotIndex ^ 1;
+    dataSnapshotLength[next] =
+        writeDashboardData(dataSnapshot[next], DATA_SNAPSHOT_SIZE, snapshot, stateOf(snapshot, step), "192.168.1.123",
+                           "lab");
+    dataSnapshotIndex = next;
+}
+
+void setupDataRoute(AsyncWebServer& server) {
+    server.on("/data", HTTP_GET, [](AsyncWebServerRequest* request) {
+        uint8_t index = dataSnapshotIndex;
+        request->send_P(200, "application/json", (const uint8_t*)dataSnapshot[index], dataSnapshotLength[index]);
+    });
+}
+
+TEST(DashboardDataBench, BuildSnapshot) {
+    uint32_t step = 0;
+    bench::Result result = bench::run("/data snapshot rebuild", [&] { rebuildSnapshot(step++); });
+    EXPECT_EQ(0, result.allocationsPerOp);
+}
+
+TEST(DashboardDataBench, ServeSnapshot) {
+    AsyncWebServer server(80);
+    setupDataRoute(server);
+    rebuildSnapshot(0);
+    AsyncWebServerRequest request;
+    bench::Result result = bench::run("/data handler", [&] { server.handle("/data", request); });
+    EXPECT_EQ(0, result.allocationsPerOp);
+    EXPECT_EQ(200, request.responseCode);
+}
+
+// 10 browser tabs polling at once for a second while the snapshot is rebuilt
+// as often as the firmware allows (DATA_SNAPSHOT_MIN_INTERVAL_MS). Every
+// response must be a whole document, and the heap must not grow with the
+// number of requests.
+TEST(DashboardDataBench, TenConcurrentClients) {
+    const int CLIENTS = 10;
+    AsyncWebServer server(80);
+    setupDataRoute(server);
+    rebuildSnapshot(0);
+
+    std::atomic<bool> running(true);
+    std::atomic<uint64_t> served(0);
+    std::atomic<uint32_t> torn(0);
+    std::vector<AsyncWebServerRequest> requests(CLIENTS);
+    for (AsyncWebServerRequest& request : requests) server.handle("/data", request);    // size the bodies once
+
+    bench::HeapScope scope;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::thread writer([&] {
+        for (uint32_t step = 1; running; step++) {
+            rebuildSnapshot(step);
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+    });
+    std::vector<std::thread> clients;
+    for (int c = 0; c < CLIENTS; c++) {
+        clients.push_back(std::thread([&, c] {
+            AsyncWebServerRequest& request = requests[c];
+            uint64_t count = 0;
+            while (running) {
+                server.handle("/data", request);
+                if (request.body.empty() || request.body[0] != '{' || request.body.back() != '}') torn++;
+                count++;
+            }
+            served += count;
+        }));
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    running = false;
+    for (std::thread& client : clients) client.join();
+    writer.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t allocations = scope.allocations();
+    int64_t peakBytes = scope.peakBytes();
+
+    printf("[bench] %-36s %12.0f req/s %8.5f allocs/req  peak heap +%lld B\n", "/data 10 clients", served / seconds,
+           (double)allocations / served, (long long)peakBytes);
+    EXPECT_EQ(0u, torn.load());
+    ASSERT_GT(served.load(), 10000u);
+    // Starting the threads is all that allocates; nothing per request.
+    EXPECT_LT(allocations, 100u);
+    EXPECT_LT(peakBytes, 64 * 1024);
+}
+
+// Ten minutes of a mostly idle hallway: someone walks up and away every 30 s,
+// and the reading wobbles below display resolution in between. Viewers get
+// updates at up to 5 Hz while someone moves and nothing otherwise, so they
+// receive fewer messages than a tab polling /data once a second, and far
+// fewer bytes.
+TEST(DashboardDataBench, PushedDeltasVersusPolling) {
+    AsyncEventSource events("/events");
+    DeviceSnapshot last = device(250);
+    DashboardState previous = stateOf(last);
+    char delta[DATA_SNAPSHOT_SIZE];
+    char full[DATA_SNAPSHOT_SIZE];
+    uint64_t pushedBytes = 0;
+    uint64_t polledBytes = 0;
+
+    for (uint32_t ms = 200; ms <= 600000; ms += 200) {
+        uint32_t phase = ms % 30000;
+        float distance = phase < 5000 ? 250 - phase / 25.0f : 250 + (ms / 200 % 3) * 0.04f;
+        DeviceSnapshot now = device(distance);
+        DashboardState state = stateOf(now);
+        if (dashboardStateChanged(state, previous)) {
+            size_t length = writeDashboardDelta(delta, sizeof(delta), now, state, previous, "192.168.1.123", "lab",
+                                                false);
+            if (length > 0) {
+                events.send(delta, "data", ms);
+                pushedBytes += length;
+            }
+            previous = state;
+        }
+        if (ms % 1000 == 0) polledBytes += writeDashboardData(full, sizeof(full), now, state, "192.168.1.123", "lab");
+    }
+
+    printf("[bench] %-36s %8u events %8llu B   vs polling %u requests %8llu B\n", "/events 10 min idle hallway",
+           (unsigned)events.events.size(), (unsigned long long)pushedBytes, 600u, (unsigned long long)polledBytes);
+    EXPECT_LT(events.events.size(), 600u);
+    EXPECT_LT(pushedBytes * 5, polledBytes);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    if (RUN_ALL_TESTS()) {
+    }
+    return 0;
+}
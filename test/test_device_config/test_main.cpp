@@ -0,0 +1,168 @@
+// DeviceConfig as SET_CONFIG, /config and the shadow use it: parsing the
+// decimal text, the range of each field and the checks between fields, and
+// restoring what an older firmware stored in NVS. The benchmark times one
+// set() the way a /config request applies it.
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Bench.h"
+#include "DeviceConfig.h"
+
+TEST(DeviceConfig, DefaultsAreValid) {
+    DeviceConfig config;
+    EXPECT_TRUE(config.valid());
+}
+
+TEST(DeviceConfig, ParsesDecimalText) {
+    DeviceConfig config;
+    EXPECT_EQ(DeviceConfig::CHANGED, config.set("threshold_cm", "40"));
+    EXPECT_EQ(40u, config.thresholdCm);
+    EXPECT_EQ(DeviceConfig::UNCHANGED, config.set("threshold_cm", "40"));
+    EXPECT_EQ(DeviceConfig::CHANGED, config.set("heartbeat_ms", "3600000"));
+    EXPECT_EQ(DeviceConfig::INVALID_VALUE, config.set("heartbeat_ms", "4294967296"));    // over 32 bits
+    for (const char* text : {"", "-5", "+5", "4 0", "40cm", "0x20", "2.5"}) {
+        EXPECT_EQ(DeviceConfig::INVALID_VALUE, config.set("threshold_cm", text)) << '"' << text << '"';
+    }
+    EXPECT_EQ(DeviceConfig::INVALID_VALUE, config.set("threshold_cm", nullptr));
+    EXPECT_EQ(40u, config.thresholdCm);
+}
+
+TEST(DeviceConfig, UnknownKeysAreRejected) {
+    DeviceConfig config;
+    EXPECT_EQ(DeviceConfig::UNKNOWN_KEY, config.set("threshold", "40"));
+    EXPECT_EQ(DeviceConfig::UNKNOWN_KEY, config.set("", "40"));
+    EXPECT_EQ(nullptr, DeviceConfig::find("THRESHOLD_CM"));
+}
+
+TEST(DeviceConfig, EnforcesEachFieldsRange) {
+    size_t count;
+    const DeviceConfig::Field* fields = DeviceConfig::fields(count);
+    ASSERT_EQ(DeviceConfig::FIELD_COUNT, count);
+    for (size_t i = 0; i < count; i++) {
+        char text[16];
+        DeviceConfig config;
+        if (fields[i].minValue > 0) {
+            snprintf(text, sizeof(text), "%u", (unsigned)(fields[i].minValue - 1));
+            EXPECT_EQ(DeviceConfig::INVALID_VALUE, config.set(fields[i].key, text)) << fields[i].key;
+        }
+        snprintf(text, sizeof(text), "%u", (unsigned)(fields[i].maxValue + 1));
+        EXPECT_EQ(DeviceConfig::INVALID_VALUE, config.set(fields[i].key, text)) << fields[i].key;
+        EXPECT_EQ(&fields[i], DeviceConfig::find(fields[i].key));
+    }
+}
+
+TEST(DeviceConfig, OffThresholdStaysWithinTheSensorRange) {
+    DeviceConfig config;
+    EXPECT_EQ(DeviceConfig::CHANGED, config.set("threshold_cm", "390"));
+    EXPECT_EQ(DeviceConfig::INVALID_VALUE, config.set("hysteresis_cm", "11"));
+    EXPECT_EQ(10u, config.hysteresisCm);
+    EXPECT_EQ(DeviceConfig::INVALID_VALUE, config.set("threshold_cm", "400"));    // in range on its own
+    EXPECT_EQ(390u, config.thresholdCm);
+    EXPECT_TRUE(config.valid());
+}
+
+TEST(DeviceConfig, HeartbeatIsNotFasterThanTheMinimumInterval) {
+    DeviceConfig config;
+    EXPECT_EQ(DeviceConfig::CHANGED, config.set("heartbeat_ms", "5000"));
+    EXPECT_EQ(DeviceConfig::INVALID_VALUE, config.set("min_publish_interval_ms", "6000"));
+    EXPECT_EQ(DeviceConfig::CHANGED, config.set("min_publish_interval_ms", "5000"));
+    EXPECT_EQ(DeviceConfig::INVALID_VALUE, config.set("heartbeat_ms", "4999"));
+    EXPECT_EQ(5000u, config.heartbeatMs);
+}
+
+TEST(DeviceConfig, ReconnectBaseStaysBelowTheCap) {
+    DeviceConfig config;
+    EXPECT_EQ(DeviceConfig::INVALID_VALUE, config.set("reconnect_base_ms", "130000"));
+    EXPECT_EQ(DeviceConfig::CHANGED, config.set("reconnect_max_ms", "300000"));
+    EXPECT_EQ(DeviceConfig::CHANGED, config.set("reconnect_base_ms", "130000"));
+}
+
+// A change that only works together with another one has to come second.
+TEST(DeviceConfig, DependentChangesGoInOrder) {
+    DeviceConfig config;
+    config.set("heartbeat_ms", "5000");
+    // Going to min_publish_interval_ms=10000 and heartbeat_ms=20000:
+    EXPECT_EQ(DeviceConfig::INVALID_VALUE, config.set("min_publish_interval_ms", "10000"));
+    EXPECT_EQ(DeviceConfig::CHANGED, config.set("heartbeat_ms", "20000"));
+    EXPECT_EQ(DeviceConfig::CHANGED, config.set("min_publish_interval_ms", "10000"));
+}
+
+TEST(DeviceConfig, ValidCatchesAnInconsistentBlob) {
+    DeviceConfig config;
+    config.heartbeatMs = 1000;
+    config.minPublishIntervalMs = 2000;
+    EXPECT_FALSE(config.valid());
+    config.minPublishIntervalMs = 0;
+    config.thresholdCm = 0;
+    EXPECT_FALSE(config.valid());
+}
+
+// The layout 1 blob: the first eight fields, before metrics_interval_ms.
+struct LayoutOne {
+    uint32_t values[8];
+};
+
+TEST(DeviceConfigStorage, RestoresTheCurrentLayout) {
+    DeviceConfig stored;
+    stored.set("threshold_cm", "70");
+    stored.set("metrics_interval_ms", "30000");
+    DeviceConfig loaded;
+    ASSERT_TRUE(loaded.restore(DeviceConfig::LAYOUT, &stored, sizeof(stored)));
+    EXPECT_EQ(0, memcmp(&stored, &loaded, sizeof(stored)));
+}
+
+TEST(DeviceConfigStorage, MigratesLayoutOne) {
+    LayoutOne blob = {{80, 15, 20, 3, 1000, 30000, 4000, 240000}};
+    ASSERT_EQ(sizeof(blob), DeviceConfig::storedSize(1));
+    DeviceConfig loaded;
+    loaded.metricsIntervalMs = 12345;
+    ASSERT_TRUE(loaded.restore(1, &blob, sizeof(blob)));
+    EXPECT_EQ(80u, loaded.thresholdCm);
+    EXPECT_EQ(15u, loaded.hysteresisCm);
+    EXPECT_EQ(20u, loaded.sampleRateHz);
+    EXPECT_EQ(3u, loaded.deadbandCm);
+    EXPECT_EQ(1000u, loaded.minPublishIntervalMs);
+    EXPECT_EQ(30000u, loaded.heartbeatMs);
+    EXPECT_EQ(4000u, loaded.reconnectBaseMs);
+    EXPECT_EQ(240000u, loaded.reconnectMaxMs);
+    EXPECT_EQ(DeviceConfig().metricsIntervalMs, loaded.metricsIntervalMs);    // the default, not what was there
+}
+
+TEST(DeviceConfigStorage, RefusesWhatItCannotRead) {
+    DeviceConfig stored;
+    LayoutOne blob = {{80, 15, 20, 3, 1000, 30000, 4000, 240000}};
+    DeviceConfig loaded;
+    loaded.set("threshold_cm", "60");
+
+    EXPECT_FALSE(loaded.restore(0, &stored, sizeof(stored)));                           // nothing stored
+    EXPECT_FALSE(loaded.restore(DeviceConfig::LAYOUT + 1, &stored, sizeof(stored)));    // newer firmware
+    EXPECT_FALSE(loaded.restore(DeviceConfig::LAYOUT, &blob, sizeof(blob)));            // size of another layout
+    EXPECT_FALSE(loaded.restore(1, &stored, sizeof(stored)));
+    EXPECT_FALSE(loaded.restore(1, &blob, 0));
+
+    blob.values[0] = 1;    // below threshold_cm's range
+    EXPECT_FALSE(loaded.restore(1, &blob, sizeof(blob)));
+    blob.values[0] = 395;    // in range, but the off threshold is beyond the sensor
+    EXPECT_FALSE(loaded.restore(1, &blob, sizeof(blob)));
+    EXPECT_EQ(60u, loaded.thresholdCm);
+}
+
+TEST(DeviceConfigBench, SetOneField) {
+    DeviceConfig config;
+    const char* values[] = {"40", "45"};
+    uint32_t i = 0;
+    bench::Result result = bench::run("set() threshold_cm", [&] {
+        config.set("threshold_cm", values[i++ & 1]);
+        bench::doNotOptimize(config);
+    });
+    EXPECT_EQ(0, result.allocationsPerOp);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    if (RUN_ALL_TESTS()) {
+    }
+    return 0;
+}
@@ -0,0 +1,292 @@
+// Filter stages, the LED controller, and a replay benchmark: a synthetic
+// field trace (a target moving back and forth through the LED threshold,
+// with sensor noise, spikes and missed echoes) is run through the raw
+// threshold the firmware used to apply and through the sensing filter plus
+// the hysteresis/dwell controller, and LED toggles are compared with the
+// toggles the true distance calls for.
+
+#include <gtest/gtest.h>
+#include <math.h>
+#include <vector>
+
+#include "Bench.h"
+#include "DistanceFilter.h"
+#include "LedController.h"
+
+TEST(OutlierRejector, SwallowsShortRunsOfMisses) {
+    OutlierRejector stage;
+    float value = 100;
+    ASSERT_TRUE(stage.process(value));
+    for (int i = 0; i < 3; i++) {
+        value = -1;
+        EXPECT_FALSE(stage.process(value)) << i;
+    }
+    value = -1;
+    EXPECT_TRUE(stage.process(value));
+    EXPECT_EQ(-1, value);
+}
+
+TEST(OutlierRejector, TreatsOutOfRangeAsAMiss) {
+    OutlierRejector stage;
+    float value = 1;
+    EXPECT_FALSE(stage.process(value));
+    value = 500;
+    EXPECT_FALSE(stage.process(value));
+    value = 50;
+    EXPECT_TRUE(stage.process(value));
+    EXPECT_EQ(50, value);
+}
+
+TEST(OutlierRejector, RejectsJumpsUntilTheyPersist) {
+    OutlierRejector stage;
+    float value = 50;
+    ASSERT_TRUE(stage.process(value));
+    value = 300;
+    EXPECT_FALSE(stage.process(value));    // a single spike
+    value = 52;
+    EXPECT_TRUE(stage.process(value));
+
+    for (int i = 0; i < 3; i++) {
+        value = 300;
+        EXPECT_FALSE(stage.process(value));
+    }
+    value = 300;
+    EXPECT_TRUE(stage.process(value));    // the target really moved
+    EXPECT_EQ(300, value);
+}
+
+TEST(SlidingMedian, ReturnsTheMedianOfTheWindow) {
+    SlidingMedian<5> stage;
+    const float input[] = {10, 50, 20, 40, 30, 90, 90, 90};
+    const float expected[] = {10, 10, 20, 20, 30, 40, 40, 90};
+    for (size_t i = 0; i < 8; i++) {
+        float value = input[i];
+        ASSERT_TRUE(stage.process(value));
+        EXPECT_EQ(expected[i], value) << i;
+    }
+}
+
+TEST(SlidingMedian, NoTargetClearsTheWindow) {
+    SlidingMedian<3> stage;
+    float value = 10;
+    stage.process(value);
+    value = 10;
+    stage.process(value);
+    value = -1;
+    EXPECT_TRUE(stage.process(value));
+    EXPECT_EQ(-1, value);
+    value = 80;
+    stage.process(value);
+    EXPECT_EQ(80, value);
+}
+
+TEST(SlidingMedian, HandlesRepeatedValues) {
+    SlidingMedian<3> stage;
+    const float input[] = {5, 5, 5, 7, 5, 7, 7};
+    for (float sample : input) {
+        float value = sample;
+        stage.process(value);
+    }
+    float value = 7;
+    stage.process(value);
+    EXPECT_EQ(7, value);
+}
+
+TEST(Kalman1D, ConvergesOnAStepAndResets) {
+    Kalman1D stage;
+    float value = 100;
+    stage.process(value);
+    EXPECT_EQ(100, value);
+    for (int i = 0; i < 50; i++) {
+        value = 60;
+        stage.process(value);
+    }
+    EXPECT_NEAR(60, value, 0.5);
+
+    value = -1;
+    stage.process(value);
+    EXPECT_EQ(-1, value);
+    value = 200;
+    stage.process(value);
+    EXPECT_EQ(200, value);    // starts over rather than blending with 60
+}
+
+TEST(ExponentialAverage, Smooths) {
+    ExponentialAverage stage(0.5f);
+    float value = 10;
+    stage.process(value);
+    value = 20;
+    stage.process(value);
+    EXPECT_FLOAT_EQ(15, value);
+}
+
+TEST(FilterChain, StopsAtTheFirstStageThatSwallows) {
+    SensingFilter chain;
+    float value = 100;
+    EXPECT_TRUE(chain.process(value));
+    value = 390;
+    EXPECT_FALSE(chain.process(value));    // the jump is held back before the median sees it
+    value = 101;
+    EXPECT_TRUE(chain.process(value));
+    EXPECT_NEAR(100.5, value, 1);
+}
+
+TEST(LedController, SwitchesWithHysteresis) {
+    LedController led(50, 60, 0);
+    EXPECT_FALSE(led.update(80, 0));
+    EXPECT_TRUE(led.update(50, 1));
+    EXPECT_TRUE(led.isOn());
+    EXPECT_FALSE(led.update(58, 2));    // inside the band: stays on
+    EXPECT_TRUE(led.update(61, 3));
+    EXPECT_FALSE(led.isOn());
+    EXPECT_FALSE(led.update(55, 4));    // inside the band: stays off
+    EXPECT_FALSE(led.update(-1, 5));    // no target is never "close"
+    EXPECT_EQ(2u, led.transitionCount());
+}
+
+TEST(LedController, WaitsOutTheDwellTime) {
+    LedController led(50, 60, 500);
+    EXPECT_TRUE(led.update(40, 1000));
+    EXPECT_FALSE(led.update(100, 1200));
+    EXPECT_TRUE(led.isOn());
+    EXPECT_TRUE(led.update(100, 1500));
+    EXPECT_FALSE(led.isOn());
+}
+
+TEST(LedController, ManualModeIgnoresDistance) {
+    LedController led(50, 60, 500);
+    EXPECT_TRUE(led.setManual(true, 0));
+    EXPECT_FALSE(led.update(200, 5000));
+    EXPECT_TRUE(led.isOn());
+    EXPECT_TRUE(led.setManual(false, 10));    // manual ignores the dwell time
+    EXPECT_TRUE(led.setAuto());
+    EXPECT_FALSE(led.setAuto());
+    EXPECT_TRUE(led.update(10, 20000));
+}
+
+TEST(LedController, ThresholdsKeepOffAboveOn) {
+    LedController led(50, 60, 0);
+    led.setThresholds(70, 40);
+    EXPECT_EQ(70, led.onThreshold());
+    EXPECT_EQ(70, led.offThreshold());
+}
+
+TEST(LedController, RestoreIsNotATransition) {
+    LedController led(50, 60, 500);
+    led.restore(true, false, 1000, 7);
+    EXPECT_TRUE(led.isOn());
+    EXPECT_EQ(7u, led.transitionCount());
+    EXPECT_FALSE(led.update(100, 1200));    // still inside the restored dwell
+    EXPECT_TRUE(led.update(100, 1500));
+}
+
+// A deterministic field trace at 25 Hz: the target swings between 30 and
+// 170 cm every 20 s. Readings carry about ±2 cm of noise; 3% are spikes to
+// a random distance and 5% are missed echoes (-1).
+struct TracePoint {
+    float trueCm;
+    float measuredCm;
+};
+
+std::vector<TracePoint> fieldTrace(uint32_t samples) {
+    std::vector<TracePoint> trace(samples);
+    uint32_t seed = 12345;
+    auto random = [&seed] {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0f;
+    };
+    for (uint32_t i = 0; i < samples; i++) {
+        float t = i / 25.0f;
+        float trueCm = 100 + 70 * sinf(2 * (float)M_PI * t / 20);
+        float noise = (random() + random() + random() - 1.5f) * 2.5f;
+        float roll = random();
+        float measured = roll < 0.03f ? 2 + random() * 398 : roll < 0.08f ? -1 : trueCm + noise;
+        trace[i] = {trueCm, measured};
+    }
+    return trace;
+}
+
+struct ToggleCount {
+    uint32_t expected;
+    uint32_t raw;
+    uint32_t filtered;
+};
+
+const float ON_CM = 50;
+const float OFF_CM = 60;
+
+ToggleCount countToggles(const std::vector<TracePoint>& trace) {
+    ToggleCount count = {0, 0, 0};
+    LedController truth(ON_CM, OFF_CM, 0);
+    bool rawOn = false;
+    SensingFilter filter;
+    LedController led(ON_CM, OFF_CM, 500);
+    for (size_t i = 0; i < trace.size(); i++) {
+        uint32_t nowMs = i * 40;
+        if (truth.update(trace[i].trueCm, nowMs)) count.expected++;
+
+        bool wantOn = trace[i].measuredCm > 0 && trace[i].measuredCm <= ON_CM;
+        if (wantOn != rawOn) {
+            rawOn = wantOn;
+            count.raw++;
+        }
+
+        float value = trace[i].measuredCm;
+        if (filter.process(value) && led.update(value, nowMs)) count.filtered++;
+    }
+    return count;
+}
+
+TEST(FilterReplay, FalseToggleRate) {
+    const uint32_t SAMPLES = 25 * 600;    // ten minutes
+    std::vector<TracePoint> trace = fieldTrace(SAMPLES);
+    ToggleCount count = countToggles(trace);
+    ASSERT_EQ(60u, count.expected);
+
+    double rawRate = (double)(count.raw - count.expected) / SAMPLES * 1000;
+    double filteredRate = ((double)count.filtered - count.expected) / SAMPLES * 1000;
+    printf("[bench] %-36s %12.2f false toggles/1000 samples (%u toggles, %u expected)\n", "replay raw threshold", rawRate,
+           count.raw, count.expected);
+    printf("[bench] %-36s %12.2f false toggles/1000 samples (%u toggles, %u expected)\n",
+           "replay filter+hysteresis", filteredRate, count.filtered, count.expected);
+    EXPECT_GT(count.raw, 3 * count.expected);
+    EXPECT_EQ(count.expected, count.filtered);
+}
+
+TEST(FilterReplay, CostPerSample) {
+    std::vector<TracePoint> trace = fieldTrace(4096);
+    SensingFilter filter;
+    LedController led(ON_CM, OFF_CM, 500);
+    size_t i = 0;
+    uint32_t nowMs = 0;
+    bench::Result result = bench::run("replay filter+LED per sample", [&] {
+        float value = trace[i].measuredCm;
+        i = (i + 1) & 4095;
+        nowMs += 40;
+        if (filter.process(value)) led.update(value, nowMs);
+        bench::doNotOptimize(value);
+    });
+    EXPECT_EQ(0, result.allocationsPerOp);
+
+#if defined(__x86_64__) || defined(__i386__)
+    const uint32_t ROUNDS = 200;
+    uint64_t start = __builtin_ia32_rdtsc();
+    for (uint32_t round = 0; round < ROUNDS; round++) {
+        for (size_t j = 0; j < trace.size(); j++) {
+            float value = trace[j].measuredCm;
+            nowMs += 40;
+            if (filter.process(value)) led.update(value, nowMs);
+            bench::doNotOptimize(value);
+        }
+    }
+    double cycles = (double)(__builtin_ia32_rdtsc() - start) / (ROUNDS * trace.size());
+    printf("[bench] %-36s %12.1f TSC cycles/sample\n", "replay filter+LED per sample", cycles);
+#endif
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    if (RUN_ALL_TESTS()) {
+    }
+    return 0;
+}
@@ -0,0 +1,438 @@
+// PayloadWriter: the JSON text it produces, a MessagePack round trip through
+// a small decoder written for the test, the metrics message with every
+// counter at its widest, and size and encode time of both formats for the
+// telemetry and ack messages.
+
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "PayloadWriter.h"
+#include "TelemetryPayload.h"
+
+std::string json(void (*build)(PayloadWriter&), size_t capacity = 256) {
+    uint8_t buffer[512];
+    PayloadWriter writer(buffer, capacity, PayloadWriter::JSON);
+    build(writer);
+    size_t length = writer.end();
+    return length ? std::string((char*)buffer, length) : "<overflow>";
+}
+
+TEST(PayloadWriterJson, WritesEveryType) {
+    EXPECT_EQ("{\"s\":\"text\",\"b\":true,\"i\":-42,\"u\":4294967295,\"f\":12.35}", json([](PayloadWriter& w) {
+                  w.beginObject(5);
+                  w.add("s", "text");
+                  w.add("b", true);
+                  w.add("i", (int32_t)-42);
+                  w.add("u", (uint32_t)4294967295u);
+                  w.add("f", 12.345f);
+              }));
+}
+
+TEST(PayloadWriterJson, FloatsAreFixedPoint) {
+    EXPECT_EQ("{\"a\":0.00,\"b\":-1.00,\"c\":0.05,\"d\":399.99}", json([](PayloadWriter& w) {
+                  w.beginObject(4);
+                  w.add("a", 0.0f);
+                  w.add("b", -1.0f);
+                  w.add("c", 0.049f);
+                  w.add("d", 399.99f);
+              }));
+    EXPECT_EQ("{\"nan\":null}", json([](PayloadWriter& w) {
+                  w.beginObject(1);
+                  w.add("nan", 0.0f / 0.0f);
+              }));
+}
+
+TEST(PayloadWriterJson, IntegerExtremes) {
+    EXPECT_EQ("{\"min\":-2147483648,\"zero\":0}", json([](PayloadWriter& w) {
+                  w.beginObject(2);
+                  w.add("min", (int32_t)INT32_MIN);
+                  w.add("zero", (uint32_t)0);
+              }));
+}
+
+TEST(PayloadWriterJson, EscapesStrings) {
+    EXPECT_EQ("{\"k\":\"a\\\"b\\\\c\\u000a\"}", json([](PayloadWriter& w) {
+                  w.beginObject(1);
+                  w.add("k", "a\"b\\c\n");
+              }));
+}
+
+TEST(PayloadWriterJson, FloatArrays) {
+    EXPECT_EQ("{\"sensors\":[1.00,-1.00,2.50]}", json([](PayloadWriter& w) {
+                  const float values[] = {1, -1, 2.5f};
+                  w.beginObject(1);
+                  w.add("sensors", values, 3);
+              }));
+}
+
+TEST(PayloadWriterJson, NestedObjects) {
+    EXPECT_EQ("{\"a\":1,\"o\":{\"b\":2,\"p\":{\"c\":3}},\"d\":4}", json([](PayloadWriter& w) {
+                  w.beginObject(3);
+                  w.add("a", (uint32_t)1);
+                  w.beginObject("o", 2);
+                  w.add("b", (uint32_t)2);
+                  w.beginObject("p", 1);
+                  w.add("c", (uint32_t)3);
+                  w.endObject();
+                  w.endObject();
+                  w.add("d", (uint32_t)4);
+              }));
+    EXPECT_EQ("<overflow>", json([](PayloadWriter& w) {
+                  w.beginObject(1);
+                  w.beginObject("open", 0);
+              }));
+}
+
+TEST(PayloadWriterJson, ReportsOverflow) {
+    for (size_t capacity = 0; capacity < 12; capacity++) {
+        uint8_t buffer[16];
+        PayloadWriter writer(buffer, capacity, PayloadWriter::JSON);
+        writer.beginObject(1);
+        writer.add("key", "value");    // {"key":"value"} plus the terminator needs 16
+        EXPECT_EQ(0u, writer.end()) << capacity;
+    }
+    EXPECT_EQ("<overflow>", json([](PayloadWriter& w) {
+                  w.beginObject(1);
+                  w.add("key", "value");
+              }, 15));
+    EXPECT_EQ("{\"key\":\"value\"}", json([](PayloadWriter& w) {
+                  w.beginObject(1);
+                  w.add("key", "value");
+              }, 16));
+}
+
+// Just enough MessagePack to read back what PayloadWriter writes.
+struct Value {
+    enum Type { NIL, BOOL, INT, FLOAT, STRING, ARRAY, MAP } type = NIL;
+    bool boolean = false;
+    int64_t integer = 0;
+    float real = 0;
+    std::string text;
+    std::vector<Value> items;
+    std::map<std::string, Value> fields;
+};
+
+class Decoder {
+public:
+    Decoder(const uint8_t* data, size_t length) : data(data), length(length) {}
+
+    bool decode(Value& out) {
+        if (!read(out)) return false;
+        return position == length;    // no trailing bytes
+    }
+
+private:
+    bool read(Value& out) {
+        uint8_t tag;
+        if (!byte(tag)) return false;
+        if (tag <= 0x7f) return integer(out, tag);
+        if (tag >= 0xe0) return integer(out, (int8_t)tag);
+        if ((tag & 0xf0) == 0x80) return map(out, tag & 0x0f);
+        if ((tag & 0xf0) == 0x90) return array(out, tag & 0x0f);
+        if ((tag & 0xe0) == 0xa0) return string(out, tag & 0x1f);
+        uint64_t n;
+        switch (tag) {
+            case 0xc0: out.type = Value::NIL; return true;
+            case 0xc2: case 0xc3: out.type = Value::BOOL; out.boolean = tag == 0xc3; return true;
+            case 0xca: {
+                if (!bigEndian(4, n)) return false;
+                uint32_t bits = (uint32_t)n;
+                out.type = Value::FLOAT;
+                memcpy(&out.real, &bits, sizeof(bits));
+                return true;
+            }
+            case 0xcc: return bigEndian(1, n) && integer(out, (int64_t)n);
+            case 0xcd: return bigEndian(2, n) && integer(out, (int64_t)n);
+            case 0xce: return bigEndian(4, n) && integer(out, (int64_t)n);
+            case 0xd2: return bigEndian(4, n) && integer(out, (int32_t)(uint32_t)n);
+            case 0xd9: return bigEndian(1, n) && string(out, n);
+            case 0xda: return bigEndian(2, n) && string(out, n);
+            case 0xdc: return bigEndian(2, n) && array(out, n);
+            case 0xde: return bigEndian(2, n) && map(out, n);
+        }
+        return false;
+    }
+
+    bool integer(Value& out, int64_t value) {
+        out.type = Value::INT;
+        out.integer = value;
+        return true;
+    }
+
+    bool string(Value& out, uint64_t n) {
+        if (length - position < n) return false;
+        out.type = Value::STRING;
+        out.text.assign((const char*)data + position, n);
+        position += n;
+        return true;
+    }
+
+    bool array(Value& out, uint64_t n) {
+        out.type = Value::ARRAY;
+        out.items.resize(n);
+        for (uint64_t i = 0; i < n; i++) {
+            if (!read(out.items[i])) return false;
+        }
+        return true;
+    }
+
+    bool map(Value& out, uint64_t n) {
+        out.type = Value::MAP;
+        for (uint64_t i = 0; i < n; i++) {
+            Value key;
+            if (!read(key) || key.type != Value::STRING || !read(out.fields[key.text])) return false;
+        }
+        return out.fields.size() == n;    // duplicate keys would show up here
+    }
+
+    bool byte(uint8_t& out) {
+        if (position >= length) return false;
+        out = data[position++];
+        return true;
+    }
+
+    bool bigEndian(uint8_t bytes, uint64_t& out) {
+        out = 0;
+        for (uint8_t i = 0; i < bytes; i++) {
+            uint8_t b;
+            if (!byte(b)) return false;
+            out = out << 8 | b;
+        }
+        return true;
+    }
+
+    const uint8_t* data;
+    size_t length;
+    size_t position = 0;
+};
+
+Value msgpack(void (*build)(PayloadWriter&)) {
+    uint8_t buffer[512];
+    PayloadWriter writer(buffer, sizeof(buffer), PayloadWriter::MSGPACK);
+    build(writer);
+    size_t length = writer.end();
+    Value value;
+    EXPECT_GT(length, 0u);
+    EXPECT_TRUE(Decoder(buffer, length).decode(value));
+    return value;
+}
+
+TEST(PayloadWriterMsgPack, RoundTripsEveryType) {
+    Value doc = msgpack([](PayloadWriter& w) {
+        w.beginObject(5);
+        w.add("s", "text");
+        w.add("b", false);
+        w.add("i", (int32_t)-42);
+        w.add("u", (uint32_t)4294967295u);
+        w.add("f", 12.345f);
+    });
+    ASSERT_EQ(Value::MAP, doc.type);
+    EXPECT_EQ("text", doc.fields["s"].text);
+    EXPECT_EQ(Value::BOOL, doc.fields["b"].type);
+    EXPECT_FALSE(doc.fields["b"].boolean);
+    EXPECT_EQ(-42, doc.fields["i"].integer);
+    EXPECT_EQ(4294967295LL, doc.fields["u"].integer);
+    EXPECT_EQ(12.345f, doc.fields["f"].real);    // float32 keeps the exact value
+}
+
+TEST(PayloadWriterMsgPack, IntegersUseEveryWidth) {
+    static const int64_t SIGNED[] = {0, 127, -1, -32, -33, -70000, INT32_MIN, INT32_MAX};
+    for (int64_t expected : SIGNED) {
+        uint8_t buffer[32];
+        PayloadWriter writer(buffer, sizeof(buffer), PayloadWriter::MSGPACK);
+        writer.beginObject(1);
+        writer.add("v", (int32_t)expected);
+        Value doc;
+        ASSERT_TRUE(Decoder(buffer, writer.end()).decode(doc)) << expected;
+        EXPECT_EQ(expected, doc.fields["v"].integer);
+    }
+    static const uint32_t UNSIGNED[] = {0, 127, 128, 255, 256, 65535, 65536, UINT32_MAX};
+    for (uint32_t expected : UNSIGNED) {
+        uint8_t buffer[32];
+        PayloadWriter writer(buffer, sizeof(buffer), PayloadWriter::MSGPACK);
+        writer.beginObject(1);
+        writer.add("v", expected);
+        Value doc;
+        ASSERT_TRUE(Decoder(buffer, writer.end()).decode(doc)) << expected;
+        EXPECT_EQ(expected, doc.fields["v"].integer);
+    }
+}
+
+TEST(PayloadWriterMsgPack, StringLengthsAndLargeMaps) {
+    static std::string longText(300, 'x');
+    static std::string mediumText(100, 'y');
+    Value doc = msgpack([](PayloadWriter& w) {
+        w.beginObject(20);
+        w.add("long", longText.c_str());
+        w.add("medium", mediumText.c_str());
+        static const char* KEYS[] = {"k2", "k3", "k4", "k5", "k6", "k7", "k8", "k9", "k10",
+                                     "k11", "k12", "k13", "k14", "k15", "k16", "k17", "k18", "k19"};
+        for (uint32_t i = 0; i < 18; i++) w.add(KEYS[i], i);
+    });
+    EXPECT_EQ(20u, doc.fields.size());
+    EXPECT_EQ(longText, doc.fields["long"].text);
+    EXPECT_EQ(mediumText, doc.fields["medium"].text);
+    EXPECT_EQ(17, doc.fields["k19"].integer);
+}
+
+TEST(PayloadWriterMsgPack, FloatArrays) {
+    Value doc = msgpack([](PayloadWriter& w) {
+        static const float values[17] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, -1};
+        w.beginObject(2);
+        w.add("few", values, 2);
+        w.add("many", values, 17);
+    });
+    ASSERT_EQ(2u, doc.fields["few"].items.size());
+    ASSERT_EQ(17u, doc.fields["many"].items.size());
+    EXPECT_EQ(-1, doc.fields["many"].items[16].real);
+}
+
+TEST(PayloadWriterMsgPack, TelemetryMatchesJson) {
+    const float sensors[2] = {12.5f, 80};
+    TelemetryFields fields = {"capstone-esp32-01", 12.5f, sensors, 2, true, false, -61, 3600,
+                              "192.168.1.123", 3600000, "change", 2};
+    uint8_t buffer[384];
+    size_t length = writeTelemetryPayload(buffer, sizeof(buffer), PayloadWriter::MSGPACK, fields);
+    Value doc;
+    ASSERT_TRUE(Decoder(buffer, length).decode(doc));
+    EXPECT_EQ(11u, doc.fields.size());
+    EXPECT_EQ("ON", doc.fields["led_status"].text);
+    EXPECT_EQ(-61, doc.fields["wifi_rssi"].integer);
+    EXPECT_EQ(80, doc.fields["sensors"].items[1].real);
+    EXPECT_EQ(2, doc.fields["schema"].integer);
+
+    length = writeTelemetryPayload(buffer, sizeof(buffer), PayloadWriter::JSON, fields);
+    EXPECT_EQ("{\"device_id\":\"capstone-esp32-01\",\"distance\":12.50,\"sensors\":[12.50,80.00],\"led_status\":\"ON\","
+              "\"manual_mode\":false,\"wifi_rssi\":-61,\"uptime\":3600,\"ip_address\":\"192.168.1.123\","
+              "\"timestamp\":3600000,\"reason\":\"change\",\"schema\":2}",
+              std::string((char*)buffer, length));
+}
+
+TEST(PayloadWriterMsgPack, NestedObjects) {
+    Value doc = msgpack([](PayloadWriter& w) {
+        w.beginObject(2);
+        w.beginObject("o", 2);
+        w.add("b", (uint32_t)2);
+        w.beginObject("p", 0);
+        w.endObject();
+        w.endObject();
+        w.add("d", (uint32_t)4);
+    });
+    EXPECT_EQ(2u, doc.fields.size());
+    EXPECT_EQ(2, doc.fields["o"].fields["b"].integer);
+    EXPECT_EQ(Value::MAP, doc.fields["o"].fields["p"].type);
+    EXPECT_EQ(4, doc.fields["d"].integer);
+}
+
+TEST(PayloadWriterMsgPack, ReportsOverflow) {
+    uint8_t buffer[8];
+    PayloadWriter writer(buffer, sizeof(buffer), PayloadWriter::MSGPACK);
+    writer.beginObject(1);
+    writer.add("key", "value");
+    EXPECT_EQ(0u, writer.end());
+}
+
+// The stages and buffer as main.cpp has them.
+const char* const STAGE_NAMES[] = {
+    "commands", "sense", "submit", "mqtt_loop", "publish", "batch_publish",
+    "acks", "shadow", "replay", "dashboard", "serial",
+};
+const uint8_t STAGE_COUNT = sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]);
+const size_t METRICS_PAYLOAD_SIZE = 1792;
+
+// After months of uptime every counter can be ten digits wide, and AWS IoT
+// allows client IDs up to 128 characters.
+MetricsFields widestMetrics(const std::string& deviceId, const StageSummary* stages) {
+    const StageSummary widest = {UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX};
+    return {deviceId.c_str(), UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX,
+            UINT32_MAX, UINT32_MAX, UINT32_MAX, STAGE_NAMES, stages, STAGE_COUNT, widest, widest, UINT32_MAX};
+}
+
+TEST(MetricsPayload, WorstCaseFitsTheMetricsBuffer) {
+    std::string deviceId(128, 'x');
+    StageSummary stages[STAGE_COUNT];
+    for (StageSummary& stage : stages) stage = {UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX};
+    MetricsFields fields = widestMetrics(deviceId, stages);
+
+    static const PayloadWriter::Format FORMATS[] = {PayloadWriter::JSON, PayloadWriter::MSGPACK};
+    for (PayloadWriter::Format format : FORMATS) {
+        uint8_t buffer[METRICS_PAYLOAD_SIZE];
+        size_t length = writeMetricsPayload(buffer, sizeof(buffer), format, fields);
+        printf("[bench] %-36s %12u bytes\n", format == PayloadWriter::JSON ? "metrics worst case json"
+                                                                           : "metrics worst case msgpack",
+               (unsigned)length);
+        EXPECT_GT(length, 0u);
+    }
+}
+
+TEST(MetricsPayload, MsgPackMatchesJson) {
+    StageSummary stages[STAGE_COUNT] = {};
+    stages[1] = {600, 850, 1200, 4100};
+    MetricsFields fields = {"capstone-esp32-01", 3600, 180000, 150000, 90000, 700, 3, 0, 2, 1,
+                            STAGE_NAMES, stages, STAGE_COUNT, {600, 40, 150, 900}, {2, 2500000, 3000000, 3000000}, 2};
+    uint8_t buffer[METRICS_PAYLOAD_SIZE];
+    size_t length = writeMetricsPayload(buffer, sizeof(buffer), PayloadWriter::MSGPACK, fields);
+    Value doc;
+    ASSERT_TRUE(Decoder(buffer, length).decode(doc));
+    EXPECT_EQ(14u, doc.fields.size());
+    EXPECT_EQ((size_t)STAGE_COUNT, doc.fields["stages"].fields.size());
+    EXPECT_EQ(1200, doc.fields["stages"].fields["sense"].fields["p99_us"].integer);
+    EXPECT_EQ(2500000, doc.fields["aws_connect"].fields["avg_us"].integer);
+
+    length = writeMetricsPayload(buffer, sizeof(buffer), PayloadWriter::JSON, fields);
+    std::string text((char*)buffer, length);
+    EXPECT_EQ(0u, text.find("{\"device_id\":\"capstone-esp32-01\",\"uptime\":3600,"));
+    EXPECT_NE(std::string::npos, text.find("\"sense\":{\"n\":600,\"avg_us\":850,\"p99_us\":1200,\"max_us\":4100}"));
+    EXPECT_NE(std::string::npos, text.find("\"serial\":{\"n\":0,\"avg_us\":0,\"p99_us\":0,\"max_us\":0}},"
+                                           "\"sample_jitter\""));
+}
+
+void compare(const char* name, PayloadWriter::Format format, const TelemetryFields& fields) {
+    uint8_t buffer[384];
+    size_t length = 0;
+    std::string label = std::string(name) + (format == PayloadWriter::JSON ? " json" : " msgpack");
+    bench::Result result = bench::run(label.c_str(), [&] {
+        length = writeTelemetryPayload(buffer, sizeof(buffer), format, fields);
+        bench::doNotOptimize(buffer);
+    });
+    printf("[bench] %-36s %12u bytes\n", label.c_str(), (unsigned)length);
+    EXPECT_EQ(0, result.allocationsPerOp);
+}
+
+TEST(PayloadWriterBench, TelemetryJsonVsMsgPack) {
+    const float sensors[4] = {12.5f, 80, -1, 230.25f};
+    TelemetryFields single = {"capstone-esp32-01", 12.5f, sensors, 1, true, false, -61, 3600,
+                              "192.168.1.123", 3600000, "change", 2};
+    TelemetryFields array = single;
+    array.sensorCount = 4;
+    compare("telemetry", PayloadWriter::JSON, single);
+    compare("telemetry", PayloadWriter::MSGPACK, single);
+    compare("telemetry 4 sensors", PayloadWriter::JSON, array);
+    compare("telemetry 4 sensors", PayloadWriter::MSGPACK, array);
+}
+
+TEST(PayloadWriterBench, AckJsonVsMsgPack) {
+    static const PayloadWriter::Format FORMATS[] = {PayloadWriter::JSON, PayloadWriter::MSGPACK};
+    for (PayloadWriter::Format format : FORMATS) {
+        uint8_t buffer[192];
+        size_t length = 0;
+        const char* label = format == PayloadWriter::JSON ? "ack json" : "ack msgpack";
+        bench::Result result = bench::run(label, [&] {
+            length = writeAckPayload(buffer, sizeof(buffer), format, "capstone-esp32-01", "LED_ON", "OK", "abc123",
+                                     3600000, 2);
+            bench::doNotOptimize(buffer);
+        });
+        printf("[bench] %-36s %12u bytes\n", label, (unsigned)length);
+        EXPECT_EQ(0, result.allocationsPerOp);
+    }
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    if (RUN_ALL_TESTS()) {
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+// ReconnectBackoff's schedule as the network task and the low-power wake
+// loop follow it: the window doubling per failure up to the cap, the equal
+// jitter staying inside the upper half of the window, success and a dropped
+// connection starting over, and the clock wrapping underneath it.
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include "Bench.h"
+#include "ReconnectBackoff.h"
+
+const uint32_t BASE_MS = 2000;
+const uint32_t MAX_MS = 120000;
+
+// A random value that lands the jitter at the bottom or top of the window.
+const uint32_t LOWEST = 0;
+const uint32_t HIGHEST = 0xffffffffu;
+
+uint32_t highest(uint32_t window) { return window / 2; }    // random % (window / 2 + 1) == window / 2
+
+TEST(ReconnectBackoff, WindowDoublesUpToTheCap) {
+    uint32_t expected[] = {2000, 4000, 8000, 16000, 32000, 64000, 120000, 120000, 120000};
+    for (uint32_t failures = 0; failures < sizeof(expected) / sizeof(expected[0]); failures++) {
+        uint32_t window = expected[failures];
+        EXPECT_EQ(window / 2, ReconnectBackoff::delayAfter(failures, BASE_MS, MAX_MS, LOWEST)) << failures;
+        EXPECT_EQ(window, ReconnectBackoff::delayAfter(failures, BASE_MS, MAX_MS, highest(window))) << failures;
+    }
+}
+
+TEST(ReconnectBackoff, ManyFailuresStayAtTheCap) {
+    EXPECT_GE(MAX_MS, ReconnectBackoff::delayAfter(1000000, BASE_MS, MAX_MS, HIGHEST));
+    EXPECT_EQ(MAX_MS / 2, ReconnectBackoff::delayAfter(0xffffffffu, BASE_MS, MAX_MS, LOWEST));
+}
+
+TEST(ReconnectBackoff, JitterStaysInTheUpperHalf) {
+    uint32_t seed = 12345;
+    for (uint32_t failures = 0; failures < 10; failures++) {
+        uint32_t lowest = 0xffffffffu, top = 0;
+        for (int i = 0; i < 2000; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            uint32_t delay = ReconnectBackoff::delayAfter(failures, BASE_MS, MAX_MS, seed);
+            if (delay < lowest) lowest = delay;
+            if (delay > top) top = delay;
+        }
+        uint32_t cap = failures < 6 ? BASE_MS << failures : MAX_MS;
+        EXPECT_GE(lowest, cap / 2) << failures;
+        EXPECT_LE(top, cap) << failures;
+        // Spread over the half, not stuck at one end.
+        EXPECT_GT(top - lowest, cap / 4) << failures;
+    }
+}
+
+TEST(ReconnectBackoff, CountsWakesAsWellAsMilliseconds) {
+    // Low-power mode: base 2 wakes, cap 64.
+    EXPECT_EQ(1u, ReconnectBackoff::delayAfter(0, 2, 64, LOWEST));
+    EXPECT_EQ(2u, ReconnectBackoff::delayAfter(0, 2, 64, HIGHEST));
+    EXPECT_EQ(64u, ReconnectBackoff::delayAfter(10, 2, 64, highest(64)));
+}
+
+TEST(ReconnectBackoff, FailuresScheduleTheNextAttempt) {
+    ReconnectBackoff backoff(BASE_MS, MAX_MS);
+    EXPECT_TRUE(backoff.due(0));
+    backoff.onFailure(1000, LOWEST);
+    EXPECT_EQ(1u, backoff.failureCount());
+    EXPECT_EQ(BASE_MS / 2, backoff.currentDelay());
+    EXPECT_FALSE(backoff.due(1000 + BASE_MS / 2 - 1));
+    EXPECT_TRUE(backoff.due(1000 + BASE_MS / 2));
+
+    backoff.onFailure(3000, highest(2 * BASE_MS));
+    EXPECT_EQ(2u, backoff.failureCount());
+    EXPECT_EQ(2 * BASE_MS, backoff.currentDelay());
+    EXPECT_FALSE(backoff.due(3000 + 2 * BASE_MS - 1));
+    EXPECT_TRUE(backoff.due(3000 + 2 * BASE_MS));
+}
+
+TEST(ReconnectBackoff, SuccessStartsOver) {
+    ReconnectBackoff backoff(BASE_MS, MAX_MS);
+    for (int i = 0; i < 8; i++) backoff.onFailure(0, LOWEST);
+    EXPECT_EQ(MAX_MS / 2, backoff.currentDelay());
+    backoff.onSuccess();
+    EXPECT_EQ(0u, backoff.failureCount());
+    EXPECT_EQ(0u, backoff.currentDelay());
+    backoff.onFailure(0, LOWEST);
+    EXPECT_EQ(BASE_MS / 2, backoff.currentDelay());
+}
+
+// A dropped connection waits one jittered base interval and does not count
+// as a failure, so the next window is still the first.
+TEST(ReconnectBackoff, RestartWaitsOneBaseInterval) {
+    ReconnectBackoff backoff(BASE_MS, MAX_MS);
+    backoff.restart(5000, highest(BASE_MS));
+    EXPECT_EQ(0u, backoff.failureCount());
+    EXPECT_EQ(BASE_MS, backoff.currentDelay());
+    EXPECT_FALSE(backoff.due(5000 + BASE_MS - 1));
+    EXPECT_TRUE(backoff.due(5000 + BASE_MS));
+    backoff.onFailure(7000, LOWEST);
+    EXPECT_EQ(BASE_MS / 2, backoff.currentDelay());
+}
+
+TEST(ReconnectBackoff, NewLimitsApplyToTheNextFailure) {
+    ReconnectBackoff backoff(BASE_MS, MAX_MS);
+    backoff.onFailure(0, LOWEST);
+    backoff.setLimits(500, 1000);
+    backoff.onFailure(0, HIGHEST);
+    EXPECT_GE(1000u, backoff.currentDelay());
+    EXPECT_LE(500u, backoff.currentDelay());
+}
+
+TEST(ReconnectBackoff, SurvivesTheMillisWrap) {
+    ReconnectBackoff backoff(BASE_MS, MAX_MS);
+    uint32_t now = 0xffffffffu - 500;
+    backoff.onFailure(now, highest(BASE_MS));
+    EXPECT_FALSE(backoff.due(now + 1000));    // past the wrap, still waiting
+    EXPECT_TRUE(backoff.due(now + BASE_MS));
+}
+
+TEST(ReconnectBackoffBench, OnFailure) {
+    ReconnectBackoff backoff(BASE_MS, MAX_MS);
+    uint32_t now = 0;
+    bench::Result result = bench::run("onFailure() at the cap", [&] {
+        backoff.onFailure(now, now * 2654435761u);
+        now += 1000;
+        bench::doNotOptimize(backoff);
+    });
+    EXPECT_EQ(0, result.allocationsPerOp);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    if (RUN_ALL_TESTS()) {
+    }
+    return 0;
+}
@@ -0,0 +1,214 @@
+// TelemetryQueue against real files in a temporary directory, including
+// torn frames from a power cut and short writes on a full file system.
+
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <string>
+
+#include "Bench.h"
+#include "TelemetryQueue.h"
+
+class Queue : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char pattern[] = "/tmp/telemetry_queue_XXXXXX";
+        ASSERT_TRUE(mkdtemp(pattern));
+        dir = pattern;
+        logPath = dir + "/telemetry.log";
+        cursorPath = dir + "/telemetry.cur";
+    }
+
+    void TearDown() override {
+        remove(logPath.c_str());
+        remove(cursorPath.c_str());
+        rmdir(dir.c_str());
+    }
+
+    TelemetryQueue open(uint32_t capacity = 1000) {
+        TelemetryQueue queue(logPath.c_str(), cursorPath.c_str(), capacity);
+        queue.begin();
+        return queue;
+    }
+
+    static QueuedSample sample(uint32_t i) { return QueuedSample{1700000000 + i, i * 40, 10.0f + i, i % 2 == 0, false}; }
+
+    long logSize() {
+        FILE* f = fopen(logPath.c_str(), "rb");
+        if (!f) return -1;
+        fseek(f, 0, SEEK_END);
+        long bytes = ftell(f);
+        fclose(f);
+        return bytes;
+    }
+
+    // Pops everything and checks it is 0..count-1 in order.
+    void expectSequence(TelemetryQueue& queue, uint32_t count) {
+        QueuedSample out[16];
+        uint32_t next = 0;
+        size_t got;
+        while ((got = queue.peek(out, 16)) > 0) {
+            for (size_t i = 0; i < got; i++, next++) {
+                EXPECT_EQ(next * 40, out[i].uptimeMs);
+                EXPECT_EQ(10.0f + next, out[i].distance);
+                EXPECT_EQ(next % 2 == 0, out[i].ledOn);
+            }
+            queue.consume();
+        }
+        EXPECT_EQ(count, next);
+        EXPECT_EQ(0u, queue.pending());
+    }
+
+    std::string dir;
+    std::string logPath;
+    std::string cursorPath;
+};
+
+TEST_F(Queue, StagesThenFlushesInFrames) {
+    TelemetryQueue queue = open();
+    for (uint32_t i = 0; i < 7; i++) ASSERT_TRUE(queue.push(sample(i)));
+    EXPECT_EQ(-1, logSize());    // still staged in RAM
+    ASSERT_TRUE(queue.push(sample(7)));
+    EXPECT_EQ(8 * (long)TelemetryQueue::RECORD_SIZE, logSize());
+    EXPECT_EQ(8u, queue.pending());
+    expectSequence(queue, 8);
+    EXPECT_EQ(-1, logSize());    // drained queues leave no files behind
+}
+
+TEST_F(Queue, CursorSurvivesARestart) {
+    {
+        TelemetryQueue queue = open();
+        for (uint32_t i = 0; i < 20; i++) queue.push(sample(i));
+        queue.flush();
+        QueuedSample out[5];
+        ASSERT_EQ(5u, queue.peek(out, 5));
+        queue.consume();
+    }
+    TelemetryQueue queue = open();
+    EXPECT_EQ(15u, queue.pending());
+    QueuedSample out[1];
+    ASSERT_EQ(1u, queue.peek(out, 1));
+    EXPECT_EQ(5u * 40, out[0].uptimeMs);
+}
+
+TEST_F(Queue, DropsBeyondCapacity) {
+    TelemetryQueue queue = open(10);
+    for (uint32_t i = 0; i < 12; i++) queue.push(sample(i));
+    EXPECT_EQ(10u, queue.pending());
+    EXPECT_EQ(2u, queue.droppedCount());
+}
+
+TEST_F(Queue, SkipsFramesThatFailTheirCrc) {
+    {
+        TelemetryQueue queue = open();
+        for (uint32_t i = 0; i < 8; i++) queue.push(sample(i));
+    }
+    FILE* f = fopen(logPath.c_str(), "r+b");
+    fseek(f, 3 * TelemetryQueue::RECORD_SIZE + 5, SEEK_SET);
+    fputc(0xAA, f);
+    fclose(f);
+
+    TelemetryQueue queue = open();
+    QueuedSample out[8];
+    EXPECT_EQ(7u, queue.peek(out, 8));
+    EXPECT_EQ(1u, queue.corruptCount());
+    EXPECT_EQ(4u * 40, out[3].uptimeMs);
+}
+
+// A power cut in the middle of a frame leaves a partial frame at the end of
+// the log. It must not shift the frames written after the restart.
+TEST_F(Queue, TornFrameAtTheEndIsOverwritten) {
+    {
+        TelemetryQueue queue = open();
+        for (uint32_t i = 0; i < 8; i++) queue.push(sample(i));
+    }
+    FILE* f = fopen(logPath.c_str(), "ab");
+    const uint8_t torn[7] = {1, 2, 3, 4, 5, 6, 7};
+    fwrite(torn, 1, sizeof(torn), f);
+    fclose(f);
+
+    TelemetryQueue queue = open();
+    EXPECT_EQ(8u, queue.pending());
+    for (uint32_t i = 8; i < 16; i++) queue.push(sample(i));
+    EXPECT_EQ(16 * (long)TelemetryQueue::RECORD_SIZE, logSize());
+    expectSequence(queue, 16);
+    EXPECT_EQ(0u, queue.corruptCount());
+}
+
+// The file system fills up part-way through a flush: only whole frames that
+// reached the file count, and once there is room again the next flush
+// continues right after them.
+TEST_F(Queue, ShortWriteKeepsTheLogAligned) {
+    TelemetryQueue queue = open();
+    for (uint32_t i = 0; i < 8; i++) queue.push(sample(i));
+
+    signal(SIGXFSZ, SIG_IGN);
+    struct rlimit previous;
+    getrlimit(RLIMIT_FSIZE, &previous);
+    struct rlimit limit = previous;
+    limit.rlim_cur = 11 * TelemetryQueue::RECORD_SIZE + 9;    // room for 3.5 more frames
+    setrlimit(RLIMIT_FSIZE, &limit);
+    for (uint32_t i = 8; i < 16; i++) queue.push(sample(i));
+    setrlimit(RLIMIT_FSIZE, &previous);
+
+    EXPECT_EQ(11u, queue.pending());
+    EXPECT_EQ(5u, queue.droppedCount());
+    EXPECT_EQ(11 * (long)TelemetryQueue::RECORD_SIZE + 9, logSize());
+
+    // The dropped samples are gone; what follows must line up behind frame 10.
+    QueuedSample out[16];
+    ASSERT_EQ(11u, queue.peek(out, 16));
+    queue.consume();
+    for (uint32_t i = 11; i < 19; i++) queue.push(sample(i));
+    ASSERT_EQ(8u, queue.peek(out, 16));
+    for (uint32_t i = 0; i < 8; i++) EXPECT_EQ((11 + i) * 40, out[i].uptimeMs);
+    EXPECT_EQ(0u, queue.corruptCount());
+}
+
+TEST_F(Queue, ShortWriteSurvivesARestart) {
+    {
+        TelemetryQueue queue = open();
+        signal(SIGXFSZ, SIG_IGN);
+        struct rlimit previous;
+        getrlimit(RLIMIT_FSIZE, &previous);
+        struct rlimit limit = previous;
+        limit.rlim_cur = 5 * TelemetryQueue::RECORD_SIZE + 3;
+        setrlimit(RLIMIT_FSIZE, &limit);
+        for (uint32_t i = 0; i < 8; i++) queue.push(sample(i));
+        setrlimit(RLIMIT_FSIZE, &previous);
+        EXPECT_EQ(5u, queue.pending());
+    }
+    TelemetryQueue queue = open();
+    EXPECT_EQ(5u, queue.pending());
+    for (uint32_t i = 5; i < 13; i++) queue.push(sample(i));
+    expectSequence(queue, 13);
+    EXPECT_EQ(0u, queue.corruptCount());
+}
+
+// Host numbers, so only useful for comparing changes to the format: the
+// cost of one record through push, flush to a file, peek and consume.
+TEST_F(Queue, Throughput) {
+    TelemetryQueue queue = open(1u << 30);
+    uint32_t i = 0;
+    bench::Result pushResult = bench::run("queue push (flush every 8)", [&] { queue.push(sample(i++)); });
+    EXPECT_LT(pushResult.nsPerOp, 1e6);
+
+    queue.flush();
+    QueuedSample out[32];
+    bench::run("queue peek+consume 32 records", [&] {
+        if (queue.peek(out, 32) == 0) {
+            for (uint32_t j = 0; j < 64; j++) queue.push(sample(j));
+            queue.flush();
+        }
+        queue.consume();
+    });
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    if (RUN_ALL_TESTS()) {
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+// Trace replay: the outputs Replay derives from a trace's inputs, a recording
+// whose outputs are the replay's own coming back without differences, and
+// what makes a trace unreadable. The benchmark replays a minute of a hallway
+// at the default 25 Hz, the way tools/replay_trace.cpp reads a downloaded
+// trace.
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "TraceReplay.h"
+
+typedef std::vector<std::string> Trace;
+
+// A minute of someone walking up to the sensor and away again every 20 s,
+// a publish decision after every sample, and an LED command halfway.
+Trace hallwayTrace(uint32_t seconds = 60) {
+    Trace trace = {"1000 H 2 0 50 1", "1000 N 1 0 0"};
+    char line[64];
+    for (uint32_t ms = 1040; ms <= 1000 + seconds * 1000; ms += 40) {
+        uint32_t phase = ms % 20000;
+        float distance = phase < 4000 ? 250 - phase * 0.055f : phase < 8000 ? 30 + (phase - 4000) * 0.055f : 250;
+        snprintf(line, sizeof(line), "%u S %.9g 0", (unsigned)ms, distance);
+        trace.push_back(line);
+        snprintf(line, sizeof(line), "%u T", (unsigned)ms);
+        trace.push_back(line);
+        if (ms == 1000 + seconds * 500) {
+            snprintf(line, sizeof(line), "%u C w LED_AUTO", (unsigned)ms);
+            trace.push_back(line);
+        }
+    }
+    trace.push_back(std::to_string(1000 + seconds * 1000) + " E 0");
+    return trace;
+}
+
+// Returns false at the first line Replay refuses.
+bool feed(Replay& replay, const Trace& trace) {
+    for (const std::string& text : trace) {
+        char line[256];
+        snprintf(line, sizeof(line), "%s", text.c_str());
+        if (!replay.feed(line)) return false;
+    }
+    return true;
+}
+
+// The inputs with each replayed output written after the line that caused
+// it, as the device would have recorded them.
+Trace withOutputs(const Trace& inputs) {
+    Replay replay;
+    Trace recording;
+    for (const std::string& text : inputs) {
+        size_t before = replay.replayed.size();
+        char line[256];
+        snprintf(line, sizeof(line), "%s", text.c_str());
+        replay.feed(line);
+        recording.push_back(text);
+        for (size_t i = before; i < replay.replayed.size(); i++) {
+            recording.push_back(std::to_string(replay.replayed[i].timeMs) + " " + replay.replayed[i].text);
+        }
+    }
+    return recording;
+}
+
+size_t countOutputs(const std::vector<Output>& outputs, const std::string& prefix) {
+    size_t count = 0;
+    for (const Output& output : outputs) count += output.text.compare(0, prefix.size(), prefix) == 0;
+    return count;
+}
+
+TEST(TraceReplay, LedFollowsTheVisitor) {
+    Replay replay;
+    ASSERT_TRUE(feed(replay, hallwayTrace()));
+    EXPECT_TRUE(replay.ended);
+    EXPECT_EQ(1500u, replay.samples);
+    EXPECT_EQ(1u, replay.commands);
+    // Three visits: on when they come close, off when they leave.
+    EXPECT_EQ(3u, countOutputs(replay.replayed, "L 1 0"));
+    EXPECT_EQ(3u, countOutputs(replay.replayed, "L 0 0"));
+    EXPECT_EQ(1u, countOutputs(replay.replayed, "A LED_AUTO SUCCESS"));
+    EXPECT_GT(countOutputs(replay.replayed, "P "), 6u);
+    EXPECT_TRUE(replay.recorded.empty());
+}
+
+TEST(TraceReplay, ItsOwnRecordingMatches) {
+    Replay replay;
+    ASSERT_TRUE(feed(replay, withOutputs(hallwayTrace())));
+    ASSERT_EQ(replay.recorded.size(), replay.replayed.size());
+    for (size_t i = 0; i < replay.recorded.size(); i++) {
+        EXPECT_TRUE(sameOutput(replay.recorded[i], replay.replayed[i])) << i << ": " << replay.recorded[i].text;
+    }
+}
+
+TEST(TraceReplay, ManualCommandsOverrideTheThreshold) {
+    Replay replay;
+    ASSERT_TRUE(feed(replay, {"1000 H 2 0 50 1", "1000 S 300 0", "1100 C w LED_ON", "1200 S 300 0",
+                              "1300 C w LED_AUTO", "1400 S 300 0"}));
+    ASSERT_EQ(5u, replay.replayed.size());
+    EXPECT_EQ("L 1 1", replay.replayed[0].text);
+    EXPECT_EQ("A LED_ON SUCCESS", replay.replayed[1].text);
+    EXPECT_EQ("L 1 0", replay.replayed[2].text);    // back in auto, still on
+    EXPECT_EQ("A LED_AUTO SUCCESS", replay.replayed[3].text);
+    EXPECT_EQ("L 0 0", replay.replayed[4].text);    // the next sample turns it off
+}
+
+// With the cloud down a full batch still goes to the network task, which
+// keeps it offline. A batch that fills while the previous one is in flight
+// waits until the network task releases it.
+TEST(TraceReplay, BatchesGoOutWhileTheCloudIsDown) {
+    Trace trace = {"1000 H 2 0 2 1", "1000 N 0 1 0"};
+    for (uint32_t ms = 1000; ms < 1320; ms += 40) {
+        trace.push_back(std::to_string(ms) + " S 100 0");
+        trace.push_back(std::to_string(ms) + " T");
+    }
+    trace.push_back("1320 N 0 1 0");
+    trace.push_back("1320 T");
+
+    Replay replay;
+    ASSERT_TRUE(feed(replay, trace));
+    ASSERT_EQ(3u, replay.replayed.size());
+    EXPECT_EQ("P state_change 100.0", replay.replayed[0].text);    // the first reading
+    EXPECT_EQ("P batch 100.0", replay.replayed[1].text);
+    EXPECT_EQ(1040u, replay.replayed[1].timeMs);
+    EXPECT_EQ("P batch 100.0", replay.replayed[2].text);    // full at 1120, released at 1320
+    EXPECT_EQ(1320u, replay.replayed[2].timeMs);
+}
+
+TEST(TraceReplay, UnmodelledCommandsAreLeftOutOfTheDiff) {
+    Replay replay;
+    ASSERT_TRUE(feed(replay, {"1000 H 2 0 50 1", "1100 C c SET_FORMAT data msgpack",
+                              "1100 A SET_FORMAT SUCCESS", "1200 C c SET_FORMAT data json",
+                              "1200 A SET_FORMAT SUCCESS"}));
+    EXPECT_EQ(1u, replay.unmodelled.count("SET_FORMAT"));
+    EXPECT_TRUE(replay.recorded.empty());
+    EXPECT_TRUE(replay.replayed.empty());
+}
+
+TEST(TraceReplay, SkewBeyondToleranceIsADifference) {
+    EXPECT_TRUE(sameOutput({1000, "L 1 0"}, {1000 + TIME_TOLERANCE_MS, "L 1 0"}));
+    EXPECT_FALSE(sameOutput({1000, "L 1 0"}, {1001 + TIME_TOLERANCE_MS, "L 1 0"}));
+    EXPECT_FALSE(sameOutput({1000, "L 1 0"}, {1000, "L 1 1"}));
+}
+
+TEST(TraceReplay, RejectsWhatItCannotReplay) {
+    Replay beforeHeader;
+    EXPECT_FALSE(feed(beforeHeader, {"1000 S 100 0"}));
+    Replay newerVersion;
+    EXPECT_FALSE(feed(newerVersion, {"1000 H 99 0 50 1"}));
+    Replay tooManySensors;
+    EXPECT_FALSE(feed(tooManySensors, {"1000 H 2 0 50 9"}));
+    Replay missingSensor;
+    EXPECT_FALSE(feed(missingSensor, {"1000 H 2 0 50 2", "1040 S 100 2"}));
+    Replay unknownKind;
+    EXPECT_FALSE(feed(unknownKind, {"1000 H 2 0 50 1", "1040 Q"}));
+
+    Replay comments;
+    EXPECT_TRUE(feed(comments, {"# from /trace", "", "1000 H 1 0 50"}));
+    EXPECT_TRUE(comments.started);
+}
+
+TEST(TraceReplayBench, MinuteOfHallway) {
+    Trace trace = withOutputs(hallwayTrace());
+    size_t outputs = 0;
+    bench::Result result = bench::run("replay 60 s hallway trace", [&] {
+        Replay replay;
+        feed(replay, trace);
+        outputs = replay.replayed.size();
+        bench::doNotOptimize(replay.recorded);
+    });
+    printf("[bench] %-36s %12.0f lines/s %8.0fx real time\n", "replay throughput", trace.size() * 1e9 / result.nsPerOp,
+           60e9 / result.nsPerOp);
+    EXPECT_GT(outputs, 0u);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    if (RUN_ALL_TESTS()) {
+    }
+    return 0;
+}
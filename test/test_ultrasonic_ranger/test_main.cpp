@@ -0,0 +1,139 @@
+// UltrasonicRanger against the simulated HC-SR04: the trigger is a real
+// 10 µs pulse on TRIG and the echo edges arrive through the pin interrupt,
+// wired the same way main.cpp wires them.
+
+#include <gtest/gtest.h>
+
+#include "Bench.h"
+#include "Arduino.h"
+#include "UltrasonicRanger.h"
+
+const uint8_t TRIG_PIN = 5;
+const uint8_t ECHO_PIN = 18;
+
+void IRAM_ATTR echoIsr(void* arg) {
+    static_cast<UltrasonicRanger*>(arg)->onEchoEdge(digitalRead(ECHO_PIN), micros());
+}
+
+class Ranger : public ::testing::Test {
+protected:
+    void SetUp() override {
+        shim::reset();
+        attachInterruptArg(digitalPinToInterrupt(ECHO_PIN), echoIsr, &ranger, CHANGE);
+    }
+
+    // Returns the time the trigger pulse ended.
+    uint32_t trigger() {
+        digitalWrite(TRIG_PIN, HIGH);
+        delayMicroseconds(10);
+        digitalWrite(TRIG_PIN, LOW);
+        ranger.onTrigger(micros());
+        return micros();
+    }
+
+    UltrasonicRanger ranger;
+    RangeSample sample = {};
+};
+
+TEST_F(Ranger, MeasuresTheEchoWidth) {
+    shim::EchoSource& sensor = shim::addEchoSource(TRIG_PIN, ECHO_PIN, 100);
+    uint32_t sentUs = trigger();
+    EXPECT_EQ(UltrasonicRanger::TRIGGERED, ranger.currentState());
+    EXPECT_FALSE(ranger.takeSample(sample));
+
+    shim::advanceUs(10000);
+    ASSERT_TRUE(ranger.takeSample(sample));
+    EXPECT_NEAR(100, sample.distance, 0.1);
+    EXPECT_EQ(sentUs + shim::EchoSource::BURST_US + sensor.echoWidthUs(), sample.timestampUs);
+    EXPECT_EQ(UltrasonicRanger::IDLE, ranger.currentState());
+    EXPECT_FALSE(ranger.takeSample(sample));    // each sample is handed out once
+    EXPECT_EQ(1u, ranger.sampleCount());
+}
+
+TEST_F(Ranger, FollowsAMovingTarget) {
+    shim::EchoSource& sensor = shim::addEchoSource(TRIG_PIN, ECHO_PIN, 0);
+    for (int cm = 5; cm <= 400; cm += 5) {
+        sensor.distanceCm = cm;
+        trigger();
+        shim::advanceUs(40000);
+        ASSERT_TRUE(ranger.takeSample(sample));
+        EXPECT_NEAR(cm, sample.distance, 0.05) << cm << " cm";
+    }
+    EXPECT_EQ(0u, ranger.timeoutCount());
+}
+
+TEST_F(Ranger, NoTargetReportsMinusOne) {
+    shim::addEchoSource(TRIG_PIN, ECHO_PIN, -1);
+    trigger();
+    shim::advanceUs(50000);
+    ASSERT_TRUE(ranger.takeSample(sample));
+    EXPECT_EQ(-1, sample.distance);
+    EXPECT_EQ(1u, ranger.timeoutCount());
+}
+
+TEST_F(Ranger, RetriggerWhileWaitingTimesOutThePendingPing) {
+    ranger.onTrigger(micros());    // no sensor attached: the echo never comes
+    delay(60);
+    ranger.onTrigger(micros());
+    ASSERT_TRUE(ranger.takeSample(sample));
+    EXPECT_EQ(-1, sample.distance);
+    EXPECT_EQ(1u, ranger.timeoutCount());
+    EXPECT_EQ(UltrasonicRanger::TRIGGERED, ranger.currentState());
+}
+
+TEST_F(Ranger, IgnoresEchoEdgesItDidNotAskFor) {
+    ranger.onEchoEdge(false, 100);
+    ranger.onEchoEdge(true, 200);
+    ranger.onEchoEdge(false, 300);
+    EXPECT_FALSE(ranger.takeSample(sample));
+    EXPECT_EQ(UltrasonicRanger::IDLE, ranger.currentState());
+}
+
+TEST_F(Ranger, SurvivesTheMicrosWrap) {
+    shim::advanceTo(0x100000000ULL - 1000);
+    shim::addEchoSource(TRIG_PIN, ECHO_PIN, 50);
+    trigger();
+    shim::advanceUs(10000);
+    ASSERT_TRUE(ranger.takeSample(sample));
+    EXPECT_NEAR(50, sample.distance, 0.1);
+}
+
+// The point of the ranger: with nothing in range pulseIn() holds the caller
+// for the whole 30 ms timeout, while starting a ping returns at once and the
+// result turns up later through the interrupt.
+TEST_F(Ranger, NeverHoldsTheCaller) {
+    shim::addEchoSource(TRIG_PIN, ECHO_PIN, -1);
+    digitalWrite(TRIG_PIN, HIGH);
+    delayMicroseconds(10);
+    digitalWrite(TRIG_PIN, LOW);
+    uint32_t startUs = micros();
+    EXPECT_EQ(0u, pulseIn(ECHO_PIN, HIGH, 30000));
+    EXPECT_GE(micros() - startUs, 30000u);
+
+    shim::advanceUs(50000);
+    startUs = micros();
+    ranger.onTrigger(micros());
+    EXPECT_EQ(startUs, micros());
+}
+
+TEST(RangerBench, InterruptPathPerSample) {
+    UltrasonicRanger ranger;
+    RangeSample sample;
+    uint32_t nowUs = 0;
+    bench::Result result = bench::run("ranger trigger+2 edges+take", [&] {
+        ranger.onTrigger(nowUs);
+        ranger.onEchoEdge(true, nowUs + 450);
+        ranger.onEchoEdge(false, nowUs + 450 + 5831);
+        ranger.takeSample(sample);
+        bench::doNotOptimize(sample);
+        nowUs += 40000;
+    });
+    EXPECT_EQ(0, result.allocationsPerOp);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    if (RUN_ALL_TESTS()) {
+    }
+    return 0;
+}
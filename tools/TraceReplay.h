@@ -0,0 +1,232 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "DeviceConfig.h"
+#include "LedController.h"
+#include "PublishPolicy.h"
+#include "SensingPipeline.h"
+#include "TraceLog.h"
+
+// Runs a trace from the device (see include/TraceLog.h) through the
+// SensingPipeline the sensing task runs, one line at a time, and keeps what
+// the device recorded next to what the replay produced. tools/replay_trace.cpp reads the file and reports the diff;
+// test/test_trace_replay feeds it traces built in memory.
+
+// Handlers read millis() a moment after the command is recorded.
+const uint32_t TIME_TOLERANCE_MS = 1;
+const size_t MAX_FIELDS = 10;
+const uint8_t MAX_SENSORS = 8;
+
+struct Output {
+    uint32_t timeMs;
+    std::string text;    // the line after the timestamp
+};
+
+class Replay {
+public:
+    std::vector<Output> recorded;
+    std::vector<Output> replayed;
+    std::set<std::string> unmodelled;
+    uint32_t firstMs = 0;
+    uint32_t lastMs = 0;
+    uint32_t samples = 0;
+    uint32_t commands = 0;
+    uint32_t dropped = 0;
+    bool started = false;
+    bool ended = false;
+
+    // Returns false on a line it cannot make sense of.
+    bool feed(char* line) {
+        char* fields[MAX_FIELDS];
+        size_t count = 0;
+        for (char* token = strtok(line, " \t\r\n"); token && count < MAX_FIELDS; token = strtok(nullptr, " \t\r\n")) {
+            fields[count++] = token;
+        }
+        if (count == 0 || fields[0][0] == '#') return true;
+        if (count < 2 || strlen(fields[1]) != 1) return false;
+
+        uint32_t now = strtoul(fields[0], nullptr, 10);
+        char kind = fields[1][0];
+        if (!started && kind != 'H') return false;
+        if (!started) firstMs = now;
+        lastMs = now;
+
+        if (TraceEvent::isOutput(kind)) {
+            if (kind == 'A' && count >= 3 && unmodelled.count(fields[2])) return true;
+            std::string text = fields[1];
+            for (size_t i = 2; i < count; i++) text += std::string(" ") + fields[i];
+            recorded.push_back({now, text});
+            return true;
+        }
+
+        switch (kind) {
+            case 'H': {
+                uint32_t version = strtoul(fields[2], nullptr, 10);
+                if (count < 5 || version < 1 || version > TraceEvent::VERSION) return false;
+                int sensors = version >= 2 && count > 5 ? atoi(fields[5]) : 1;
+                if (sensors < 1 || sensors > MAX_SENSORS) return false;
+                sensing.setSensorCount(sensors);
+                started = true;
+                led = LedController(config.thresholdCm, config.thresholdCm + config.hysteresisCm,
+                                    strtoul(fields[3], nullptr, 10));
+                batchSize = strtoul(fields[4], nullptr, 10);
+                return true;
+            }
+            case 'K': {
+                if (count < 4) return false;
+                DeviceConfig::Result result = config.set(fields[2], fields[3]);
+                if (result == DeviceConfig::UNKNOWN_KEY || result == DeviceConfig::INVALID_VALUE) return false;
+                applyConfig();
+                return true;
+            }
+            case 'X':
+                if (count < 6) return false;
+                led.restore(atoi(fields[2]), atoi(fields[3]), strtoul(fields[4], nullptr, 10),
+                            strtoul(fields[5], nullptr, 10));
+                return true;
+            case 'Y':
+                if (count < 9) return false;
+                if (atoi(fields[2])) {
+                    policy.commit(strtof(fields[3], nullptr), atoi(fields[4]), atoi(fields[5]),
+                                  strtoul(fields[6], nullptr, 10));
+                }
+                sensing.distance = strtof(fields[7], nullptr);
+                batchFill = strtoul(fields[8], nullptr, 10);
+                return true;
+            case 'N': {
+                if (count < 5) return false;
+                // The cloud being up (fields[2]) only matters to the network
+                // task: a batch goes to it either way.
+                bool wasBatching = batching;
+                batching = atoi(fields[3]);
+                batchInFlight = atoi(fields[4]);
+                if (batching != wasBatching) batchFill = 0;
+                return true;
+            }
+            case 'R': {
+                if (count < 4) return false;
+                int sensor = atoi(fields[2]);
+                if (sensor < 0 || sensor >= sensing.sensorCount()) return false;
+                sensing.sensorDistance[sensor] = strtof(fields[3], nullptr);
+                return true;
+            }
+            case 'S': {
+                if (count < 3) return false;
+                int sensor = count > 3 ? atoi(fields[3]) : 0;
+                if (sensor < 0 || sensor >= sensing.sensorCount()) return false;
+                sample(now, sensor, strtof(fields[2], nullptr));
+                return true;
+            }
+            case 'C':
+                if (count < 4) return false;
+                command(now, fields[3], count > 4 ? fields[4] : "", count > 5 ? fields[5] : "");
+                return true;
+            case 'T':
+                submit(now);
+                return true;
+            case 'E':
+                dropped = count > 2 ? strtoul(fields[2], nullptr, 10) : 0;
+                ended = true;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+private:
+    // readSensorData() on the device; the batch is only counted.
+    void sample(uint32_t now, uint8_t sensor, float raw) {
+        samples++;
+        SensingPipeline<MAX_SENSORS>::Step step = sensing.addSample(sensor, raw, now);
+        if (step.rowComplete && batching && batchFill < batchSize) batchFill++;
+        if (step.ledChanged) emitLed(now);
+    }
+
+    // submitTelemetry() on the device, assuming the telemetry queue takes
+    // everything it is offered.
+    void submit(uint32_t now) {
+        if (batching && batchFill >= batchSize && sensing.canHandOffBatch(batchInFlight)) {
+            emitSend(now, PublishPolicy::BATCH);
+            sensing.commit(now);
+            batchInFlight = true;
+            batchFill = 0;
+        }
+
+        PublishPolicy::Reason reason = sensing.evaluate(batching, now);
+        if (reason == PublishPolicy::NONE) return;
+        emitSend(now, reason);
+        sensing.commit(now);
+    }
+
+    // Mirrors the command handlers that touch sensing state. The others
+    // are only counted; their results are left out of the diff.
+    void command(uint32_t now, const char* name, const char* arg0, const char* arg1) {
+        commands++;
+        const char* status = "SUCCESS";
+        if (strcmp(name, "LED_ON") == 0 || strcmp(name, "LED_OFF") == 0) {
+            if (led.setManual(strcmp(name, "LED_ON") == 0, now)) emitLed(now);
+        } else if (strcmp(name, "LED_AUTO") == 0) {
+            if (led.setAuto()) emitLed(now);
+        } else if (strcmp(name, "SET_CONFIG") == 0) {
+            DeviceConfig changed = config;
+            DeviceConfig::Result result = changed.set(arg0, arg1);
+            if (result == DeviceConfig::UNKNOWN_KEY || result == DeviceConfig::INVALID_VALUE) {
+                status = "INVALID_ARGUMENT";
+            } else if (result == DeviceConfig::CHANGED) {
+                config = changed;
+                applyConfig();
+            }
+        } else if (strcmp(name, "GET_STATUS") == 0) {
+            emitSend(now, PublishPolicy::REQUEST);
+            return;
+        } else if (strcmp(name, "BATCH_MODE_ON") != 0 && strcmp(name, "BATCH_MODE_OFF") != 0) {
+            unmodelled.insert(name);
+            return;
+        }
+        emit(now, std::string("A ") + name + " " + status);
+    }
+
+    void applyConfig() { sensing.applyConfig(config); }
+
+    void emitLed(uint32_t now) {
+        TraceEvent event = TraceEvent::make(now, 'L');
+        event.flags = led.isOn() | led.isManual() << 1;
+        emitEvent(event);
+    }
+
+    void emitSend(uint32_t now, PublishPolicy::Reason reason) {
+        TraceEvent event = TraceEvent::make(now, 'P');
+        event.name = PublishPolicy::reasonName(reason);
+        event.value = sensing.distance;
+        emitEvent(event);
+    }
+
+    // Formats through TraceEvent so both sides print values the same way.
+    void emitEvent(const TraceEvent& event) {
+        char line[128];
+        if (event.format(line, sizeof(line)) < 0) return;
+        const char* text = strchr(line, ' ');
+        emit(event.timeMs, text ? text + 1 : line);
+    }
+
+    void emit(uint32_t now, const std::string& text) { replayed.push_back({now, text}); }
+
+    DeviceConfig config;
+    LedController led{(float)config.thresholdCm, (float)(config.thresholdCm + config.hysteresisCm), 0};
+    PublishPolicy policy{(float)config.deadbandCm, config.minPublishIntervalMs, config.heartbeatMs, 2000};
+    SensingPipeline<MAX_SENSORS> sensing{led, policy, 1};
+    bool batching = false;
+    bool batchInFlight = false;
+    uint32_t batchFill = 0;
+    uint32_t batchSize = 0;
+};
+
+inline bool sameOutput(const Output& a, const Output& b) {
+    uint32_t skew = a.timeMs > b.timeMs ? a.timeMs - b.timeMs : b.timeMs - a.timeMs;
+    return skew <= TIME_TOLERANCE_MS && a.text == b.text;
+}
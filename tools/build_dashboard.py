@@ -0,0 +1,73 @@
+"""Minify and gzip web/dashboard.html into include/dashboard_html.h.
+
+Runs as a PlatformIO pre-build script (see extra_scripts in platformio.ini)
+and can also be run by hand: python tools/build_dashboard.py
+"""
+
+import gzip
+import hashlib
+import os
+import re
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+    PROJECT_DIR = env["PROJECT_DIR"]  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+SOURCE = os.path.join(PROJECT_DIR, "web", "dashboard.html")
+OUTPUT = os.path.join(PROJECT_DIR, "include", "dashboard_html.h")
+
+
+def minify(html):
+    # Only strip indentation and blank lines. Newlines are kept so the inline
+    # script never depends on automatic semicolon insertion across lines.
+    lines = (line.strip() for line in html.splitlines())
+    html = "\n".join(line for line in lines if line)
+    return re.sub(r">\n<", "><", html)
+
+
+def render_header(payload, etag, source_hash):
+    rows = []
+    for i in range(0, len(payload), 16):
+        rows.append("    " + ", ".join("0x%02x" % b for b in payload[i:i + 16]) + ",")
+
+    return "\n".join([
+        "#pragma once",
+        "",
+        "// Generated by tools/build_dashboard.py from web/dashboard.html. Do not edit.",
+        "// source-sha256: %s" % source_hash,
+        "",
+        "#include <Arduino.h>",
+        "",
+        "#define DASHBOARD_HTML_ETAG \"\\\"%s\\\"\"" % etag,
+        "",
+        "const uint8_t DASHBOARD_HTML_GZ[] PROGMEM = {",
+    ] + rows + [
+        "};",
+        "const size_t DASHBOARD_HTML_GZ_LEN = sizeof(DASHBOARD_HTML_GZ);",
+        "",
+    ])
+
+
+def build():
+    with open(SOURCE, "rb") as f:
+        source = f.read()
+    source_hash = hashlib.sha256(source).hexdigest()
+
+    if os.path.exists(OUTPUT):
+        with open(OUTPUT, "r", encoding="utf-8") as f:
+            if "source-sha256: %s" % source_hash in f.read():
+                return
+
+    minified = minify(source.decode("utf-8")).encode("utf-8")
+    payload = gzip.compress(minified, compresslevel=9, mtime=0)
+    etag = hashlib.sha256(payload).hexdigest()[:16]
+
+    with open(OUTPUT, "w", encoding="utf-8", newline="\n") as f:
+        f.write(render_header(payload, etag, source_hash))
+
+    print("dashboard: %d bytes -> %d minified -> %d gzipped" % (len(source), len(minified), len(payload)))
+
+
+build()
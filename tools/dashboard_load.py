@@ -0,0 +1,211 @@
+"""Load-test the dashboard endpoints of a running device.
+
+Starts several clients that poll /data at the same time, the way open
+dashboard tabs do, and samples the free heap from /metrics before, during
+and after the run:
+
+    python tools/dashboard_load.py 192.168.1.50 --clients 10 --duration 60
+
+Prints requests per second, response times and failures, plus the free
+heap and the heap low-water mark. The free heap should be back where it
+started once the clients stop.
+
+With --viewers, that many clients also hold /events open the way a live
+dashboard tab does, and the script reports the sockets they hold, the
+events each one received and the dashboard stage's CPU time per viewer
+(the stage's time on /metrics while they are connected, minus the same
+time measured for --baseline seconds before they connect):
+
+    python tools/dashboard_load.py 192.168.1.50 --clients 0 --viewers 4
+
+Only needs the Python standard library.
+"""
+
+import argparse
+import http.client
+import json
+import re
+import socket
+import threading
+import time
+
+HEAP_METRICS = ("esp32_heap_free_bytes", "esp32_heap_min_free_bytes", "esp32_heap_max_alloc_bytes")
+DASHBOARD_CPU = 'esp32_stage_duration_seconds_sum{stage="dashboard"}'
+VIEWERS = "esp32_dashboard_viewers"
+EVENTS_SENT = "esp32_dashboard_events_total"
+
+
+def read_metrics(host, port):
+    conn = http.client.HTTPConnection(host, port, timeout=10)
+    try:
+        conn.request("GET", "/metrics")
+        text = conn.getresponse().read().decode()
+    finally:
+        conn.close()
+    values = {}
+    for line in text.splitlines():
+        match = re.match(r"^([a-z0-9_]+(?:\{[^}]*\})?) ([-0-9.eE+]+)$", line)
+        if match:
+            values[match.group(1)] = float(match.group(2))
+    return values
+
+
+def heap(values):
+    return tuple(int(values.get(name, 0)) for name in HEAP_METRICS)
+
+
+class Poller(threading.Thread):
+    """One dashboard tab: GET /data every interval seconds, a new connection
+    each time like a browser fetch() after keep-alive has timed out."""
+
+    def __init__(self, host, port, interval, stop):
+        super().__init__(daemon=True)
+        self.host, self.port, self.interval, self.stop = host, port, interval, stop
+        self.latencies = []
+        self.failures = 0
+
+    def run(self):
+        while not self.stop.is_set():
+            started = time.monotonic()
+            try:
+                conn = http.client.HTTPConnection(self.host, self.port, timeout=5)
+                conn.request("GET", "/data")
+                response = conn.getresponse()
+                body = response.read()
+                conn.close()
+                if response.status != 200:
+                    raise ValueError("HTTP %d" % response.status)
+                json.loads(body)
+                self.latencies.append(time.monotonic() - started)
+            except (OSError, ValueError, http.client.HTTPException):
+                self.failures += 1
+            remaining = self.interval - (time.monotonic() - started)
+            if remaining > 0:
+                self.stop.wait(remaining)
+
+
+class Viewer(threading.Thread):
+    """One live dashboard tab: keeps /events open and counts the pushes."""
+
+    def __init__(self, host, port, stop):
+        super().__init__(daemon=True)
+        self.host, self.port, self.stop = host, port, stop
+        self.events = 0
+        self.failures = 0
+
+    def run(self):
+        request = ("GET /events HTTP/1.1\r\nHost: %s\r\nAccept: text/event-stream\r\n\r\n" % self.host).encode()
+        while not self.stop.is_set():
+            try:
+                with socket.create_connection((self.host, self.port), timeout=5) as sock:
+                    sock.sendall(request)
+                    sock.settimeout(1)
+                    tail = b""
+                    while not self.stop.is_set():
+                        try:
+                            chunk = sock.recv(4096)
+                        except socket.timeout:
+                            continue    # nothing changed, keep listening
+                        if not chunk:
+                            raise ValueError("stream closed")
+                        text = tail + chunk
+                        self.events += text.count(b"event: data")
+                        tail = text[-len(b"event: data") + 1:]
+            except (OSError, ValueError):
+                self.failures += 1
+                self.stop.wait(1)
+
+
+def cpu_rate(host, port, seconds):
+    """Dashboard stage CPU seconds per second over the next `seconds`."""
+    first = read_metrics(host, port).get(DASHBOARD_CPU, 0)
+    started = time.monotonic()
+    time.sleep(seconds)
+    last = read_metrics(host, port).get(DASHBOARD_CPU, 0)
+    return (last - first) / (time.monotonic() - started)
+
+
+def percentile(values, fraction):
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host", help="device IP address or hostname")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--clients", type=int, default=10, help="concurrent /data pollers (default 10)")
+    parser.add_argument("--interval", type=float, default=0,
+                        help="seconds between polls per client; 0 polls as fast as the device answers (default)")
+    parser.add_argument("--duration", type=float, default=60, help="seconds to run (default 60)")
+    parser.add_argument("--viewers", type=int, default=0, help="clients holding /events open (default 0)")
+    parser.add_argument("--baseline", type=float, default=10,
+                        help="seconds to measure the dashboard CPU time before viewers connect (default 10)")
+    args = parser.parse_args()
+
+    metrics = read_metrics(args.host, args.port)
+    before = heap(metrics)
+    print("heap before: free %d, min free %d, largest block %d" % before)
+    if args.viewers:
+        print("viewers already connected: %d" % metrics.get(VIEWERS, 0))
+        baseline_cpu = cpu_rate(args.host, args.port, args.baseline)
+        events_before = read_metrics(args.host, args.port).get(EVENTS_SENT, 0)
+
+    stop = threading.Event()
+    pollers = [Poller(args.host, args.port, args.interval, stop) for _ in range(args.clients)]
+    viewers = [Viewer(args.host, args.port, stop) for _ in range(args.viewers)]
+    for client in pollers + viewers:
+        client.start()
+
+    lowest_free = before[0]
+    most_viewers = 0
+    started = time.monotonic()
+    first_cpu = None
+    while time.monotonic() - started < args.duration:
+        time.sleep(max(0.1, min(5, args.duration - (time.monotonic() - started))))
+        try:
+            metrics = read_metrics(args.host, args.port)
+        except OSError:
+            continue
+        if first_cpu is None:    # the viewers have had time to connect
+            first_cpu = (time.monotonic(), metrics.get(DASHBOARD_CPU, 0))
+        last_cpu = (time.monotonic(), metrics.get(DASHBOARD_CPU, 0))
+        during = heap(metrics)
+        lowest_free = min(lowest_free, during[0])
+        most_viewers = max(most_viewers, int(metrics.get(VIEWERS, 0)))
+        print("  %5.0fs  free %d, min free %d, largest block %d, viewers %d" %
+              ((time.monotonic() - started,) + during + (metrics.get(VIEWERS, 0),)))
+    if args.viewers:
+        events_sent = read_metrics(args.host, args.port).get(EVENTS_SENT, 0) - events_before
+    stop.set()
+    for client in pollers + viewers:
+        client.join()
+    elapsed = time.monotonic() - started
+
+    time.sleep(2)    # let the device close the last sockets
+    after = heap(read_metrics(args.host, args.port))
+
+    if pollers:
+        latencies = [latency for poller in pollers for latency in poller.latencies]
+        failures = sum(poller.failures for poller in pollers)
+        print("%d clients, %.0f s: %d requests (%.1f/s), %d failed" %
+              (args.clients, elapsed, len(latencies), len(latencies) / elapsed, failures))
+        print("response time: p50 %.0f ms, p99 %.0f ms, max %.0f ms" %
+              (percentile(latencies, 0.5) * 1000, percentile(latencies, 0.99) * 1000, max(latencies or [0]) * 1000))
+    if viewers:
+        received = [viewer.events for viewer in viewers]
+        print("%d viewers, %.0f s: %d sockets held at most, %d events pushed, each viewer received %d-%d, "
+              "%d reconnects" % (args.viewers, elapsed, most_viewers, events_sent, min(received), max(received),
+                                 sum(viewer.failures for viewer in viewers)))
+        if first_cpu and last_cpu[0] > first_cpu[0]:
+            loaded_cpu = (last_cpu[1] - first_cpu[1]) / (last_cpu[0] - first_cpu[0])
+            print("dashboard CPU: %.3f ms/s without viewers, %.3f ms/s with them, %.3f ms/s per viewer" %
+                  (baseline_cpu * 1000, loaded_cpu * 1000, (loaded_cpu - baseline_cpu) * 1000 / args.viewers))
+    print("heap after: free %d (%+d), min free %d, largest block %d; lowest free seen during the run %d" %
+          (after[0], after[0] - before[0], after[1], after[2], lowest_free))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,98 @@
+// Replays a trace recorded on the device (TRACE_START/TRACE_STOP, download
+// from /trace) through the same filter, LED controller and publish policy the
+// sensing task runs, as fast as the host allows, and diffs the LED changes,
+// telemetry hand-offs and command results against what the device recorded.
+// See include/TraceLog.h for the format.
+//
+//   g++ -std=gnu++11 -O2 -Iinclude tools/replay_trace.cpp -o replay_trace
+//   ./replay_trace trace.log [-v]
+//
+// -v prints every replayed output. Exits 0 when the replay matches the
+// recording, 1 when it differs and 2 when the trace cannot be read.
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "TraceReplay.h"
+
+const size_t MAX_REPORTED_DIFFERENCES = 10;
+
+static void printOutput(const char* label, const std::vector<Output>& outputs, size_t i) {
+    if (i < outputs.size()) {
+        printf("  %s %u %s\n", label, (unsigned)outputs[i].timeMs, outputs[i].text.c_str());
+    } else {
+        printf("  %s (none)\n", label);
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    bool verbose = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s trace.log [-v]\n", argv[0]);
+        return 2;
+    }
+
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return 2;
+    }
+
+    Replay replay;
+    char line[256];
+    unsigned lineNumber = 0;
+    auto begin = std::chrono::steady_clock::now();
+    while (fgets(line, sizeof(line), f)) {
+        lineNumber++;
+        if (!replay.feed(line)) {
+            fprintf(stderr, "%s:%u: cannot replay this line\n", path, lineNumber);
+            fclose(f);
+            return 2;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    fclose(f);
+
+    double hostMs = std::chrono::duration<double, std::milli>(elapsed).count();
+    double traceMs = replay.lastMs - replay.firstMs;
+    printf("%u lines, %u samples, %u commands, %.1f s of trace replayed in %.2f ms (%.0fx real time)\n", lineNumber,
+           (unsigned)replay.samples, (unsigned)replay.commands, traceMs / 1000, hostMs,
+           hostMs > 0 ? traceMs / hostMs : 0);
+    if (!replay.ended) printf("warning: trace has no end record, it may be truncated\n");
+    if (replay.dropped) printf("warning: the device dropped %u events while recording\n", (unsigned)replay.dropped);
+    for (const std::string& name : replay.unmodelled) {
+        printf("note: %s is not modelled, its results are not compared\n", name.c_str());
+    }
+
+    if (verbose) {
+        for (const Output& output : replay.replayed) printf("%u %s\n", (unsigned)output.timeMs, output.text.c_str());
+    }
+
+    size_t differences = 0;
+    size_t total = replay.recorded.size() > replay.replayed.size() ? replay.recorded.size() : replay.replayed.size();
+    for (size_t i = 0; i < total; i++) {
+        bool match = i < replay.recorded.size() && i < replay.replayed.size() &&
+                     sameOutput(replay.recorded[i], replay.replayed[i]);
+        if (match) continue;
+        if (++differences <= MAX_REPORTED_DIFFERENCES) {
+            printf("output %u differs:\n", (unsigned)i);
+            printOutput("recorded", replay.recorded, i);
+            printOutput("replayed", replay.replayed, i);
+        }
+    }
+
+    printf("%u recorded outputs, %u replayed, %u differences\n", (unsigned)replay.recorded.size(),
+           (unsigned)replay.replayed.size(), (unsigned)differences);
+    return differences ? 1 : 0;
+}
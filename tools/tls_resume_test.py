@@ -0,0 +1,181 @@
+"""Compare full and resumed TLS handshakes against a local Mosquitto broker.
+
+Runs between the device and the broker as a TCP relay, drops the connection
+every few seconds so the device reconnects, and collects the connect reports
+the device publishes on devices/<client-id>/data (tls_handshake_ms,
+tls_resumed, tls_heap_peak_bytes, tls_heap_held_bytes). The relay sends two
+reconnects in a row to one broker listener and the next two to the other.
+Each listener has its own session cache, so the first connect after a switch
+is a full handshake and the second one can resume. That gives both kinds
+under the same network and broker.
+
+Setup, once:
+
+1. Make a CA, a broker certificate whose CN is this computer's IP address,
+   and a client certificate:
+
+       openssl req -x509 -newkey rsa:2048 -nodes -days 365 -subj /CN=test-ca -keyout ca.key -out ca.crt
+       openssl req -newkey rsa:2048 -nodes -subj /CN=192.168.1.20 -keyout broker.key -out broker.csr
+       openssl x509 -req -in broker.csr -CA ca.crt -CAkey ca.key -CAcreateserial -days 365 -out broker.crt
+       openssl req -newkey rsa:2048 -nodes -subj /CN=esp32 -keyout device.key -out device.csr
+       openssl x509 -req -in device.csr -CA ca.crt -CAkey ca.key -CAcreateserial -days 365 -out device.crt
+
+2. Start Mosquitto with two TLS listeners and a plain one for this script:
+
+       per_listener_settings true
+       listener 8884
+       cafile ca.crt
+       certfile broker.crt
+       keyfile broker.key
+       require_certificate true
+       allow_anonymous true
+       listener 8885
+       (the same five lines again)
+       listener 1883 127.0.0.1
+       allow_anonymous true
+
+3. Put ca.crt, device.crt and device.key into secrets.h as AWS_CERT_CA,
+   AWS_CERT_CRT and AWS_CERT_PRIVATE, set AWS_IOT_ENDPOINT to this
+   computer's IP address, and flash the device. It connects to port 8883,
+   where this script listens.
+
+Then run, with mosquitto_sub on the PATH:
+
+    python tools/tls_resume_test.py --reconnects 20
+
+Prints handshake time and heap use for full and resumed handshakes. If no
+handshake ever comes out resumed, the broker build is not resuming sessions
+for clients with certificates, and the comparison needs another broker. Only
+needs the Python standard library.
+"""
+
+import argparse
+import json
+import socket
+import statistics
+import subprocess
+import threading
+import time
+
+
+class Relay(threading.Thread):
+    """Forwards each device connection to the broker listener for its turn."""
+
+    def __init__(self, listen_port, broker, broker_ports):
+        super().__init__(daemon=True)
+        self.server = socket.create_server(("", listen_port))
+        self.broker, self.broker_ports = broker, broker_ports
+        self.connections = 0
+        self.sockets = []
+        self.lock = threading.Lock()
+
+    def run(self):
+        while True:
+            device, _ = self.server.accept()
+            port = self.broker_ports[self.connections // 2 % len(self.broker_ports)]
+            self.connections += 1
+            try:
+                broker = socket.create_connection((self.broker, port))
+            except OSError:
+                device.close()
+                continue
+            with self.lock:
+                self.sockets = [device, broker]
+            threading.Thread(target=pump, args=(device, broker), daemon=True).start()
+            threading.Thread(target=pump, args=(broker, device), daemon=True).start()
+
+    def drop(self):
+        with self.lock:
+            for sock in self.sockets:
+                try:
+                    sock.shutdown(socket.SHUT_RDWR)
+                except OSError:
+                    pass
+            self.sockets = []
+
+
+def pump(source, target):
+    try:
+        while True:
+            data = source.recv(4096)
+            if not data:
+                break
+            target.sendall(data)
+    except OSError:
+        pass
+    for sock in (source, target):
+        try:
+            sock.close()
+        except OSError:
+            pass
+
+
+def read_reports(process, reports, arrived):
+    for line in process.stdout:
+        try:
+            message = json.loads(line)
+        except ValueError:
+            continue
+        if message.get("status") in ("CONNECTED", "RECONNECTED") and "tls_handshake_ms" in message:
+            reports.append(message)
+            arrived.set()
+
+
+def summary(name, reports):
+    if not reports:
+        return "%-8s none" % name
+
+    def field(key):
+        values = [report.get(key, 0) for report in reports]
+        return "%7.0f %7.0f" % (statistics.median(values), max(values))
+
+    return "%-8s %5d   %s   %s   %s" % (name, len(reports), field("tls_handshake_ms"),
+                                       field("tls_heap_peak_bytes"), field("tls_heap_held_bytes"))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--listen", type=int, default=8883, help="port the device connects to (default 8883)")
+    parser.add_argument("--broker", default="127.0.0.1", help="broker address (default 127.0.0.1)")
+    parser.add_argument("--broker-ports", default="8884,8885", help="the two TLS listeners (default 8884,8885)")
+    parser.add_argument("--report-port", type=int, default=1883, help="plain listener to read reports from")
+    parser.add_argument("--reconnects", type=int, default=20, help="connections to measure (default 20)")
+    parser.add_argument("--hold", type=float, default=5, help="seconds to keep each connection up (default 5)")
+    args = parser.parse_args()
+
+    reports = []
+    arrived = threading.Event()
+    subscriber = subprocess.Popen(["mosquitto_sub", "-h", args.broker, "-p", str(args.report_port),
+                                   "-t", "devices/+/data"], stdout=subprocess.PIPE, text=True)
+    threading.Thread(target=read_reports, args=(subscriber, reports, arrived), daemon=True).start()
+
+    relay = Relay(args.listen, args.broker, [int(port) for port in args.broker_ports.split(",")])
+    relay.start()
+    print("waiting for the device on port %d..." % args.listen)
+
+    try:
+        while len(reports) < args.reconnects:
+            if not arrived.wait(120):
+                print("no connect report for 2 minutes; is the device pointed at this computer?")
+                break
+            arrived.clear()
+            report = reports[-1]
+            print("  #%-3d %-7s handshake %5d ms, heap peak %6d B, held %6d B" %
+                  (len(reports), "resumed" if report.get("tls_resumed") else "full", report.get("tls_handshake_ms", 0),
+                   report.get("tls_heap_peak_bytes", 0), report.get("tls_heap_held_bytes", 0)))
+            time.sleep(args.hold)
+            relay.drop()
+    finally:
+        subscriber.terminate()
+
+    print("\n                  handshake ms    heap peak B     heap held B")
+    print("kind     count   median     max   median     max   median     max")
+    # The first connect after boot may resume a session saved before a reset,
+    # so it is left out.
+    measured = reports[1:]
+    print(summary("full", [report for report in measured if not report.get("tls_resumed")]))
+    print(summary("resumed", [report for report in measured if report.get("tls_resumed")]))
+
+
+if __name__ == "__main__":
+    main()